@@ -9,7 +9,7 @@ do
   sin=`echo "s($ob*$pi/180)" | bc -l`
 
   echo $ob $cos $sin
-  epsic -N .001953125 -c 0.99 -s 2,$sin,0,$cos -s B2,0,0,-1 -f -n 1024
+  epsic -N .001953125 -c 0.99 -s 2,$sin,0,$cos -s B2,0,0,-1 -f -F text -n 1024
   mv stokes.txt ${ob}.txt
 
 done
@@ -0,0 +1,55 @@
+"""Read the binary Stokes samples written by epsic -f
+
+The format is described in src/stokes_file.h.  For example,
+
+    from stokes_file import read_stokes
+    header, stokes = read_stokes("stokes.dat")
+    print(header["sample_size"], stokes[:, 0].mean())
+
+returns the header as a dictionary and the samples as an array with
+one row of I,Q,U,V per Stokes sample.
+"""
+
+import struct
+import zlib
+
+import numpy as np
+
+
+def read_stokes(filename):
+    with open(filename, "rb") as f:
+        if f.read(8) != b"EPSICSTK":
+            raise ValueError(filename + " is not a file of Stokes samples")
+
+        version, dtype_size, compression, sample_size = struct.unpack("=4I", f.read(16))
+        seed, length = struct.unpack("=2Q", f.read(16))
+        config = f.read(length).decode()
+        f.seek((f.tell() + 7) // 8 * 8)
+
+        if version != 1:
+            raise ValueError("unsupported version %d" % version)
+
+        dtype = np.float32 if dtype_size == 4 else np.float64
+
+        chunks = []
+        while True:
+            head = f.read(8)
+            if len(head) < 8:
+                break
+            nsamp, nbyte = struct.unpack("=2I", head)
+            if nsamp == 0:
+                break
+            data = f.read(nbyte)
+            if compression == 1:
+                data = zlib.decompress(data)
+            chunks.append(np.frombuffer(data, dtype=dtype).reshape(nsamp, 4))
+
+    header = dict(version=version, dtype=dtype, compression=compression,
+                  sample_size=sample_size, seed=seed, config=config)
+
+    if chunks:
+        stokes = np.concatenate(chunks)
+    else:
+        stokes = np.empty((0, 4), dtype=dtype)
+
+    return header, stokes
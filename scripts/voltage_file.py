@@ -0,0 +1,53 @@
+"""Read the quantized voltages written by epsic -Q
+
+The format is described in src/voltage_file.h.  For example,
+
+    from voltage_file import read_voltages
+    header, x, y = read_voltages("voltages.dat")
+    print(header["nbit"], (abs(x)**2).mean())
+
+returns the header as a dictionary and the x and y components of the
+field as complex arrays, with each code replaced by the value that it
+represents.
+"""
+
+import struct
+
+import numpy as np
+
+
+def read_voltages(filename):
+    with open(filename, "rb") as f:
+        if f.read(8) != b"EPSICVLT":
+            raise ValueError(filename + " is not a file of quantized voltages")
+
+        version, nbit, block_size = struct.unpack("=3I", f.read(12))
+        seed, length = struct.unpack("=2Q", f.read(16))
+        config = f.read(length).decode()
+        f.seek((f.tell() + 7) // 8 * 8)
+
+        if version != 1:
+            raise ValueError("unsupported version %d" % version)
+
+        shifts = np.arange(0, 8, nbit, dtype=np.uint8)
+        mask = (1 << nbit) - 1
+
+        blocks = []
+        while True:
+            head = f.read(12)
+            if len(head) < 12:
+                break
+            n, step_x, step_y = struct.unpack("=I2f", head)
+            codes = np.frombuffer(f.read(n * nbit // 2), dtype=np.uint8)
+            codes = ((codes[:, None] >> shifts) & mask).reshape(n, 4).astype(np.int32)
+            values = (codes - (1 << (nbit - 1)) + 0.5) * [step_x, step_x, step_y, step_y]
+            blocks.append(values)
+
+    header = dict(version=version, nbit=nbit, block_size=block_size,
+                  seed=seed, config=config)
+
+    values = np.concatenate(blocks) if blocks else np.empty((0, 4))
+    x = values[:, 0] + 1j * values[:, 1]
+    y = values[:, 2] + 1j * values[:, 3]
+
+    return header, x, y
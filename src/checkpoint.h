@@ -0,0 +1,87 @@
+//-*-C++-*-
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+//! @file epsic/src/checkpoint.h
+
+#ifndef __epsic_checkpoint_h
+#define __epsic_checkpoint_h
+
+#include "Matrix.h"
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <cstdint>
+
+namespace epsic
+{
+  /*! The state of a simulation is checkpointed in native byte order,
+    so that a checkpoint can be resumed only on the same architecture. */
+
+  //! Write the binary representation of a trivially copyable value
+  template<typename T>
+  void write_binary (std::ostream& os, const T& x)
+  {
+    os.write (reinterpret_cast<const char*>(&x), sizeof(T));
+  }
+
+  //! Read the binary representation of a trivially copyable value
+  template<typename T>
+  void read_binary (std::istream& is, T& x)
+  {
+    if (!is.read (reinterpret_cast<char*>(&x), sizeof(T)))
+      throw std::runtime_error ("epsic::read_binary - checkpoint truncated");
+  }
+
+  template<unsigned N, typename T>
+  void write_binary (std::ostream& os, const Vector<N,T>& x)
+  {
+    for (unsigned i=0; i<N; i++)
+      write_binary (os, x[i]);
+  }
+
+  template<unsigned N, typename T>
+  void read_binary (std::istream& is, Vector<N,T>& x)
+  {
+    for (unsigned i=0; i<N; i++)
+      read_binary (is, x[i]);
+  }
+
+  template<unsigned M, unsigned N, typename T>
+  void write_binary (std::ostream& os, const Matrix<M,N,T>& x)
+  {
+    for (unsigned i=0; i<M; i++)
+      write_binary (os, x[i]);
+  }
+
+  template<unsigned M, unsigned N, typename T>
+  void read_binary (std::istream& is, Matrix<M,N,T>& x)
+  {
+    for (unsigned i=0; i<M; i++)
+      read_binary (is, x[i]);
+  }
+
+  //! Write a string preceded by its length
+  inline void write_binary (std::ostream& os, const std::string& x)
+  {
+    write_binary (os, uint64_t (x.size()));
+    os.write (x.data(), x.size());
+  }
+
+  inline void read_binary (std::istream& is, std::string& x)
+  {
+    uint64_t size = 0;
+    read_binary (is, size);
+    x.resize (size);
+    if (size && !is.read (&x[0], size))
+      throw std::runtime_error ("epsic::read_binary - checkpoint truncated");
+  }
+
+} // end of namespace epsic
+
+#endif // ! defined __epsic_checkpoint_h
@@ -36,6 +36,19 @@ epsic::coherent::coherent (double _coh)
   a_xform = b_xform = 0;
 }
 
+epsic::coherent* epsic::coherent::clone () const
+{
+  coherent* result = new coherent (*this);
+  result->clone_sources ();
+  result->coupling = coupling->clone ();
+
+  // the field transformers are found in the copies of the sources
+  result->built = false;
+  result->a_xform = result->b_xform = 0;
+
+  return result;
+}
+
 void epsic::coherent::set_normal (BoxMuller* n)
 {
   coupling->set_normal(n);
@@ -48,7 +61,7 @@ Stokes<double> epsic::coherent::get_Stokes ()
     build ();
 
 #if 1
-  double phi = drand48() * 2*M_PI;
+  double phi = coupling->get_normal()->uniform() * 2*M_PI;
   Stokes<double> S (1,0, coherence*cos(phi), coherence*sin(phi));
   coupling->set_Stokes (2.0*S);
 #endif
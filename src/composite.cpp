@@ -6,13 +6,7 @@
  ***************************************************************************/
 
 #include "sample.h"
-
-void add (Stokes<double>& result, Spinor<double>& e)
-{
-  Vector<4, double> tmp;
-  compute_stokes (tmp, e);
-  result += tmp;
-}
+#include "stokes_kernel.h"
 
 Stokes<double> epsic::composite::get_Stokes ()
 {
@@ -20,19 +14,23 @@ Stokes<double> epsic::composite::get_Stokes ()
   unsigned B_sample_size = sample_size - A_sample_size;
   unsigned max_size = std::max (A_sample_size, B_sample_size);
   
+  fields_A.resize (block_size);
+  fields_B.resize (block_size);
+
   Stokes<double> result;
-  Spinor<double> e;
 
-  // ensure that A->get_field and B->get_field are called equal number of times 
-  for (unsigned i=0; i<max_size; i++)
+  // ensure that A and B produce an equal number of field instances
+  for (unsigned i=0; i<max_size; i+=block_size)
   {
-    e = A->get_field();
+    unsigned n = get_block (i, max_size);
+
+    A->get_fields (fields_A.data(), n);
     if (i < A_sample_size)
-      add (result, e);
+      accumulate_stokes (result, fields_A.data(), std::min (n, A_sample_size - i));
 
-    e = B->get_field();
+    B->get_fields (fields_B.data(), n);
     if (i < B_sample_size)
-      add (result, e);
+      accumulate_stokes (result, fields_B.data(), std::min (n, B_sample_size - i));
   }
   
   result /= sample_size;
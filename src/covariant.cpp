@@ -8,17 +8,48 @@
 #include "covariant.h"
 
 #include <assert.h>
+#include <chrono>
 
 double epsic::covariant_mode::modulation ()
 {
-  if (amps.size() == 0)
-    coordinator->get();
-
-  double retval = amps.front();
-  amps.pop();
+  double retval;
+  modulations (&retval, 1);
   return retval;
 }
 
+void epsic::covariant_mode::modulations (double* mod, unsigned n)
+{
+  unsigned i = 0;
+  while (i < n)
+  {
+    unsigned got = amps.pop (mod + i, n - i);
+    i += got;
+
+    if (got == 0)
+      coordinator->refill (index);
+    else if (coordinator->blocking)
+      coordinator->notify_consumed ();
+  }
+}
+
+epsic::covariant_mode* epsic::covariant_mode::clone () const
+{
+  std::shared_ptr<covariant_coordinator> copy = coordinator->get_copy (index);
+
+  auto result = static_cast<covariant_mode*>
+    (copy->get_modulated_mode (index, source->clone()));
+
+  result->owns_source = true;
+  result->shared = copy;
+  return result;
+}
+
+void epsic::covariant_mode::set_normal (BoxMuller* n)
+{
+  modulated_mode::set_normal (n);
+  coordinator->set_normal (n);
+}
+
 double epsic::covariant_mode::get_mod_mean () const
 {
   return coordinator->get_mod_mean (index);
@@ -29,10 +60,49 @@ double epsic::covariant_mode::get_mod_variance () const
   return coordinator->get_mod_variance (index);
 }
 
+uint64_t epsic::covariant_mode::get_revision () const
+{
+  uint64_t result = modulated_mode::get_revision ();
+  if (coordinator)
+    result += coordinator->get_revision ();
+  return result;
+}
+
 epsic::covariant_coordinator::covariant_coordinator (double _correlation)
 {
   correlation = _correlation;
   out[0] = out[1] = 0;
+  revision = 0;
+  blocking = false;
+  timeout = 0;
+}
+
+epsic::covariant_coordinator::covariant_coordinator (const covariant_coordinator& that)
+{
+  correlation = that.correlation;
+  revision = that.revision;
+  blocking = that.blocking;
+  timeout = that.timeout;
+  out[0] = out[1] = 0;
+}
+
+/*! The first of the pair of modes to be cloned creates a new copy of
+  the coordinator, which is shared with the copy of the other mode; the
+  copy is deleted with the last of the copies of the modes. */
+std::shared_ptr<epsic::covariant_coordinator>
+epsic::covariant_coordinator::get_copy (unsigned index) const
+{
+  assert (index < 2);
+
+  std::shared_ptr<covariant_coordinator> result = duplicate.lock ();
+
+  if (!result || result->out[index])
+  {
+    result.reset (clone ());
+    duplicate = result;
+  }
+
+  return result;
 }
 
 epsic::modulated_mode* 
@@ -54,20 +124,62 @@ epsic::covariant_coordinator::get_modulated_mode (unsigned index, mode* in)
   return out[index];
 }
 
-void epsic::covariant_coordinator::get()
+/*! Taking the lock before notifying ensures that an output that has
+  found the buffer of its partner full is already waiting. */
+void epsic::covariant_coordinator::notify_consumed ()
+{
+  { std::lock_guard<std::mutex> lock (producer); }
+  consumed.notify_all ();
+}
+
+/*! Called by out[index] when it has no factors left; the number of
+  pairs produced is limited by the space in the buffers of both outputs.
+  If the buffer of the partner is full and blocking, the caller waits
+  until the partner has used some of its factors, or throws an
+  exception after the timeout; otherwise, the buffer of out[index] is
+  filled and the excess factors of the partner are discarded. */
+void epsic::covariant_coordinator::refill (unsigned index)
 {
   for (unsigned i=0; i<2; i++)
     if (!out[i])
-      throw std::runtime_error( "covariant_coordinator::get "
+      throw std::runtime_error( "covariant_coordinator::refill "
                                 "output not set" );
 
-  double a0, a1;
-  get_modulation (a0, a1);
+  std::unique_lock<std::mutex> lock (producer);
+
+  ring_buffer<double>& mine = out[index]->amps;
+  ring_buffer<double>& other = out[!index]->amps;
+
+  // the partner may have produced pairs while this output waited for the lock
+  if (!mine.empty())
+    return;
+
+  // produce only as many pairs as both outputs can store
+  unsigned n = std::min (mine.space(), other.space());
+
+  if (n == 0 && blocking)
+  {
+    // only this output can fill its own buffer, which remains empty
+    if (!consumed.wait_for (lock, std::chrono::duration<double> (timeout),
+                            [&] { return other.space() > 0; }))
+      throw std::runtime_error ("epsic::covariant_coordinator::refill - "
+                                "timed out waiting for the partner output");
+
+    n = std::min (mine.space(), other.space());
+  }
+  else if (n == 0)
+  {
+    // the partner is full; its excess factors will be discarded
+    n = mine.space();
+  }
+
+  for (unsigned i=0; i<2; i++)
+    amps[i].resize (n);
 
-  // std::cerr << "covariant_coordinator::get a0=" << a0 << " a1=" << a1 << std::endl;
+  get_modulations (amps[0].data(), amps[1].data(), n);
 
-  out[0]->amps.push( a0 );
-  out[1]->amps.push( a1 );
+  out[0]->amps.push (amps[0].data(), n);
+  out[1]->amps.push (amps[1].data(), n);
 }
 
 Matrix<2,2,double> sqrt (const Matrix<2,2,double>& C)
@@ -84,16 +196,21 @@ Matrix<2,2,double> sqrt (const Matrix<2,2,double>& C)
   return result;
 }
 
-epsic::bivariate_lognormal_modes::~bivariate_lognormal_modes ()
+void epsic::bivariate_lognormal_modes::set_diagnostic (bool flag)
+{
+  if (flag)
+    statistics = std::make_shared<shared_statistics> ();
+  else
+    statistics.reset ();
+}
+
+epsic::moment_accumulator<2> epsic::bivariate_lognormal_modes::get_statistics () const
 {
-  mean /= count;
-  meansq /= count;
-  meansq -= outer (mean, mean);
+  if (!statistics)
+    return moment_accumulator<2> ();
 
-  std::cerr << "\n"
-          "bivariate_lognormal_modes mean=" << mean << " "
-          "rho=" << meansq[0][1]/sqrt(meansq[0][0]*meansq[1][1]) << "\n"
-          "covar=\n" << meansq << std::endl;
+  std::lock_guard<std::mutex> lock (statistics->mutex);
+  return statistics->moments;
 }
 
 void epsic::bivariate_lognormal_modes::build ()
@@ -134,32 +251,46 @@ void epsic::bivariate_lognormal_modes::build ()
 
   correlator = sqrt(covar);
 
-  meansq = 0;
-  mean = 0;
-  count = 0;
-
   built = true;
 }
 
 void epsic::bivariate_lognormal_modes::get_modulation (double& A, double& B)
+{
+  get_modulations (&A, &B, 1);
+}
+
+void epsic::bivariate_lognormal_modes::get_modulations (double* A, double* B,
+                                                        unsigned n)
 {
   if (!built)
     build ();
 
   assert (normal != NULL);
 
-  Vector<2,double> amps;
-  amps[0] = normal->evaluate();
-  amps[1] = normal->evaluate();
+  normals.resize (2*n);
+  normal->fill (normals.data(), 2*n);
+
+  double offset0 = 0.5*log_sigma[0]*log_sigma[0];
+  double offset1 = 0.5*log_sigma[1]*log_sigma[1];
 
-  amps = correlator * amps;
+  for (unsigned i=0; i<n; i++)
+  {
+    double x0 = normals[2*i];
+    double x1 = normals[2*i+1];
 
-  amps[0] = A = exp (amps[0] - 0.5*log_sigma[0]*log_sigma[0]);
-  amps[1] = B = exp (amps[1] - 0.5*log_sigma[1]*log_sigma[1]);
+    A[i] = exp (correlator[0][0]*x0 + correlator[0][1]*x1 - offset0);
+    B[i] = exp (correlator[1][0]*x0 + correlator[1][1]*x1 - offset1);
+  }
 
-  mean += amps;
-  meansq += outer (amps, amps);
-  count ++;
+  if (statistics)
+  {
+    moment_accumulator<2> block;
+    for (unsigned i=0; i<n; i++)
+      block.add (Vector<2,double> (A[i], B[i]));
+
+    std::lock_guard<std::mutex> lock (statistics->mutex);
+    statistics->moments.combine (block);
+  }
 }
 
 void epsic::bivariate_lognormal_modes::set_beta (unsigned index, double beta)
@@ -167,5 +298,6 @@ void epsic::bivariate_lognormal_modes::set_beta (unsigned index, double beta)
   assert (index < 2);
   log_sigma[index] = sqrt( log( beta*beta + 1.0 ) );
   built = false;
+  changed ();
 }
 
@@ -12,9 +12,13 @@
 #define __epsic_covariant_h
 
 #include "modulated.h"
+#include "ring_buffer.h"
+#include "moments.h"
 #include "Matrix.h"
 
-#include <queue>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
 
 namespace epsic
 {
@@ -28,18 +32,37 @@ namespace epsic
 
     covariant_coordinator* coordinator;
     unsigned index;
-    std::queue<double> amps;
+
+    //! the copy of the coordinator shared with the copy of the partner, if a copy
+    std::shared_ptr<covariant_coordinator> shared;
+
+    //! modulation factors produced by the coordinator and not yet used
+    ring_buffer<double> amps;
 
   public:
 
+    //! maximum number of modulation factors buffered by each mode
+    static constexpr unsigned buffer_size = 1024;
+
     // initialize based on the modulation index beta
-    covariant_mode (mode* s) : modulated_mode (s) { coordinator = 0; }
+    covariant_mode (mode* s) : modulated_mode (s), amps (buffer_size) { coordinator = 0; }
+
+    //! Return a copy that shares a copy of the coordinator with a copy of its partner
+    covariant_mode* clone () const;
+
+    //! Set the random number generator of the source and the coordinator
+    void set_normal (BoxMuller*);
 
     // return a random scalar modulation factor
     double modulation ();
 
+    // fill the array with n random scalar modulation factors
+    void modulations (double* mod, unsigned n);
+
     double get_mod_mean () const;
     double get_mod_variance () const;
+
+    uint64_t get_revision () const;
   };
 
   //! models a pair of modes with covariant instantaneous intensities
@@ -49,16 +72,55 @@ namespace epsic
     covariant_mode* out[2];
 
     friend class covariant_mode;
-    void get();
+
+    //! Produce a block of pairs for out[index], which has no factors left
+    void refill (unsigned index);
+
+    //! serializes the production of pairs by the outputs that call refill
+    std::mutex producer;
+
+    //! the pairs produced by refill
+    std::vector<double> amps[2];
+
+    //! wait for the partner to make space instead of discarding its factors
+    bool blocking;
+
+    //! the longest time, in seconds, that refill waits for the partner
+    double timeout;
+
+    //! notified by an output that has used some of its factors, if blocking
+    std::condition_variable consumed;
+
+    //! Wake an output that waits in refill for its partner
+    void notify_consumed ();
+
+    //! the most recent copy of this instance, returned by get_copy
+    mutable std::weak_ptr<covariant_coordinator> duplicate;
+
+    //! return a copy to be shared by copies of out[0] and out[1]
+    std::shared_ptr<covariant_coordinator> get_copy (unsigned index) const;
 
     // coefficient of mode intensity correlation
     double correlation;
 
+    //! incremented whenever the statistics of the modulations change
+    uint64_t revision;
+
   protected:
 
+    //! Invalidate the cached statistics of the covariant modes
+    void changed () { revision ++; }
+
     //! Derived classes return a pair of mode intensities
     virtual void get_modulation (double& A, double& B) = 0;
 
+    //! Derived classes may return n pairs of mode intensities more efficiently
+    virtual void get_modulations (double* A, double* B, unsigned n)
+    { for (unsigned i=0; i<n; i++) get_modulation (A[i], B[i]); }
+
+    //! Copy constructor does not copy the outputs
+    covariant_coordinator (const covariant_coordinator&);
+
   public:
 
     //! Construct with correlation coefficient
@@ -67,8 +129,32 @@ namespace epsic
     //! Virtual destructor (required for abstract base class)
     virtual ~covariant_coordinator () {}
 
+    //! Return a new copy of this instance, without outputs
+    virtual covariant_coordinator* clone () const = 0;
+
+    //! Set the random number generator
+    virtual void set_normal (BoxMuller*) = 0;
+
     double get_correlation () const { return correlation; }
 
+    //! Wait for the partner output to use its factors before producing more
+    /*! Each output has a buffer of fixed size, and the i-th factor of
+      one output is paired with the i-th factor of the other.  When one
+      output has used all of its factors and the buffer of its partner
+      is full, the coordinator either waits for the partner to use some
+      of its factors (blocking), or discards the excess pairs from the
+      buffer of the partner (non-blocking, the default).  Blocking is
+      required when the outputs are driven by different threads, and
+      must not be used when they are driven by the same thread at
+      different rates, as in a disjoint combination.  If the partner
+      does not use any of its factors within timeout seconds, an
+      exception is thrown. */
+    void set_blocking (bool flag, double timeout = 10.0)
+    { blocking = flag; this->timeout = timeout; }
+
+    //! Return a number that increases whenever the statistics change
+    uint64_t get_revision () const { return revision; }
+
     double get_intensity_covariance () const
     { return correlation * sqrt( get_mod_variance (0) * get_mod_variance (1) ); }
 
@@ -81,9 +167,18 @@ namespace epsic
   //! a pair of modes with covariant intensities described by a bivariate lognormal distribution
   class bivariate_lognormal_modes : public covariant_coordinator
   {
-    Matrix<2,2,double> meansq;
-    Vector<2,double> mean;
-    unsigned count;
+    //! the statistics of the modulation factors produced by all copies
+    struct shared_statistics
+    {
+      std::mutex mutex;
+      moment_accumulator<2> moments;
+    };
+
+    //! the statistics of the modulation factors, when diagnostic
+    std::shared_ptr<shared_statistics> statistics;
+
+    //! normal deviates used to generate a block of pairs
+    std::vector<double> normals;
 
     Matrix<2,2,double> correlator;
     void build ();
@@ -95,23 +190,31 @@ namespace epsic
 
   protected:
     void get_modulation (double& A, double& B);
+    void get_modulations (double* A, double* B, unsigned n);
 
   public:
 
     bivariate_lognormal_modes (double correlation) 
     : covariant_coordinator(correlation) 
-    { built = false; set_beta(0,1.0); set_beta(1,1.0); }
+    { built = false; normal = 0; set_beta(0,1.0); set_beta(1,1.0); }
 
-    ~bivariate_lognormal_modes ();
+    bivariate_lognormal_modes* clone () const
+    { return new bivariate_lognormal_modes (*this); }
 
     void set_beta (unsigned index, double);
 
+    //! Accumulate the statistics of the modulation factors produced by this instance and its copies
+    void set_diagnostic (bool flag);
+
+    //! Return the statistics of the modulation factors, if diagnostic
+    moment_accumulator<2> get_statistics () const;
+
     double get_mod_mean (unsigned mode_index) const { return 1.0; }
     double get_mod_variance (unsigned i) const { return exp(log_sigma[i]*log_sigma[i]) - 1.0; }
 
     //! Return BoxMuller object used to generate normally distributed numbers
     virtual BoxMuller* get_normal () { return normal; }
-    virtual void set_normal (BoxMuller* n) { normal = n; }
+    void set_normal (BoxMuller* n) { normal = n; }
   };
 
 } // end of namespace epsic
@@ -7,20 +7,26 @@
  ***************************************************************************/
 
 #include "sample.h"
+#include "stokes_kernel.h"
 
 Stokes<double> epsic::disjoint::get_Stokes ()
 {
-  bool mode_A = random_double() < A_fraction;
+  if (!normal)
+    throw std::runtime_error( "epsic::disjoint::get_Stokes - BoxMuller not set");
+
+  bool mode_A = normal->uniform() < A_fraction;
   mode* e = (mode_A) ? A : B;
   
+  fields_A.resize (block_size);
+
   Stokes<double> result;
   
-  for (unsigned i=0; i<sample_size; i++)
-    {
-      Vector<4, double> tmp;
-      compute_stokes (tmp, e->get_field());
-      result += tmp;
-    }
+  for (unsigned i=0; i<sample_size; i+=block_size)
+  {
+    unsigned n = get_block (i, sample_size);
+    e->get_fields (fields_A.data(), n);
+    accumulate_stokes (result, fields_A.data(), n);
+  }
   
   result /= sample_size;
   return result;
@@ -52,10 +58,10 @@ Matrix<4,4, double> epsic::disjoint::get_crosscovariance (unsigned ilag)
   if (ilag == 0)
     return get_covariance();
   
-  Matrix<4,4,double> Acov = A->get_crosscovariance(ilag);
+  Matrix<4,4,double> Acov = A->get_cached_crosscovariance(ilag);
   Acov *= A_fraction * A_fraction;
   
-  Matrix<4,4,double> Bcov = B->get_crosscovariance(ilag);
+  Matrix<4,4,double> Bcov = B->get_cached_crosscovariance(ilag);
   Bcov *= (1-A_fraction) * (1-A_fraction);
   
   return Acov + Bcov;
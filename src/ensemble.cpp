@@ -0,0 +1,296 @@
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+#include "ensemble.h"
+#include "work_pool.h"
+
+#include <stdexcept>
+#include <limits>
+#include <random>
+#include <cstring>
+#include <cmath>
+
+using namespace std;
+
+static const char magic[8] = { 'E','P','S','I','C','E','N','S' };
+static const char* stokes_names = "IQUV";
+static const double unknown = std::numeric_limits<double>::quiet_NaN();
+
+//! Return the expected statistics of a single-threaded simulation of config
+static epsic::simulation_result get_prediction (epsic::simulation_config config)
+{
+  config.nthread = 1;
+  config.nlag = 0;
+  config.rho_stats = false;
+
+  epsic::simulation sim (config);
+  return sim.get_result ();
+}
+
+epsic::ensemble::ensemble (const simulation_config& config, uint64_t _nsamp,
+                           unsigned ntrial)
+{
+  sweep_point point;
+  point.config = config;
+  point.nsamp = _nsamp;
+
+  trials.add (point);
+  trials.set_ntrial (ntrial);
+
+  reference = 0;
+  nsamp = _nsamp;
+
+  simulation_result result = get_prediction (config);
+
+  for (unsigned i=0; i<4; i++)
+  {
+    names.push_back (string("mean_") + stokes_names[i]);
+    expected.push_back (result.expected_mean[i]);
+  }
+
+  for (unsigned i=0; i<4; i++)
+    for (unsigned j=i; j<4; j++)
+    {
+      names.push_back (string("covar_") + stokes_names[i] + stokes_names[j]);
+      expected.push_back (result.expected_covariance[i][j]);
+    }
+
+  names.push_back ("dop");
+  names.push_back ("modulation_index");
+  expected.resize (names.size(), unknown);
+}
+
+epsic::ensemble::ensemble (const phase_resolved& profile, uint64_t _nsamp,
+                           unsigned ntrial)
+{
+  if (profile.get_nbin() < 2)
+    throw std::runtime_error ("epsic::ensemble - a profile must have at least two bins");
+
+  trials.set_ntrial (ntrial);
+
+  reference = profile.get_reference();
+  nsamp = _nsamp;
+
+  std::vector<simulation_result> results;
+  for (unsigned ibin=0; ibin < profile.get_nbin(); ibin++)
+  {
+    bins.push_back (profile.get_config (ibin));
+    weights.push_back (profile.get_weight (ibin));
+    results.push_back (get_prediction (bins.back()));
+  }
+
+  const double mean_off = results[reference].expected_mean[0];
+  const double var_off = results[reference].expected_covariance[0][0];
+
+  for (unsigned ibin=0; ibin < bins.size(); ibin++)
+  {
+    const string suffix = "_" + std::to_string (ibin);
+    const double mean = results[ibin].expected_mean[0];
+    const double var = results[ibin].expected_covariance[0][0];
+
+    names.push_back ("mean_I" + suffix);
+    expected.push_back (mean);
+
+    names.push_back ("var_I" + suffix);
+    expected.push_back (var);
+
+    names.push_back ("mu2_I" + suffix);
+    expected.push_back (var + mean * mean);
+
+    names.push_back ("covar_IP" + suffix);
+    expected.push_back (unknown);
+
+    if (ibin == reference)
+      continue;
+
+    double mean_src = mean - mean_off;
+
+    names.push_back ("src_mean_I" + suffix);
+    expected.push_back (mean_src);
+
+    names.push_back ("src_var_I" + suffix);
+    expected.push_back (var - var_off - mean_src * mean_off / bins[ibin].sample_size);
+  }
+}
+
+/*
+  Every phase-resolved trial is a separate single-threaded simulation
+  of the profile, with a seed derived as by sweep::get_seed.
+*/
+void epsic::ensemble::run_phase_resolved (unsigned nthread)
+{
+  if (!trials.get_seed())
+  {
+    std::random_device rd;
+    trials.set_seed ((uint64_t(rd()) << 32) | rd());
+  }
+
+  values.assign (trials.get_ntrial(), std::vector<double> ());
+
+  std::vector<work_stealing_pool::task> tasks;
+
+  for (unsigned itrial=0; itrial < trials.get_ntrial(); itrial++)
+    tasks.push_back ([this, itrial]
+    {
+      phase_resolved profile;
+      for (unsigned ibin=0; ibin < bins.size(); ibin++)
+        profile.add (bins[ibin], weights[ibin]);
+
+      profile.set_reference (reference);
+      profile.set_seed (trials.get_seed (0, itrial));
+      profile.run (nsamp);
+
+      std::vector<double>& estimates = values[itrial];
+
+      for (unsigned ibin=0; ibin < bins.size(); ibin++)
+      {
+        simulation_result result = profile.get_result (ibin);
+        moment_accumulator<2> intensities = profile.get_intensity_moments (ibin);
+
+        double mean = result.get_mean()[0];
+        double var = result.get_covariance()[0][0];
+
+        estimates.push_back (mean);
+        estimates.push_back (var);
+        estimates.push_back (var + mean * mean);
+        estimates.push_back (intensities.get_covariance()[0][1]);
+
+        if (ibin == reference)
+          continue;
+
+        estimates.push_back (profile.get_source_mean(ibin)[0]);
+        estimates.push_back (profile.get_source_variance(ibin));
+      }
+    });
+
+  work_stealing_pool pool (nthread);
+  pool.run (tasks);
+}
+
+void epsic::ensemble::run (unsigned nthread)
+{
+  if (bins.size())
+  {
+    run_phase_resolved (nthread);
+    return;
+  }
+
+  trials.run (nthread);
+
+  values.clear ();
+  for (auto& trial : trials.get_trials())
+  {
+    std::vector<double> estimates;
+
+    for (unsigned i=0; i<4; i++)
+      estimates.push_back (trial.mean[i]);
+
+    for (unsigned i=0; i<4; i++)
+      for (unsigned j=i; j<4; j++)
+        estimates.push_back (trial.covariance[i][j]);
+
+    estimates.push_back (trial.degree_of_polarization);
+    estimates.push_back (sqrt(trial.covariance[0][0]) / trial.mean[0]);
+
+    values.push_back (estimates);
+  }
+}
+
+unsigned epsic::ensemble::get_index (const std::string& name) const
+{
+  for (unsigned i=0; i<names.size(); i++)
+    if (names[i] == name)
+      return i;
+
+  throw std::runtime_error ("epsic::ensemble::get_index - no estimator named " + name);
+}
+
+double epsic::ensemble::get_mean (unsigned i) const
+{
+  double sum = 0;
+  for (auto& trial : values)
+    sum += trial.at(i);
+
+  return values.size() ? sum / values.size() : 0.0;
+}
+
+double epsic::ensemble::get_stddev (unsigned i) const
+{
+  if (values.size() < 2)
+    return 0.0;
+
+  double mean = get_mean (i);
+  double sum = 0;
+  for (auto& trial : values)
+    sum += (trial.at(i) - mean) * (trial.at(i) - mean);
+
+  return sqrt (sum / (values.size() - 1));
+}
+
+void epsic::ensemble::write_csv (std::ostream& os) const
+{
+  for (unsigned i=0; i<names.size(); i++)
+    os << (i ? "," : "") << names[i];
+  os << '\n';
+
+  os.precision (17);
+  for (auto& trial : values)
+  {
+    for (unsigned i=0; i<trial.size(); i++)
+      os << (i ? "," : "") << trial[i];
+    os << '\n';
+  }
+}
+
+void epsic::ensemble::write_binary (std::ostream& os) const
+{
+  uint32_t nestimator = names.size();
+  uint32_t ntrial = values.size();
+
+  os.write (magic, sizeof(magic));
+  os.write (reinterpret_cast<const char*>(&nestimator), sizeof(nestimator));
+  os.write (reinterpret_cast<const char*>(&ntrial), sizeof(ntrial));
+
+  for (auto& name : names)
+    os.write (name.c_str(), name.size() + 1);
+
+  for (auto& trial : values)
+    os.write (reinterpret_cast<const char*>(trial.data()), trial.size() * sizeof(double));
+}
+
+epsic::ensemble::ensemble (std::istream& is)
+{
+  char header[sizeof(magic)];
+  uint32_t nestimator = 0;
+  uint32_t ntrial = 0;
+
+  is.read (header, sizeof(header));
+  is.read (reinterpret_cast<char*>(&nestimator), sizeof(nestimator));
+  is.read (reinterpret_cast<char*>(&ntrial), sizeof(ntrial));
+
+  if (!is || memcmp (header, magic, sizeof(magic)) != 0)
+    throw std::runtime_error ("epsic::ensemble - invalid binary header");
+
+  for (unsigned i=0; i<nestimator; i++)
+  {
+    string name;
+    std::getline (is, name, '\0');
+    names.push_back (name);
+  }
+
+  trials.set_ntrial (ntrial);
+  expected.resize (nestimator, unknown);
+  reference = 0;
+  nsamp = 0;
+
+  values.resize (ntrial, std::vector<double> (nestimator));
+  for (auto& trial : values)
+    is.read (reinterpret_cast<char*>(trial.data()), nestimator * sizeof(double));
+
+  if (!is)
+    throw std::runtime_error ("epsic::ensemble - binary data truncated");
+}
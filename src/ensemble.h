@@ -0,0 +1,125 @@
+//-*-C++-*-
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+//! @file epsic/src/ensemble.h
+
+#ifndef __epsic_ensemble_h
+#define __epsic_ensemble_h
+
+#include "sweep.h"
+#include "phase_resolved.h"
+
+#include <string>
+#include <istream>
+
+namespace epsic
+{
+  //! The distribution of estimators over independent trials of a simulation
+  /*! Each trial computes the following estimators from its Stokes samples:
+    the mean of each Stokes parameter (mean_I ... mean_V), the ten unique
+    elements of their covariance matrix (covar_II, covar_IQ, ... covar_VV),
+    the mean degree of polarization (dop) and the modulation index
+    (modulation_index).  The estimates of every trial are kept, so that
+    the mean and standard deviation of each estimator can be computed.
+
+    Each trial of a phase-resolved ensemble simulates every bin of a
+    pulse profile, and computes the following estimators for each bin,
+    where the suffix _b is the index of the bin: the mean and variance
+    of the total intensity (mean_I_b and var_I_b), its second moment
+    about zero (mu2_I_b = var_I_b + mean_I_b^2), and the covariance of
+    the polarized and total intensity (covar_IP_b).  For each bin other
+    than the off-pulse reference, the mean and variance of the total
+    intensity of the source (src_mean_I_b and src_var_I_b) are computed
+    as by phase_resolved::get_source_mean and get_source_variance.
+
+    The estimates may be written as text with comma-separated values,
+    or as binary data in the following format (native byte order):
+
+      char[8]    "EPSICENS"
+      uint32_t   number of estimators, M
+      uint32_t   number of trials, K
+      M strings  names of the estimators, each terminated by a null
+      K*M double estimates, ordered by trial then estimator
+  */
+  class ensemble
+  {
+    sweep trials;
+    std::vector<std::string> names;
+
+    //! the expected value of each estimator (NaN if unknown)
+    std::vector<double> expected;
+
+    //! the estimates of each trial
+    std::vector< std::vector<double> > values;
+
+    //! the configuration and weight of each bin of a phase-resolved trial
+    std::vector<simulation_config> bins;
+    std::vector<double> weights;
+    unsigned reference;
+
+    //! number of Stokes samples simulated by each phase-resolved trial
+    uint64_t nsamp;
+
+    //! Run every phase-resolved trial
+    void run_phase_resolved (unsigned nthread);
+
+  public:
+
+    //! Construct an ensemble of ntrial simulations of nsamp Stokes samples
+    ensemble (const simulation_config&, uint64_t nsamp, unsigned ntrial);
+
+    //! Construct an ensemble of ntrial phase-resolved simulations of nsamp Stokes samples
+    /*! The bins, their weights and the reference bin are copied from profile. */
+    ensemble (const phase_resolved& profile, uint64_t nsamp, unsigned ntrial);
+
+    //! Construct from binary data written by write_binary
+    ensemble (std::istream&);
+
+    //! Set the seed from which the seed of each trial is derived (0 = random)
+    void set_seed (uint64_t seed) { trials.set_seed (seed); }
+
+    //! Return the seed, which is resolved when the trials are first run
+    uint64_t get_seed () const { return trials.get_seed(); }
+
+    //! Run every trial using nthread threads
+    void run (unsigned nthread);
+
+    //! Return the number of trials
+    unsigned get_ntrial () const { return trials.get_ntrial(); }
+
+    //! Return the number of estimators computed by each trial
+    unsigned get_nestimator () const { return names.size(); }
+
+    //! Return the name of the specified estimator
+    const std::string& get_name (unsigned i) const { return names.at(i); }
+
+    //! Return the index of the named estimator
+    unsigned get_index (const std::string& name) const;
+
+    //! Return the estimate of the specified trial
+    double get_value (unsigned trial, unsigned i) const { return values.at(trial).at(i); }
+
+    //! Return the mean of the estimates over all trials
+    double get_mean (unsigned i) const;
+
+    //! Return the sample standard deviation of the estimates over all trials
+    double get_stddev (unsigned i) const;
+
+    //! Return the expected value of the estimator, or NaN if unknown
+    double get_expected (unsigned i) const { return expected.at(i); }
+
+    //! Write one line of comma-separated estimates per trial, after the names
+    void write_csv (std::ostream&) const;
+
+    //! Write the estimates in the binary format described above
+    void write_binary (std::ostream&) const;
+  };
+
+} // end of namespace epsic
+
+#endif // ! defined __epsic_ensemble_h
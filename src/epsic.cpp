@@ -29,6 +29,16 @@
 #include "smoothed.h"
 #include "sample.h"
 #include "covariant.h"
+#include "moments.h"
+#include "statistic.h"
+#include "simulation.h"
+#include "sweep.h"
+#include "ensemble.h"
+#include "phase_resolved.h"
+#include "stokes_store.h"
+#include "stokes_stream.h"
+#include "voltage_file.h"
+#include "SIMD.h"
 
 #if HAVE_HEALPIX
 #include "healpix_map.h"
@@ -40,12 +50,19 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <getopt.h>
 #include <inttypes.h>
 #include <string.h>
 #include <exception>
 #include <fstream>
 #include <string>
 #include <cassert>
+#include <thread>
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <algorithm>
+#include <cmath>
 
 // #define _DEBUG 1
 
@@ -60,6 +77,10 @@ void usage ()
 
     "simpol: simulate polarized noise and compute statistics \n" 
     " \n"
+    "usage: epsic [options] \n"
+    "       epsic sweep [options] (run epsic sweep -h for details) \n"
+    "       epsic analyze [options] file (run epsic analyze -h for details) \n"
+    " \n"
     "options: \n"
     " \n"
     " -N Msamp    number of Mega (2^20) Stokes samples [default:1]\n"
@@ -74,11 +95,40 @@ void usage ()
     " -l beta     modulation index of log-normal amplitude modulation \n"
     " -b Nsamp    box-car smooth the amplitude modulation function \n"
     " -r Nsamp    use rectangular impulse amplitude modulation function \n"
+    " -V file[,format[,offset]]  read the fields of the mode from a file of \n"
+    "             dual-polarization baseband data, where format is int8, \n"
+    "             int16 or float32 [default:int8] and offset is the number \n"
+    "             of header bytes [default:0]; Msamp defaults to all of the data\n"
+    "             (prefix the argument with B: to read the fields of mode B)\n"
     " -k cov      covariant modulation intensities \n"
     " -X Nlag     compute cross-covariance matrices up to Nlag-1 \n"
     " -t          report only theoretical predictions \n"
     " -d          report the means and variances of the Stokes parameters \n"
-    " -f          print the sample-mean Stokes parameters to stokes.txt \n"
+    " -f          write the sample-mean Stokes parameters to stokes.dat \n"
+    " -F format   format of -f output: float32, float64, or text (stokes.txt)\n"
+    "             [default:float32] \n"
+    " -Z          compress the binary -f output with zlib \n"
+    " -Q nbit     write Msamp*2^20 instances of the field of the mode, quantized\n"
+    "             to 2, 4 or 8 bits, to voltages.dat instead of computing \n"
+    "             statistics \n"
+    " -I          simulate every instance of unmodulated modes \n"
+    " -U          use statically composed pipelines of modulated modes \n"
+    " -u          use the run-time composition of modulated modes [default]\n"
+    " -v          report the SIMD instruction set and mode composition \n"
+    " -j Nthread  number of simulation threads [default:1]\n"
+    " -z seed     seed of the random number generator [default:random]\n"
+    " -E Ntrial   report the mean and standard deviation of each estimator \n"
+    "             over Ntrial independent trials of Msamp samples \n"
+    "             (of every bin of the profile, if combined with -P) \n"
+    " -O file     write the estimates of each trial to file \n"
+    "             (comma-separated values if file ends in .csv, else binary)\n"
+    " -P delta    simulate on-pulse and unit off-pulse bins with duty cycle delta\n"
+    " -P file     simulate a profile of bins with mean Stokes i q u v on each line\n"
+    " -K file     periodically write the state of the simulation to file \n"
+    "             (also --checkpoint file) \n"
+    " --checkpoint-interval sec   seconds between checkpoints [default:600]\n"
+    " --resume    resume from the checkpoint file, if it exists, and simulate \n"
+    "             the remainder of the Msamp samples \n"
 #if HAVE_HEALPIX
     " -H k        compute spherical histogram using 12*4^k HEALPix pixels \n"
     " -w 1|p|I    weight each count by unity, polarized flux, or total flux \n"
@@ -86,105 +136,965 @@ void usage ()
        << endl;
 }
 
-class mode_setup
+double sqr (double x) { return x*x; }
+
+typedef std::complex<double> complex_t;
+
+//! Rearrange the covariance of flatten(rho) as the mean of direct(rho,rho)
+Matrix<4,4, complex_t> kronecker (const Matrix<4,4, complex_t>& covar)
 {
+  Matrix<4,4, complex_t> result;
+  for (unsigned ar=0; ar<2; ar++)
+    for (unsigned ac=0; ac<2; ac++)
+      for (unsigned br=0; br<2; br++)
+        for (unsigned bc=0; bc<2; bc++)
+          result[ar*2+br][ac*2+bc] = covar[ar*2+ac][br*2+bc];
+  return result;
+}
+
+//! Weight each count by unity, polarized flux, or total flux
+typedef enum { Unity, PolarizedFlux, TotalFlux } Weight;
+
+#if HAVE_HEALPIX
+
+//! Histogram of the orientation of the polarization vector
+class healpix_histogram : public epsic::statistic
+{
+  Weight weight;
+  Healpix_Map<double> healpix_map;
+
 public:
-  // population mean Stokes parameters
-  Stokes<double> mean;
-  // box-car smoothing width pre-detection
-  unsigned smooth_before;
-  // box-car smoothing of modulation function
-  unsigned smooth_modulator;
-  // width of square modulation function
-  unsigned square_modulator;
-  // modulation index of log-normal modulation function
-  double beta;
-  // sample size
-  unsigned nint;
-  
-  // manages covariant modes
-  epsic::bivariate_lognormal_modes* covariant;
 
-  mode_setup () : mean (1,0,0,0)
+  healpix_histogram (int order, const string& scheme, Weight _weight)
+  {
+    weight = _weight;
+    healpix_map.Set ( order, string2HealpixScheme(scheme) );
+    healpix_map.fill( 0.0 );
+  }
+
+  healpix_histogram* clone () const { return new healpix_histogram (*this); }
+
+  void consume (const Vector<4, double>* block, unsigned n)
+  {
+    for (unsigned i=0; i<n; i++)
+    {
+      const Vector<4, double>& s = block[i];
+      const vec3 pol = vec3 (s[1], s[2], s[3]);
+      double count = 1.0;
+      if (weight == PolarizedFlux)
+        count = sqrt( sqr(s[1]) + sqr(s[2]) + sqr(s[3]) );
+      else if (weight == TotalFlux)
+        count = s[0];
+      healpix_map[healpix_map.vec2pix( pol )] += count;
+    }
+  }
+
+  void combine (const epsic::statistic& _that)
+  {
+    const healpix_histogram& that = dynamic_cast<const healpix_histogram&> (_that);
+    for (int ipix=0; ipix < healpix_map.Npix(); ipix++)
+      healpix_map[ipix] += that.healpix_map[ipix];
+  }
+
+  void save (std::ostream& os) const
+  {
+    epsic::write_binary (os, int64_t (healpix_map.Npix()));
+    for (int ipix=0; ipix < healpix_map.Npix(); ipix++)
+      epsic::write_binary (os, healpix_map[ipix]);
+  }
+
+  void load (std::istream& is)
+  {
+    int64_t npix = 0;
+    epsic::read_binary (is, npix);
+    if (npix != healpix_map.Npix())
+      throw std::runtime_error ("healpix_histogram::load - different number of pixels");
+
+    for (int ipix=0; ipix < healpix_map.Npix(); ipix++)
+      epsic::read_binary (is, healpix_map[ipix]);
+  }
+
+  const Healpix_Map<double>& get_map () const { return healpix_map; }
+};
+
+#endif
+
+//! Simulate an ensemble of independent trials and report each estimator
+/*! The trials are run on the threads requested by -j, starting from the
+  seed requested by -z. */
+int run_ensemble (epsic::ensemble& trials, const epsic::simulation_config& config,
+                  uint64_t nsamp, const string& output)
+{
+  const unsigned ntrial = trials.get_ntrial();
+
+  trials.set_seed (config.seed);
+  trials.run (config.nthread);
+
+  cerr << "Simulated " << ntrial << " trials of " << nsamp
+       << " Stokes samples with seed=" << trials.get_seed() << endl;
+
+  cerr << "\n"
+    " ******************************************************************* \n"
+    "\n"
+    " ENSEMBLE OF " << ntrial << " TRIALS \n"
+    "\n"
+    " ******************************************************************* \n"
+       << endl;
+
+  cout << "estimator mean stddev expected" << endl;
+
+  for (unsigned i=0; i<trials.get_nestimator(); i++)
+  {
+    cout << trials.get_name(i) << " " << trials.get_mean(i)
+         << " " << trials.get_stddev(i) << " ";
+
+    double expected = trials.get_expected (i);
+    if (std::isnan (expected))
+      cout << "-";
+    else
+      cout << expected;
+
+    cout << endl;
+  }
+
+  if (output.empty())
+    return 0;
+
+  bool csv = output.size() > 4 && output.substr (output.size()-4) == ".csv";
+
+  std::ofstream os (output.c_str(), csv ? std::ios::out : std::ios::binary);
+  if (!os)
+  {
+    cerr << "epsic: could not open " << output << endl;
+    return -1;
+  }
+
+  if (csv)
+    trials.write_csv (os);
+  else
+    trials.write_binary (os);
+
+  cerr << "epsic: estimates of each trial written to " << output << endl;
+  return 0;
+}
+
+//! Add the bins of a pulse profile
+/*! The profile is either the duty cycle of an on-pulse bin, configured
+  by the other options, and an off-pulse bin of unpolarized noise with
+  unit intensity; or a file with the mean Stokes parameters of mode A in
+  each of a number of equally weighted bins. */
+int add_profile (epsic::phase_resolved& bins,
+                 const epsic::simulation_config& config, const string& profile)
+{
+  char* end = 0;
+  double duty_cycle = strtod (profile.c_str(), &end);
+
+  if (*end == '\0')
+    bins.add_on_off (config, duty_cycle);
+  else
+  {
+    std::ifstream in (profile.c_str());
+    if (!in)
+    {
+      cerr << "epsic: could not open " << profile << endl;
+      return -1;
+    }
+
+    double i, q, u, v;
+    while (in >> i >> q >> u >> v)
+    {
+      epsic::simulation_config bin = config;
+      bin.A.mean = Stokes<double> (i,q,u,v);
+      bins.add (bin);
+    }
+
+    if (bins.get_nbin() < 2)
+    {
+      cerr << "epsic: " << profile << " must define at least two bins" << endl;
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+//! Simulate every bin of a pulse profile and report the statistics of each
+int run_phase_resolved (const epsic::simulation_config& config,
+                        const string& profile, uint64_t nsamp,
+                        bool run_simulation)
+{
+  epsic::phase_resolved bins;
+
+  if (add_profile (bins, config, profile) < 0)
+    return -1;
+
+  bins.set_nthread (config.nthread);
+  bins.set_seed (config.seed);
+
+  if (run_simulation)
   {
-    smooth_before = 0;
-    smooth_modulator = 0;
-    square_modulator = 0;
-    beta = 0;
-    covariant = 0;
-    nint = 1;
+    bins.run (nsamp);
+    cerr << "Simulated " << nsamp << " Stokes samples in " << bins.get_nbin()
+         << " phase bins with seed=" << bins.get_seed() << endl;
   }
+  else
+    bins.run (0);
+
+  cerr << "epsic: off-pulse reference is bin " << bins.get_reference() << endl;
+
+  cout << "bin weight count mean_I mean_Q mean_U mean_V"
+    " var_I var_Q var_U var_V src_mean_I src_var_I" << endl;
 
-  epsic::mode* setup_mode (epsic::mode* s, unsigned index = 0)
+  for (unsigned ibin=0; ibin < bins.get_nbin(); ibin++)
   {
-    epsic::modulated_mode* mod = 0;
+    epsic::simulation_result result = bins.get_result (ibin);
 
-    if (s)
-      s->set_Stokes (mean);
+    Vector<4,double> mean = result.expected_mean;
+    Matrix<4,4,double> covariance = result.expected_covariance;
 
-    if (covariant)
+    if (run_simulation)
     {
-      if (beta != 0.0)
-        covariant->set_beta (index, beta);
-      s = mod = covariant->get_modulated_mode (index, s);
+      mean = result.get_mean ();
+      covariance = result.get_covariance ();
     }
-    else if (beta != 0.0)
-      s = mod = new epsic::lognormal_mode (s, beta);
 
-    if (smooth_modulator > 1 && mod)
-      s = new epsic::boxcar_modulated_mode (mod, smooth_modulator);
+    cout << ibin << " " << bins.get_weight (ibin) << " " << result.get_count();
 
-    if (square_modulator > 1 && mod)
-      s = new epsic::square_modulated_mode (mod, square_modulator, nint);
+    for (unsigned i=0; i<4; i++)
+      cout << " " << mean[i];
+    for (unsigned i=0; i<4; i++)
+      cout << " " << covariance[i][i];
+
+    if (run_simulation)
+      cout << " " << bins.get_source_mean(ibin)[0]
+           << " " << bins.get_source_variance(ibin);
+    else
+      cout << " - -";
 
-    if (smooth_before > 1)
-      s = new epsic::boxcar_mode (s, smooth_before);
+    cout << endl;
+  }
+
+  return 0;
+}
+
+//! Write the state of the simulation to a checkpoint file
+/*! The checkpoint is first written to a temporary file, which replaces
+  the previous checkpoint only when complete. */
+void write_checkpoint (epsic::simulation& sim, const string& filename)
+{
+  string temporary = filename + ".tmp";
+
+  {
+    std::ofstream os (temporary.c_str(), std::ios::binary);
+    if (!os)
+      throw std::runtime_error ("epsic: could not open " + temporary);
+
+    sim.save (os);
+  }
+
+  if (rename (temporary.c_str(), filename.c_str()) != 0)
+    throw std::runtime_error ("epsic: could not rename " + temporary
+                              + " to " + filename);
+}
+
+//! Simulate a total of nsamp Stokes samples, periodically writing a checkpoint
+void run_checkpointed (epsic::simulation& sim, uint64_t nsamp,
+                       const string& filename, double interval)
+{
+  // the number of samples simulated between tests of the elapsed time
+  const uint64_t step = 4 * 1024 * 1024 * uint64_t(sim.get_config().nthread);
+
+  auto last = std::chrono::steady_clock::now ();
+
+  while (sim.get_nsamp() < nsamp)
+  {
+    sim.run (std::min (step, nsamp - sim.get_nsamp()));
 
-    return s;
+    auto now = std::chrono::steady_clock::now ();
+    std::chrono::duration<double> elapsed = now - last;
+
+    if (elapsed.count() >= interval || sim.get_nsamp() == nsamp)
+    {
+      write_checkpoint (sim, filename);
+      last = now;
+    }
+  }
+}
+
+//! Write ninstance quantized instances of the field of the single mode to voltages.dat
+int run_voltages (epsic::simulation& sim, unsigned nbit, uint64_t ninstance,
+                  int argc, char** argv)
+{
+  auto single = dynamic_cast<epsic::single*> (sim.get_sample());
+  if (!single)
+  {
+    cerr << "Cannot write the voltages (-Q) of a combination of modes" << endl;
+    return -1;
+  }
+
+  epsic::voltage_file_header header;
+  header.nbit = nbit;
+  header.seed = sim.get_config().seed;
+
+  // the command line describes the configuration
+  for (int iarg=0; iarg < argc; iarg++)
+    header.config += (iarg ? " " : "") + string (argv[iarg]);
+
+  unsigned nthread = sim.get_config().nthread;
+
+  cerr << "Writing " << ninstance << " " << nbit << "-bit field instances "
+       << "with seed=" << header.seed << " to voltages.dat" << endl;
+
+  auto start = std::chrono::steady_clock::now ();
+
+  epsic::voltage_writer writer ("voltages.dat", header);
+  writer.write (single->source, ninstance, nthread);
+  writer.close ();
+
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now () - start;
+
+  double nbyte = ninstance * nbit / 2;
+  cerr << "Wrote " << nbyte / (1024*1024) << " MB in " << elapsed.count()
+       << " s (" << nbyte / (1024*1024) / elapsed.count() << " MB/s)" << endl;
+
+  return 0;
+}
+
+//! Report the statistics of the Stokes samples and write the -X, -H and -R output
+/*! Shared by epsic and epsic analyze.  The simulated statistics are
+  reported if simulated is set, and the expected values if expected is
+  set; the covariance of the Stokes parameters is passed separately,
+  because epsic -o reports it about the population mean.  With -d, the
+  means and variances are reported to the standard output instead of
+  the STOKES PARAMETERS report; the -X, -H and -R output is unchanged. */
+void report (const epsic::simulation_result& result,
+             const Matrix<4,4,double>& covariance,
+             bool simulated, bool expected, bool variances_and_means,
+             bool rho_stats, const epsic::statistic* histogram)
+{
+  const Vector<4, double>& tot = result.get_mean();
+
+  if (variances_and_means)
+  {
+    for (unsigned i=0; i<4; i++)
+    {
+      cout << "mean[" << i << "] = " << tot[i] << endl;
+      cout << "var[" << i << "] = " << covariance[i][i] << endl;
+    }
+  }
+  else
+  {
+    cerr << "\n"
+      " ******************************************************************* \n"
+      "\n"
+      " STOKES PARAMETERS \n"
+      "\n"
+      " ******************************************************************* \n"
+         << endl;
+
+    if (simulated)
+    {
+      cerr << "mean sample dop=" << result.degree_of_polarization << endl << endl;
+      cerr << "modulation index=" << result.get_modulation_index() << endl << endl;
+
+      cerr << "mean=" << tot << endl;
+      if (expected)
+        cerr << "expected=" << result.expected_mean << endl;
+
+      cerr << "\ncovar=\n" << covariance << endl;
+      if (expected)
+        cerr << "expected=\n" << result.expected_covariance << endl;
+    }
+  }
+
+  unsigned nlag = std::max (result.acf.size(), result.expected_acf.size());
+
+  if (nlag)
+  {
+    cerr << "ACF output in acf.txt and acf_plot.txt" << endl;
+
+    std::ofstream out ("acf.txt");
+    std::ofstream plot ("acf_plot.txt");
+
+    for (unsigned ilag=0; ilag<nlag; ilag++)
+    {
+      out << "============================================================\n"
+            "lag=" << ilag << endl;
+      if (simulated)
+        out << "mean=" << result.acf[ilag] << endl;
+      if (expected)
+        out << "expected=" << result.expected_acf[ilag] << endl;
+
+      plot << ilag << " ";
+      for (unsigned i=0; i<4; i++)
+      {
+        for (unsigned j=0; j<4; j++)
+        {
+          if (expected)
+            plot << result.expected_acf[ilag][i][j] << " ";
+          if (simulated)
+            plot << result.acf[ilag][i][j] << " ";
+        }
+      }
+      plot << endl;
+    }
+  }
+
+#if HAVE_HEALPIX
+  if (histogram)
+  {
+    auto map = dynamic_cast<const healpix_histogram*> (histogram);
+    string out_name = "healpix.fits";
+    unlink (out_name.c_str());
+    write_Healpix_map_to_fits ( out_name, map->get_map(), PLANCK_FLOAT64 );
+  }
+#else
+  // without HEALPix, no histogram is computed
+  (void) histogram;
+#endif
+
+  if (!rho_stats)
+    return;
+
+  cerr << "\n"
+    " ******************************************************************* \n"
+    "\n"
+    " COHERENCY MATRIX \n"
+    "\n"
+    " ******************************************************************* \n"
+       << endl;
+
+  const Vector<4, complex_t>& mean_rho = result.coherency.get_mean();
+  Matrix<2,2, complex_t> tot_rho;
+  tot_rho[0][0] = mean_rho[0];
+  tot_rho[0][1] = mean_rho[1];
+  tot_rho[1][0] = mean_rho[2];
+  tot_rho[1][1] = mean_rho[3];
+
+  Matrix<4,4, complex_t> totsq_rho = kronecker (result.coherency.get_covariance());
+
+  Matrix<4,4, complex_t> sq_rho = totsq_rho;
+  sq_rho += direct(tot_rho,tot_rho);
+
+  cerr << "rho sq=\n" << sq_rho << endl;
+
+  cerr << "rho mean=\n" << tot_rho << endl;
+  cerr << "rho covar=\n" << totsq_rho << endl;
+
+  if (!expected)
+    return;
+
+  Matrix<4,4, std::complex<double> > candidate;
+  for (unsigned i=0; i<4; i++)
+    for (unsigned j=0; j<4; j++)
+      {
+        Matrix<4,4,std::complex<double> > temp = Dirac::matrix (i,j);
+        temp *= result.expected_covariance[i][j] * 0.25;
+
+        candidate += temp;
+      }
+
+  cerr << "candidate=\n" << candidate << endl;
+
+  Matrix<4, 4, std::complex<double> > eigenvectors;
+  Vector<4, double> eigenvalues;
+
+  Matrix<4, 4, std::complex<double> > temp = candidate;
+  Jacobi (temp, eigenvectors, eigenvalues);
+
+  for (unsigned i=0; i<4; i++)
+    cerr << "e_" << i << "=" << eigenvalues[i] << "  v=" << eigenvectors[i] << endl;
+}
+
+void analyze_usage ()
+{
+  cout <<
+
+    "epsic analyze: compute statistics of previously simulated Stokes samples \n"
+    " \n"
+    "usage: epsic analyze [options] file \n"
+    " \n"
+    "Unless -F is specified, the file must be uncompressed binary output \n"
+    "of epsic -f.  With -F, or if the file is named -, Stokes samples are \n"
+    "read from a file, a pipe or the standard input. \n"
+    " \n"
+    "options: \n"
+    " \n"
+    " -F format   format of the samples: float32, float64, or text [default:float32]\n"
+    " -n Nint     report the values expected of samples of Nint instances \n"
+    "             [default:the sample size recorded by epsic -f, if known]\n"
+    " -s i,q,u,v  population mean Stokes parameters of the expected values \n"
+    "             [default:the mean of the samples]\n"
+    " -X Nlag     compute cross-covariance matrices up to Nlag-1 \n"
+    " -R          compute the moments of the coherency matrix \n"
+    " -d          report the means and variances of the Stokes parameters \n"
+    " -j Nthread  number of threads used to analyze epsic -f output [default:1]\n"
+#if HAVE_HEALPIX
+    " -H k        compute spherical histogram using 12*4^k HEALPix pixels \n"
+    " -w 1|p|I    weight each count by unity, polarized flux, or total flux \n"
+#endif
+       << endl;
+}
+
+//! Compute statistics of the Stokes samples in a file or stream
+int analyze_main (int argc, char** argv)
+{
+  unsigned nthread = 1;
+  unsigned nlag = 0;
+  bool variances_and_means = false;
+  bool rho_stats = false;
+
+  //! Format of the samples read with -F (empty = output of epsic -f)
+  string format;
+
+  //! Number of instances in each sample (0 = do not report expected values)
+  unsigned sample_size = 0;
+
+  //! Population mean Stokes parameters of the expected values
+  Stokes<double> population_mean;
+  bool population_mean_set = false;
+
+#if HAVE_HEALPIX
+  int healpix_order = 0;
+  string healpix_scheme = "RING";
+  Weight weight = PolarizedFlux;
+#endif
+
+  int c;
+  while ((c = getopt(argc, argv, "dF:hH:j:n:Rs:w:X:")) != -1)
+  {
+    switch (c)
+    {
+    case 'd':
+      variances_and_means = true;
+      break;
+
+    case 'F':
+      format = optarg;
+      epsic::stokes_stream::parse_format (format);
+      break;
+
+    case 'n':
+      sample_size = atoi (optarg);
+      break;
+
+    case 'R':
+      rho_stats = true;
+      break;
+
+    case 's':
+    {
+      double i,q,u,v;
+      if (sscanf (optarg, "%lf,%lf,%lf,%lf", &i,&q,&u,&v) != 4)
+        throw std::runtime_error ("epsic analyze: could not parse "
+                                  + string (optarg) + " as 4-vector");
+      population_mean = Stokes<double> (i,q,u,v);
+      population_mean_set = true;
+      break;
+    }
+
+    case 'h':
+      analyze_usage ();
+      return 0;
+
+#if HAVE_HEALPIX
+    case 'H':
+      healpix_order = atoi (optarg);
+      break;
+
+    case 'w':
+      if (optarg[0] == '1')
+        weight = Unity;
+      else if (optarg[0] == 'I')
+        weight = TotalFlux;
+      else
+        weight = PolarizedFlux;
+      break;
+#endif
+
+    case 'j':
+      nthread = atoi (optarg);
+      if (nthread == 0)
+        throw std::runtime_error ("epsic analyze: invalid number of threads");
+      break;
+
+    case 'X':
+      nlag = atoi (optarg);
+      break;
+
+    default:
+      return -1;
+    }
+  }
+
+  if (optind + 1 != argc)
+  {
+    analyze_usage ();
+    return -1;
+  }
+
+  epsic::statistics sinks;
+
+  sinks.add (new epsic::stokes_moments);
+  sinks.add (new epsic::polarization_degree);
+
+  if (nlag)
+    sinks.add (new epsic::stokes_acf (nlag));
+
+#if HAVE_HEALPIX
+  if (healpix_order > 0)
+    sinks.add (new healpix_histogram (healpix_order, healpix_scheme, weight));
+#endif
+
+  if (rho_stats)
+    sinks.add (new epsic::coherency_moments);
+
+  string filename = argv[optind];
+
+  if (format.empty() && filename != "-")
+  {
+    epsic::stokes_store store (filename);
+
+    cerr << "Analyzing " << store.get_nsamp() << " Stokes samples in "
+         << store.get_nchunk() << " chunks of " << filename << endl;
+    cerr << "simulated by: " << store.get_header().config << endl;
+
+    store.analyze (&sinks, nthread);
+
+    if (!sample_size)
+      sample_size = store.get_header().sample_size;
+  }
+  else
+  {
+    epsic::stokes_stream stream (filename, epsic::stokes_stream::parse_format
+                                 (format.empty() ? "float32" : format));
+
+    uint64_t nsamp = stream.analyze (&sinks);
+    cerr << "Analyzed " << nsamp << " Stokes samples read from "
+         << (filename == "-" ? "the standard input" : filename) << endl;
+  }
+
+  epsic::simulation_result result;
+
+  auto moments = dynamic_cast<const epsic::stokes_moments*> (sinks.get(0));
+  result.stokes = moments->get_moments();
+
+  auto dop = dynamic_cast<const epsic::polarization_degree*> (sinks.get(1));
+  result.degree_of_polarization = dop->get_mean();
+
+  // the statistics expected of samples of normally distributed fields
+  std::unique_ptr<epsic::single> model;
+  if (sample_size)
+  {
+    model.reset (new epsic::single (new epsic::mode));
+    model->source->set_Stokes (population_mean_set ? population_mean
+                               : Stokes<double> (result.get_mean()));
+    model->sample_size = sample_size;
+
+    result.expected_mean = model->get_mean();
+    result.expected_covariance = model->get_covariance();
+  }
+
+  unsigned isink = 2;
+
+  if (nlag)
+  {
+    auto acf = dynamic_cast<const epsic::stokes_acf*> (sinks.get(isink++));
+    for (unsigned ilag=0; ilag<nlag; ilag++)
+    {
+      result.acf.push_back (acf->get_acf(ilag).get_covariance());
+      if (model)
+        result.expected_acf.push_back (model->get_crosscovariance (ilag));
+    }
+  }
+
+  const epsic::statistic* histogram = nullptr;
+
+#if HAVE_HEALPIX
+  if (healpix_order > 0)
+    histogram = sinks.get(isink++);
+#endif
+
+  if (rho_stats)
+  {
+    auto rho = dynamic_cast<const epsic::coherency_moments*> (sinks.get(isink++));
+    result.coherency = rho->get_moments();
+  }
+
+  report (result, result.get_covariance(), true, bool(model),
+          variances_and_means, rho_stats, histogram);
+
+  return 0;
+}
+
+void sweep_usage ()
+{
+  cout <<
+
+    "epsic sweep: simulate trials over a grid of parameters \n"
+    " \n"
+    "Each option accepts a list of values separated by colons; a trial \n"
+    "is simulated for every combination of the values of all options. \n"
+    " \n"
+    "options: \n"
+    " \n"
+    " -N Msamp    number of Mega (2^20) Stokes samples in each trial [default:1]\n"
+    " -n Nint     number of instances in each Stokes sample [default:1] \n"
+    " -S          superposed modes \n"
+    " -C f_A      composite modes with fraction of instances in mode A \n"
+    " -D F_A      disjoint modes with fraction of samples in mode A \n"
+    " -c cov      coherent superposition of modes \n"
+    " -s i,q,u,v  population mean Stokes parameters [default:1,0,0,0]\n"
+    " -l beta     modulation index of log-normal amplitude modulation \n"
+    " -k cov      covariant modulation intensities \n"
+    " -T Ntrial   number of trials at each point of the grid [default:1]\n"
+    " -j Nthread  number of threads [default:1]\n"
+    " -z seed     seed from which the seed of each trial is derived \n"
+    " -o file     write the table of results to file [default:stdout]\n"
+    " \n"
+    "Prefix the argument of -s or -l with B to set the second mode. \n"
+       << endl;
+}
+
+//! Split a list of values separated by colons
+std::vector<string> split (const char* arg)
+{
+  std::vector<string> result;
+  string list = arg;
+  string::size_type start = 0;
+  while (true)
+  {
+    string::size_type end = list.find (':', start);
+    result.push_back (list.substr (start, end - start));
+    if (end == string::npos)
+      return result;
+    start = end + 1;
+  }
+}
+
+//! Replace every point with one copy for each value, set by the function
+template<typename Set>
+void expand (std::vector<epsic::sweep_point>& points,
+             const std::vector<string>& values, Set set)
+{
+  std::vector<epsic::sweep_point> result;
+  for (auto& point : points)
+    for (auto& value : values)
+    {
+      result.push_back (point);
+      set (result.back(), value);
+    }
+  points.swap (result);
+}
+
+//! Run the trials of a parameter sweep in one process
+int sweep_main (int argc, char** argv)
+{
+  epsic::sweep trials;
+  unsigned nthread = 1;
+  string output;
+
+  std::vector<epsic::sweep_point> points (1);
+
+  //! the combinations of modes, which are added to the grid at the end
+  std::vector<epsic::sweep_point> combinations;
+  bool superposed = false;
+
+  auto parse_Stokes = [] (const string& arg)
+  {
+    double i,q,u,v;
+    if (sscanf (arg.c_str(), "%lf,%lf,%lf,%lf", &i,&q,&u,&v) != 4)
+      throw std::runtime_error ("epsic sweep: error parsing " + arg + " as 4-vector");
+
+    Stokes<double> stokes (i,q,u,v);
+    if (stokes.abs_vect() > i)
+      throw std::runtime_error ("epsic sweep: invalid Stokes parameters (p>I) " + arg);
+
+    return stokes;
+  };
+
+  auto add_combination = [&] (epsic::simulation_config::Combination type,
+                              const char* arg)
+  {
+    for (auto& value : split (arg))
+    {
+      epsic::sweep_point point;
+      point.config.combination = type;
+      point.config.combination_parameter = atof (value.c_str());
+      combinations.push_back (point);
+    }
+  };
+
+  int c;
+  while ((c = getopt(argc, argv, "C:c:D:hj:k:l:N:n:o:Ss:T:z:")) != -1)
+  {
+    const char* usearg = optarg;
+    bool mode_B = false;
+
+    if (optarg != nullptr && optarg[0] == 'B')
+    {
+      mode_B = true;
+      usearg ++;
+    }
+
+    switch (c)
+    {
+    case 'h':
+      sweep_usage ();
+      return 0;
+
+    case 'C':
+      add_combination (epsic::simulation_config::Composite, optarg);
+      break;
+
+    case 'c':
+      add_combination (epsic::simulation_config::Coherent, optarg);
+      break;
+
+    case 'D':
+      add_combination (epsic::simulation_config::Disjoint, optarg);
+      break;
+
+    case 'S':
+      superposed = true;
+      break;
+
+    case 'j':
+      nthread = atoi (optarg);
+      if (nthread == 0)
+      {
+        cerr << "Invalid number of threads " << optarg << endl;
+        return -1;
+      }
+      break;
+
+    case 'k':
+      expand (points, split (optarg), [] (epsic::sweep_point& p, const string& v)
+              { p.config.covariant = true; p.config.mode_correlation = atof (v.c_str()); });
+      break;
+
+    case 'l':
+      expand (points, split (usearg), [=] (epsic::sweep_point& p, const string& v)
+              { (mode_B ? p.config.B : p.config.A).beta = atof (v.c_str()); });
+      break;
+
+    case 'N':
+      expand (points, split (optarg), [] (epsic::sweep_point& p, const string& v)
+              {
+                if (v.size() && v.back() == 'k')
+                  p.nsamp = 1024 * atof (v.c_str());
+                else
+                  p.nsamp = 1024 * 1024 * atof (v.c_str());
+              });
+      break;
+
+    case 'n':
+      expand (points, split (optarg), [] (epsic::sweep_point& p, const string& v)
+              { p.config.sample_size = atoi (v.c_str()); });
+      break;
+
+    case 'o':
+      output = optarg;
+      break;
+
+    case 's':
+      expand (points, split (usearg), [=] (epsic::sweep_point& p, const string& v)
+              { (mode_B ? p.config.B : p.config.A).mean = parse_Stokes (v); });
+      break;
+
+    case 'T':
+      trials.set_ntrial (atoi (optarg));
+      break;
+
+    case 'z':
+      trials.set_seed (strtoull (optarg, 0, 0));
+      break;
+
+    default:
+      sweep_usage ();
+      return -1;
+    }
+  }
+
+  if (superposed)
+  {
+    epsic::sweep_point point;
+    point.config.combination = epsic::simulation_config::Superposed;
+    combinations.push_back (point);
+  }
+
+  if (combinations.size())
+  {
+    std::vector<epsic::sweep_point> result;
+    for (auto& point : points)
+      for (auto& combination : combinations)
+      {
+        result.push_back (point);
+        result.back().config.combination = combination.config.combination;
+        result.back().config.combination_parameter
+          = combination.config.combination_parameter;
+      }
+    points.swap (result);
+  }
+
+  for (auto& point : points)
+    trials.add (point);
+
+  cerr << "epsic sweep: simulating " << trials.get_ntrial() << " trials at each of "
+       << trials.get_npoint() << " points using " << nthread << " threads" << endl;
+
+  trials.run (nthread);
+
+  if (output.empty())
+    trials.write (cout);
+  else
+  {
+    std::ofstream os (output.c_str());
+    if (!os)
+    {
+      cerr << "epsic sweep: could not open " << output << endl;
+      return -1;
+    }
+    trials.write (os);
   }
-};
-
-double sqr (double x) { return x*x; }
 
-epsic::combination* dual = NULL;
-epsic::sample* stokes_sample = NULL;
-epsic::bivariate_lognormal_modes* covariant = NULL;
+  return 0;
+}
 
-void cleanup()
+int main (int argc, char** argv)
 {
-  if (dual)
+  if (argc > 1 && strcmp (argv[1], "sweep") == 0) try
   {
-    delete dual;
+    return sweep_main (argc-1, argv+1);
   }
-  else if (stokes_sample)
+  catch (std::exception& error)
   {
-    delete stokes_sample;
+    cerr << error.what() << endl;
+    return -1;
   }
 
-  if (covariant)
-    delete covariant;
-}
+  if (argc > 1 && strcmp (argv[1], "analyze") == 0) try
+  {
+    return analyze_main (argc-1, argv+1);
+  }
+  catch (std::exception& error)
+  {
+    cerr << error.what() << endl;
+    return -1;
+  }
 
-int main (int argc, char** argv)
-{
   bool run_simulation = true;
   
   uint64_t Mega = 1024 * 1024;
   uint64_t Kilo = 1024;
   uint64_t nsamp = Mega;       // number of Stokes samples
-  unsigned nint = 1;           // number of instances in each Stokes sample
-  unsigned nlag = 0;           // number of lags to compute in ACF
-  unsigned smooth_after = 0;   // box-car smoothing width post-detection
+  bool nsamp_set = false;
 
   Stokes<double> stokes = 1.0;
   bool subtract_outer_population_mean = false;
 
-  epsic::mode source;
-
-  mode_setup setup_A;
-  mode_setup setup_B;
+  epsic::simulation_config config;
 
-  bool rho_stats = false;
   bool variances_and_means = false;
 
 #if HAVE_HEALPIX
@@ -194,27 +1104,63 @@ int main (int argc, char** argv)
   //! Ordering scheme of healpix maps
   string healpix_scheme = "RING";
 
-  //! Healpix workers
-  Healpix_Map<double> healpix_map;
-
   //! Weight assigned to each histogram hit
   Weight weight = PolarizedFlux;
 #endif
-
-  //! Weight each count by unity, polarized flux, or total flux
-  typedef enum { Unity, PolarizedFlux, TotalFlux } Weight;
  
   bool output_stokes = false;
+
+  //! Format of the Stokes samples written with -f
+  string stokes_format = "float32";
+
+  //! Compress the chunks of binary Stokes samples
+  bool compress_stokes = false;
+
+  //! Report the configuration of the simulation
+  bool verbose = false;
+
+  //! Number of independent trials in an ensemble (0 = single simulation)
+  unsigned ntrial = 0;
+
+  //! File to which the estimates of each trial are written
+  string ensemble_output;
+
+  //! Duty cycle or file of per-bin Stokes parameters of a pulse profile
+  string profile;
+
+  //! File to which the state of the simulation is periodically written
+  string checkpoint;
+
+  //! Seconds between checkpoints
+  double checkpoint_interval = 600;
+
+  //! Resume from the checkpoint, if it exists
+  bool resume = false;
+
+  //! Bits in each quantized value of the voltages written with -Q (0 = none)
+  unsigned voltage_bits = 0;
+
+  const int checkpoint_interval_option = 256;
+  const int resume_option = 257;
+
+  static struct option long_options[] =
+  {
+    { "checkpoint", required_argument, 0, 'K' },
+    { "checkpoint-interval", required_argument, 0, checkpoint_interval_option },
+    { "resume", no_argument, 0, resume_option },
+    { 0, 0, 0, 0 }
+  };
  
   int c;
-  while ((c = getopt(argc, argv, "fhH:k:N:n:Sc:C:dD:s:l:b:r:X:tw:")) != -1)
+  while ((c = getopt_long(argc, argv, "E:fF:hH:Ij:k:K:N:n:O:P:Q:Sc:C:dD:s:l:b:r:V:X:tuUvw:z:Z",
+                          long_options, 0)) != -1)
   {
     const char* usearg = optarg;
-    mode_setup* setup = &setup_A;
+    epsic::mode_config* setup = &config.A;
     
     if (optarg != nullptr && optarg[0] == 'B')
     {
-      setup = &setup_B;
+      setup = &config.B;
       usearg ++;
     }
     
@@ -225,9 +1171,38 @@ int main (int argc, char** argv)
       output_stokes = true;
       break;
 
+    case 'F':
+      assert(optarg != nullptr);
+      stokes_format = optarg;
+      if (stokes_format != "float32" && stokes_format != "float64"
+          && stokes_format != "text")
+      {
+        cerr << "Invalid format of Stokes samples " << optarg << endl;
+        return -1;
+      }
+      break;
+
+    case 'Q':
+      assert(optarg != nullptr);
+      voltage_bits = atoi (optarg);
+      if (voltage_bits != 2 && voltage_bits != 4 && voltage_bits != 8)
+      {
+        cerr << "Invalid number of bits " << optarg << endl;
+        return -1;
+      }
+      break;
+
+    case 'Z':
+      if (!epsic::stokes_file_compression())
+      {
+        cerr << "Cannot compress Stokes samples (-Z) without zlib" << endl;
+        return -1;
+      }
+      compress_stokes = true;
+      break;
+
     case 'h':
       usage ();
-      cleanup ();
       return 0;
 
 #if HAVE_HEALPIX
@@ -237,6 +1212,16 @@ int main (int argc, char** argv)
       break;
 #endif
 
+    case 'j':
+      assert(optarg != nullptr);
+      config.nthread = atoi (optarg);
+      if (config.nthread == 0)
+      {
+        cerr << "Invalid number of threads " << optarg << endl;
+        return -1;
+      }
+      break;
+
     case 'N':
       assert(optarg != nullptr);
       if (optarg[strlen(optarg)-1] == 'k')
@@ -246,30 +1231,34 @@ int main (int argc, char** argv)
       }
       else
         nsamp = Mega * atof (optarg);
+      nsamp_set = true;
       break;
 
     case 'n':
       assert(optarg != nullptr);
-      nint = atoi (optarg);
+      config.sample_size = atoi (optarg);
       break;
 
     case 'S':
-      dual = new epsic::superposed;
+      config.combination = epsic::simulation_config::Superposed;
       break;
 
     case 'C':
       assert(optarg != nullptr);
-      dual = new epsic::composite( atof(optarg) );
+      config.combination = epsic::simulation_config::Composite;
+      config.combination_parameter = atof (optarg);
       break;
 
     case 'D':
       assert(optarg != nullptr);
-      dual = new epsic::disjoint( atof(optarg) );
+      config.combination = epsic::simulation_config::Disjoint;
+      config.combination_parameter = atof (optarg);
       break;
 
     case 'c':
       assert(optarg != nullptr);
-      dual = new epsic::coherent( atof(optarg) );
+      config.combination = epsic::simulation_config::Coherent;
+      config.combination_parameter = atof (optarg);
       break;
       
     case 's':
@@ -279,7 +1268,6 @@ int main (int argc, char** argv)
       if (sscanf (usearg, "%lf,%lf,%lf,%lf", &i,&q,&u,&v) != 4)
       {
         cerr << "Error parsing " << usearg << " as 4-vector" << endl;
-        cleanup();
         return -1;
       }
       stokes = Stokes<double> (i,q,u,v);
@@ -287,7 +1275,6 @@ int main (int argc, char** argv)
       if (stokes.abs_vect() > i)
       {
         cerr << "Invalid Stokes parameters (p>I) " << stokes << endl;
-        cleanup();
         return -1;
       }
 
@@ -311,23 +1298,95 @@ int main (int argc, char** argv)
       setup->square_modulator = atoi (usearg);
       break;
 
+    case 'V': try
+    {
+      assert(optarg != nullptr);
+
+      // a file name may start with B; therefore, mode B is set with B:
+      setup = &config.A;
+      string arg = optarg;
+      if (arg.compare (0, 2, "B:") == 0)
+      {
+        setup = &config.B;
+        arg.erase (0, 2);
+      }
+      string::size_type comma = arg.find (',');
+      setup->baseband_file = arg.substr (0, comma);
+
+      if (comma != string::npos)
+      {
+        string format = arg.substr (comma+1);
+        string::size_type offset = format.find (',');
+        if (offset != string::npos)
+        {
+          setup->baseband_offset = strtoull (format.c_str() + offset + 1, 0, 0);
+          format.erase (offset);
+        }
+        setup->baseband_format = epsic::file_mode::parse_format (format);
+      }
+
+      // verify that the file exists
+      epsic::file_mode::count_instances (setup->baseband_file,
+                                         setup->baseband_format,
+                                         setup->baseband_offset);
+      break;
+    }
+    catch (std::exception& error)
+    {
+      cerr << error.what() << endl;
+      return -1;
+    }
+
     case 'k':
       assert(optarg != nullptr);
-      covariant = new epsic::bivariate_lognormal_modes( atof(optarg) );
-      setup_A.covariant = covariant;
-      setup_B.covariant = covariant;
+      config.covariant = true;
+      config.mode_correlation = atof (optarg);
       break;
 
     case 'X':
       assert(optarg != nullptr);
-      nlag = atoi (optarg);
+      config.nlag = atoi (optarg);
+      break;
+
+    case 'z':
+      assert(optarg != nullptr);
+      config.seed = strtoull (optarg, 0, 0);
+      break;
+
+    case 'E':
+      assert(optarg != nullptr);
+      ntrial = atoi (optarg);
+      break;
+
+    case 'O':
+      assert(optarg != nullptr);
+      ensemble_output = optarg;
+      break;
+
+    case 'P':
+      assert(optarg != nullptr);
+      profile = optarg;
+      break;
+
+    case 'K':
+      assert(optarg != nullptr);
+      checkpoint = optarg;
+      break;
+
+    case checkpoint_interval_option:
+      assert(optarg != nullptr);
+      checkpoint_interval = atof (optarg);
+      break;
+
+    case resume_option:
+      resume = true;
       break;
 
     /* undocumented and currently unavailable features */
 
     case 'M':
       assert(optarg != nullptr);
-      smooth_after = atoi (optarg);
+      config.smooth_after = atoi (optarg);
       break;
 
     case 'm':
@@ -340,7 +1399,7 @@ int main (int argc, char** argv)
       break;
 
     case 'R':
-      rho_stats = true;
+      config.rho_stats = true;
       break;
 
     case 'd':
@@ -351,6 +1410,22 @@ int main (int argc, char** argv)
       run_simulation = false;
       break;
 
+    case 'I':
+      config.direct_sampling = false;
+      break;
+
+    case 'U':
+      config.compile = true;
+      break;
+
+    case 'u':
+      config.compile = false;
+      break;
+
+    case 'v':
+      verbose = true;
+      break;
+
 #if HAVE_HEALPIX
     case 'w':
       assert(optarg != nullptr);
@@ -374,280 +1449,234 @@ int main (int argc, char** argv)
     }
   }
 
-  source.set_Stokes (stokes);
-
-  // some modulators need to know the sample size
-  setup_A.nint = setup_B.nint = nint;
-  
-  if (dual)
+  if (output_stokes && (config.nthread > 1 || ntrial))
   {
-    stokes_sample = dual;
-
-    dual->A = setup_A.setup_mode (dual->A, 0);
-    dual->B = setup_B.setup_mode (dual->B, 1);
-
-    if (setup_A.covariant)
-      dual->set_intensity_covariance (setup_A.covariant->get_intensity_covariance());
+    cerr << "Cannot print Stokes parameters (-f) using more than one thread "
+      "or in an ensemble of trials (-E)" << endl;
+    return -1;
   }
-  else
-  {
-    epsic::mode* s = setup_A.setup_mode (&source);
 
-    if (smooth_after > 1)
-      stokes_sample = new epsic::boxcar_sample (s, smooth_after);
-    else
-      stokes_sample = new epsic::single(s);
+  if (resume && checkpoint.empty())
+  {
+    cerr << "Cannot resume (--resume) without a checkpoint file (-K)" << endl;
+    return -1;
   }
 
-  stokes_sample->sample_size = nint;
-
-  if (run_simulation)
-    cerr << "Simulating " << nsamp << " Stokes samples" << endl;
-
-  random_init ();
-  BoxMuller gasdev (time(NULL));
-
-  if (covariant)
-    covariant->set_normal (&gasdev);
-
-  if (dual)
-    dual->set_normal (&gasdev);
-  else
-    source.set_normal (&gasdev);
-    
-  uint64_t ntot = 0;
-  uint64_t ntot_lag = 0;
-  
-  double totp = 0;
-  Vector<4, double> tot;
-  Matrix<4,4, double> totsq;
-
-  Matrix<2,2, std::complex<double> > tot_rho;
-  Matrix<4,4, std::complex<double> > totsq_rho;
-
-  std::vector< Matrix<4,4, double> > acf (nlag);
-  std::vector< Vector<4, double> > samples (nlag);
-  unsigned current_sample = 0;
-
-#if HAVE_HEALPIX
-  if (healpix_order > 0)
+  if (!checkpoint.empty() && (ntrial || output_stokes || !profile.empty()))
   {
-    healpix_map.Set ( healpix_order, string2HealpixScheme(healpix_scheme) );
-    healpix_map.fill( 0.0 );
+    cerr << "Cannot checkpoint (-K) with -E, -f or -P" << endl;
+    return -1;
   }
-#endif
 
-  std::ofstream outfile;
-  if (output_stokes)
-    outfile.open ("stokes.txt");
+  bool baseband = !config.A.baseband_file.empty() || !config.B.baseband_file.empty();
 
-  for (uint64_t idat=0; run_simulation && idat<nsamp; idat++)
+  if (voltage_bits && (baseband || ntrial || output_stokes || !checkpoint.empty()
+                       || !profile.empty()))
   {
-    Vector<4, double> mean_stokes;
-
-    mean_stokes = stokes_sample->get_Stokes();
+    cerr << "Cannot write voltages (-Q) with -V, -E, -f, -K or -P" << endl;
+    return -1;
+  }
 
-    if (output_stokes)
-      outfile << mean_stokes[0] << " "
-              << mean_stokes[1] << " "
-              << mean_stokes[2] << " " 
-              << mean_stokes[3] << " " << endl;
+  if (baseband && (ntrial || !checkpoint.empty() || !profile.empty()))
+  {
+    cerr << "Cannot read baseband data (-V) with -E, -K or -P" << endl;
+    return -1;
+  }
 
-    tot += mean_stokes;
-    totsq += outer(mean_stokes, mean_stokes);
-    ntot ++;
+  // by default, form as many Stokes samples as there are in the data
+  if (baseband && !nsamp_set)
+  {
+    nsamp = std::numeric_limits<uint64_t>::max();
+    for (auto setup : { &config.A, &config.B })
+      if (!setup->baseband_file.empty())
+        nsamp = std::min (nsamp, epsic::file_mode::count_instances
+                          (setup->baseband_file, setup->baseband_format,
+                           setup->baseband_offset) / config.sample_size);
+  }
 
-    if (nlag)
+  if (!profile.empty())
+  {
+    if (output_stokes || config.nlag)
     {
-      samples[current_sample] = mean_stokes;
-      current_sample ++;
-      if (current_sample == nlag)
-        current_sample = 0;
-
-      if (ntot >= nlag)
-      {
-        Vector<4, double> Sj = samples[current_sample];
-        for (unsigned ilag=0; ilag<nlag; ilag++)
-        {
-          Vector<4, double> Si = samples[(current_sample+ilag)%nlag];
-          acf[ilag] += outer(Si,Sj);
-        }
-
-        ntot_lag++;
-      }
+      cerr << "Cannot combine a pulse profile (-P) with -f or -X" << endl;
+      return -1;
     }
-    
-    double psq = sqr(mean_stokes[1])+sqr(mean_stokes[2])+sqr(mean_stokes[3]);
-    totp += sqrt(psq)/mean_stokes[0];
-      
-    if (rho_stats)
+
+    try
     {
-      Matrix<2,2, std::complex<double> > rho = convert (Stokes<double>(mean_stokes));
-    
-      tot_rho += rho;
-      totsq_rho += direct (rho, rho);
-    }
+      if (!ntrial)
+        return run_phase_resolved (config, profile, nsamp, run_simulation);
 
-#if HAVE_HEALPIX
+      epsic::phase_resolved bins;
+      if (add_profile (bins, config, profile) < 0)
+        return -1;
 
-    if (healpix_order)
+      epsic::ensemble trials (bins, nsamp, ntrial);
+      return run_ensemble (trials, config, nsamp, ensemble_output);
+    }
+    catch (std::exception& error)
     {
-      const vec3 pol = vec3 (mean_stokes[1], mean_stokes[2], mean_stokes[3]);
-      double count = 1.0;
-      if (weight == PolarizedFlux)
-        count = sqrt( psq );
-      else if (weight == TotalFlux)
-        count = mean_stokes[0];
-      healpix_map[healpix_map.vec2pix( pol )] += count;
+      cerr << error.what() << endl;
+      return -1;
     }
-    
-#endif
   }
 
-  totp /= ntot;
-  tot /= ntot;
-  totsq /= ntot;
+  epsic::simulation sim (config);
 
-  if (subtract_outer_population_mean)
-    totsq -= outer(stokes,stokes);
-  else
-    totsq -= outer(tot,tot);
+  std::ofstream outfile;
+  std::shared_ptr<epsic::stokes_writer> writer;
 
-  if (variances_and_means)
+  if (output_stokes && stokes_format == "text")
   {
-    for (unsigned i=0; i<4; i++)
-    {
-      cout << "mean[" << i << "] = " << tot[i] << endl;
-      cout << "var[" << i << "] = " << totsq[i][i] << endl;
-    }
-    cleanup();
-    return 0;
+    outfile.open ("stokes.txt");
+    sim.add (new epsic::stokes_printer (&outfile));
+  }
+  else if (output_stokes) try
+  {
+    epsic::stokes_file_header header;
+    header.dtype_size = (stokes_format == "float64") ? 8 : 4;
+    if (compress_stokes)
+      header.compression = epsic::stokes_file_header::Zlib;
+    header.sample_size = config.sample_size;
+    header.seed = sim.get_config().seed;
+
+    // the command line describes the configuration
+    for (int iarg=0; iarg < argc; iarg++)
+      header.config += (iarg ? " " : "") + string (argv[iarg]);
+
+    writer = std::make_shared<epsic::stokes_writer> ("stokes.dat", header);
+    sim.add (new epsic::stokes_recorder (writer));
+  }
+  catch (std::exception& error)
+  {
+    cerr << error.what() << endl;
+    return -1;
   }
 
-  Vector<4, double> expected_mean;
-  Matrix<4,4, double> expected_covariance;
-
-  expected_mean = stokes_sample->get_mean ();
-  expected_covariance = stokes_sample->get_covariance();
-
-  cerr << "\n"
-    " ******************************************************************* \n"
-    "\n"
-    " STOKES PARAMETERS \n"
-    "\n"
-    " ******************************************************************* \n"
-       << endl;
+#if HAVE_HEALPIX
+  int histogram = -1;
+  if (healpix_order > 0)
+    histogram = sim.add (new healpix_histogram (healpix_order, healpix_scheme, weight));
+#endif
 
-  if (run_simulation)
+  if (verbose)
   {
-    cerr << "mean sample dop=" << totp << endl << endl;
+    cerr << "epsic: using " << SIMD::get_name (SIMD::get_path())
+         << " instruction set" << endl;
 
-    cerr << "modulation index=" << sqrt(totsq[0][0])/tot[0] << endl << endl;
+    if (sim.is_compiled())
+      cerr << "epsic: using statically composed mode pipeline" << endl;
+  }
 
-    cerr << "mean=" << tot << endl;
-    cerr << "expected=" << expected_mean << endl;
+  if (ntrial) try
+  {
+    epsic::ensemble trials (sim.get_config(), nsamp, ntrial);
+    return run_ensemble (trials, sim.get_config(), nsamp, ensemble_output);
+  }
+  catch (std::exception& error)
+  {
+    cerr << error.what() << endl;
+    return -1;
+  }
 
-    cerr << "\ncovar=\n" << totsq << endl;
-    cerr << "expected=\n" << expected_covariance << endl;
+  if (voltage_bits) try
+  {
+    return run_voltages (sim, voltage_bits, nsamp, argc, argv);
   }
-  
-  if (nlag)
+  catch (std::exception& error)
   {
-    cerr << "ACF output in acf.txt and acf_plot.txt" << endl;
+    cerr << error.what() << endl;
+    return -1;
+  }
 
-    std::ofstream out ("acf.txt");
-    std::ofstream plot ("acf_plot.txt");
-    
-    for (unsigned ilag=0; ilag<nlag; ilag++)
+  if (run_simulation && !checkpoint.empty()) try
+  {
+    if (resume)
     {
-      acf[ilag] /= ntot_lag;
-      acf[ilag] -= outer(tot,tot);
-
-      Matrix<4,4,double> exp = stokes_sample->get_crosscovariance(ilag);
-      
-      out << "============================================================\n"
-            "lag=" << ilag << endl;
-      if (run_simulation)
-        out << "mean=" << acf[ilag] << endl;
-      out << "expected=" << exp << endl;
-
-      plot << ilag << " ";
-      for (unsigned i=0; i<4; i++)
+      std::ifstream in (checkpoint.c_str(), std::ios::binary);
+      if (in)
       {
-        for (unsigned j=0; j<4; j++)
-        {
-          plot << exp[i][j] << " ";
-          if (run_simulation)
-            plot  << acf[ilag][i][j] << " ";
-        }
+        sim.load (in);
+        cerr << "Resuming from " << checkpoint << " after "
+             << sim.get_nsamp() << " Stokes samples" << endl;
+
+        if (sim.get_checkpoint_path() != SIMD::get_path())
+          cerr << "epsic: warning: " << checkpoint << " was written using "
+               << SIMD::get_name (sim.get_checkpoint_path())
+               << " instructions; resuming with "
+               << SIMD::get_name (SIMD::get_path()) << endl;
       }
-      plot << endl;
+      else
+        cerr << "epsic: " << checkpoint << " not found; starting" << endl;
     }
-  }
 
-#if HAVE_HEALPIX
+    cerr << "Simulating " << nsamp << " Stokes samples with seed="
+         << sim.get_config().seed << endl;
 
-  if (healpix_order)
-  {
-    string out_name = "healpix.fits";
-    unlink (out_name.c_str());
-    write_Healpix_map_to_fits ( out_name, healpix_map, PLANCK_FLOAT64 );
+    run_checkpointed (sim, nsamp, checkpoint, checkpoint_interval);
   }
-  
-#endif
- 
-  if (covariant)
+  catch (std::exception& error)
   {
-    delete covariant;
-    covariant = 0;
+    cerr << error.what() << endl;
+    return -1;
   }
+  else if (run_simulation) try
+  {
+    cerr << "Simulating " << nsamp << " Stokes samples with seed="
+         << sim.get_config().seed << endl;
 
-  if (!rho_stats)
+    sim.run (nsamp);
+  }
+  catch (std::exception& error)
   {
-    cleanup();
-    return 0;
+    cerr << error.what() << endl;
+    return -1;
   }
 
-  cerr << "\n"
-    " ******************************************************************* \n"
-    "\n"
-    " COHERENCY MATRIX \n"
-    "\n"
-    " ******************************************************************* \n"
-       << endl;
-
-  tot_rho /= nsamp;
-  totsq_rho /= nsamp;
-
-  cerr << "rho sq=\n" << totsq_rho << endl;
+  if (output_stokes)
+    outfile.close ();
 
-  totsq_rho -= direct(tot_rho,tot_rho);
+  if (writer) try
+  {
+    writer->close ();
+  }
+  catch (std::exception& error)
+  {
+    cerr << error.what() << endl;
+    return -1;
+  }
 
-  cerr << "rho mean=\n" << tot_rho << endl;
-  cerr << "rho covar=\n" << totsq_rho << endl;
+  epsic::simulation_result result = sim.get_result ();
 
-  Matrix<4,4, std::complex<double> > candidate;
-  for (unsigned i=0; i<4; i++)
-    for (unsigned j=0; j<4; j++)
-      {
-        Matrix<4,4,std::complex<double> > temp = Dirac::matrix (i,j);
-        temp *= expected_covariance[i][j] * 0.25;
+  if (sim.get_covariant() && run_simulation)
+  {
+    epsic::moment_accumulator<2> modulations = sim.get_covariant()->get_statistics();
+    Vector<2,double> mean = modulations.get_mean();
+    Matrix<2,2,double> covar = modulations.get_covariance();
+
+    cerr << "\n"
+      "bivariate_lognormal_modes mean=" << mean << " "
+      "rho=" << covar[0][1]/sqrt(covar[0][0]*covar[1][1]) << "\n"
+      "covar=\n" << covar << endl;
+  }
 
-        candidate += temp;
-      }
+  Matrix<4,4, double> totsq;
 
-  cerr << "candidate=\n" << candidate << endl;
+  if (subtract_outer_population_mean)
+    totsq = result.stokes.get_covariance (stokes);
+  else
+    totsq = result.get_covariance ();
 
-  Matrix<4, 4, std::complex<double> > eigenvectors;
-  Vector<4, double> eigenvalues;
+  const epsic::statistic* map = nullptr;
 
-  Matrix<4, 4, std::complex<double> > temp = candidate;
-  Jacobi (temp, eigenvectors, eigenvalues);
+#if HAVE_HEALPIX
+  if (histogram >= 0)
+    map = sim.get_statistic (histogram);
+#endif
 
-  for (unsigned i=0; i<4; i++)
-    cerr << "e_" << i << "=" << eigenvalues[i] << "  v=" << eigenvectors[i] << endl;
+  report (result, totsq, run_simulation, true, variances_and_means,
+          config.rho_stats, map);
 
-  cleanup();
   return 0;
 }
 
@@ -0,0 +1,143 @@
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+#include "field_kernel.h"
+#include "SIMD.h"
+
+#if SIMD_X86
+#include <immintrin.h>
+#endif
+
+/*
+  The complex product of the Jones matrix and the spinor is written as
+  the product of a real 4x4 matrix and the real vector of normal deviates,
+  d = (Re x, Im x, Re y, Im y); this avoids the special handling of
+  infinities and NaNs in the multiplication of std::complex values,
+  and maps directly onto vector registers.
+*/
+
+static_assert (sizeof(Spinor<double>) == 4 * sizeof(double),
+               "Spinor<double> must be stored as four consecutive doubles");
+
+//! Portable implementation
+static void transform_scalar (double* e, const double m[4][4],
+                              const float* d, unsigned n)
+{
+  for (unsigned i=0; i<n; i++, e+=4, d+=4)
+  {
+    double d0 = d[0], d1 = d[1], d2 = d[2], d3 = d[3];
+
+    for (unsigned k=0; k<4; k++)
+      e[k] = m[k][0] * d0 + m[k][1] * d1 + m[k][2] * d2 + m[k][3] * d3;
+  }
+}
+
+#if SIMD_X86
+
+/*
+  The vectorized kernels add the columns of the matrix, each multiplied
+  by the corresponding normal deviate broadcast across the register.
+  The products are added in the order of the portable implementation,
+  without fused multiply-add, so that every path computes the same fields.
+*/
+
+//! Two field instances per 512-bit register
+SIMD_TARGET_AVX512
+static void transform_avx512 (double* e, const double m[4][4],
+                              const float* d, unsigned n)
+{
+  __m512d col[4];
+  for (unsigned j=0; j<4; j++)
+    col[j] = _mm512_setr_pd (m[0][j], m[1][j], m[2][j], m[3][j],
+                             m[0][j], m[1][j], m[2][j], m[3][j]);
+
+  /* the zero-masking forms of the intrinsics (with every element
+     selected) avoid spurious -Wuninitialized warnings from GCC 12 */
+  unsigned pairs = n / 2;
+  for (unsigned i=0; i<pairs; i++, e+=8, d+=8)
+  {
+    __m512d r = _mm512_maskz_cvtps_pd (0xFF, _mm256_loadu_ps (d));
+
+    __m512d sum = _mm512_mul_pd (col[0], _mm512_maskz_permutex_pd (0xFF, r, 0x00));
+    sum = _mm512_add_pd (sum, _mm512_mul_pd (col[1], _mm512_maskz_permutex_pd (0xFF, r, 0x55)));
+    sum = _mm512_add_pd (sum, _mm512_mul_pd (col[2], _mm512_maskz_permutex_pd (0xFF, r, 0xAA)));
+    sum = _mm512_add_pd (sum, _mm512_mul_pd (col[3], _mm512_maskz_permutex_pd (0xFF, r, 0xFF)));
+
+    _mm512_storeu_pd (e, sum);
+  }
+
+  /* GCC does not clear the upper halves of the registers before the
+     tail call, which makes later SSE code (e.g. exp in libm) very slow */
+  _mm256_zeroupper ();
+
+  transform_scalar (e, m, d, n % 2);
+}
+
+//! One field instance per 256-bit register
+SIMD_TARGET_AVX2
+static void transform_avx2 (double* e, const double m[4][4],
+                            const float* d, unsigned n)
+{
+  __m256d col[4];
+  for (unsigned j=0; j<4; j++)
+    col[j] = _mm256_setr_pd (m[0][j], m[1][j], m[2][j], m[3][j]);
+
+  for (unsigned i=0; i<n; i++, e+=4, d+=4)
+  {
+    __m256d r = _mm256_cvtps_pd (_mm_loadu_ps (d));
+
+    __m256d sum = _mm256_mul_pd (col[0], _mm256_permute4x64_pd (r, 0x00));
+    sum = _mm256_add_pd (sum, _mm256_mul_pd (col[1], _mm256_permute4x64_pd (r, 0x55)));
+    sum = _mm256_add_pd (sum, _mm256_mul_pd (col[2], _mm256_permute4x64_pd (r, 0xAA)));
+    sum = _mm256_add_pd (sum, _mm256_mul_pd (col[3], _mm256_permute4x64_pd (r, 0xFF)));
+
+    _mm256_storeu_pd (e, sum);
+  }
+}
+
+#endif
+
+//! Set the rows of m that compute the real and imaginary parts of a*x + b*y
+static void set_rows (double m[2][4], std::complex<double> a,
+                      std::complex<double> b, double rms)
+{
+  a *= rms;
+  b *= rms;
+
+  double re[4] = { a.real(), -a.imag(), b.real(), -b.imag() };
+  double im[4] = { a.imag(), a.real(), b.imag(), b.real() };
+
+  for (unsigned j=0; j<4; j++)
+  {
+    m[0][j] = re[j];
+    m[1][j] = im[j];
+  }
+}
+
+void epsic::polarize (Spinor<double>* fields, const Jones<double>& polarizer,
+                      double rms, const float* normals, unsigned n)
+{
+  double m[4][4];
+  set_rows (m, polarizer.j00, polarizer.j01, rms);
+  set_rows (m+2, polarizer.j10, polarizer.j11, rms);
+
+  double* e = reinterpret_cast<double*> (fields);
+
+  switch (SIMD::get_path())
+  {
+#if SIMD_X86
+  case SIMD::AVX512:
+    transform_avx512 (e, m, normals, n);
+    break;
+  case SIMD::AVX2:
+    transform_avx2 (e, m, normals, n);
+    break;
+#endif
+  default:
+    transform_scalar (e, m, normals, n);
+  }
+}
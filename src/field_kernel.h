@@ -0,0 +1,28 @@
+//-*-C++-*-
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+//! @file epsic/src/field_kernel.h
+
+#ifndef __epsic_field_kernel_h
+#define __epsic_field_kernel_h
+
+#include "Jones.h"
+#include "Spinor.h"
+
+namespace epsic
+{
+  //! Transform n quadruples of normal deviates into polarized field instances
+  /*! Equivalent to fields[i] = polarizer * Spinor<double> (x, y), where
+    x = rms * (d[0] + i d[1]), y = rms * (d[2] + i d[3]) and
+    d = normals + 4*i; uses AVX-512 or AVX2 instructions when supported
+    by the processor. */
+  void polarize (Spinor<double>* fields, const Jones<double>& polarizer,
+                 double rms, const float* normals, unsigned n);
+}
+
+#endif // ! defined __epsic_field_kernel_h
@@ -0,0 +1,239 @@
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+#include "file_mode.h"
+#include "stokes_kernel.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+//! The mapped file shared by copies of a file_mode
+class epsic::file_mode::mapping
+{
+public:
+
+  //! the mapped file
+  const char* base;
+  size_t size;
+
+  Format format;
+  uint64_t header_size;
+  unsigned instance_size;
+  uint64_t ninstance;
+
+  //! number of bytes prefetched ahead of the next instance
+  static const uint64_t window = 16 << 20;
+
+  mapping (const std::string& filename, Format, uint64_t header_size);
+  ~mapping () { munmap (const_cast<char*>(base), size); }
+
+  //! Return the address of the specified instance
+  const char* get_instance (uint64_t index) const
+  { return base + header_size + index * instance_size; }
+
+  //! Prefetch the pages that follow offset and update the end of those prefetched
+  void prefetch (uint64_t offset, uint64_t& prefetched) const;
+};
+
+epsic::file_mode::mapping::mapping (const std::string& filename, Format _format,
+                                    uint64_t _header_size)
+{
+  format = _format;
+  header_size = _header_size;
+  instance_size = get_instance_size (format);
+
+  if (header_size % (instance_size / 4))
+    throw std::runtime_error ("epsic::file_mode - header size is not "
+                              "a multiple of the size of each value");
+
+  int fd = open (filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw std::runtime_error ("epsic::file_mode - could not open " + filename);
+
+  struct stat info;
+  if (fstat (fd, &info) < 0 || uint64_t(info.st_size) < header_size + instance_size)
+  {
+    ::close (fd);
+    throw std::runtime_error ("epsic::file_mode - " + filename
+                              + " contains no field instances");
+  }
+
+  size = info.st_size;
+  void* mapped = mmap (0, size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close (fd);
+
+  if (mapped == MAP_FAILED)
+    throw std::runtime_error ("epsic::file_mode - could not map " + filename);
+
+  base = static_cast<const char*> (mapped);
+  madvise (mapped, size, MADV_SEQUENTIAL);
+
+  ninstance = (size - header_size) / instance_size;
+}
+
+void epsic::file_mode::mapping::prefetch (uint64_t offset,
+                                          uint64_t& prefetched) const
+{
+  // prefetch in steps of half the window
+  if (prefetched >= size || offset + window / 2 < prefetched)
+    return;
+
+  uint64_t start = std::max (prefetched, offset);
+  uint64_t end = std::min<uint64_t> (size, start + window);
+
+  uint64_t page = sysconf (_SC_PAGESIZE);
+  start = start / page * page;
+
+  madvise (const_cast<char*>(base) + start, end - start, MADV_WILLNEED);
+  prefetched = end;
+}
+
+epsic::file_mode::Format epsic::file_mode::parse_format (const std::string& name)
+{
+  if (name == "int8")
+    return Int8;
+  if (name == "int16")
+    return Int16;
+  if (name == "float32")
+    return Float32;
+
+  throw std::runtime_error ("epsic::file_mode::parse_format - unknown format " + name);
+}
+
+unsigned epsic::file_mode::get_instance_size (Format format)
+{
+  switch (format)
+  {
+  case Int8:
+    return 4;
+  case Int16:
+    return 8;
+  case Float32:
+    return 16;
+  }
+
+  throw std::runtime_error ("epsic::file_mode::get_instance_size - invalid format");
+}
+
+uint64_t epsic::file_mode::count_instances (const std::string& filename,
+                                            Format format, uint64_t header_size)
+{
+  struct stat info;
+  if (stat (filename.c_str(), &info) < 0)
+    throw std::runtime_error ("epsic::file_mode::count_instances - could not stat "
+                              + filename);
+
+  if (uint64_t(info.st_size) < header_size)
+    return 0;
+
+  return (info.st_size - header_size) / get_instance_size (format);
+}
+
+//! Convert n instances of four values of type T
+template<typename T>
+static void convert (Spinor<double>* fields, const char* data, unsigned n)
+{
+  const T* values = reinterpret_cast<const T*> (data);
+
+  for (unsigned i=0; i<n; i++, values += 4)
+    fields[i] = Spinor<double> (std::complex<double> (values[0], values[1]),
+                                std::complex<double> (values[2], values[3]));
+}
+
+static void convert (Spinor<double>* fields, const char* data, unsigned n,
+                     epsic::file_mode::Format format)
+{
+  switch (format)
+  {
+  case epsic::file_mode::Int8:
+    convert<int8_t> (fields, data, n);
+    break;
+  case epsic::file_mode::Int16:
+    convert<int16_t> (fields, data, n);
+    break;
+  case epsic::file_mode::Float32:
+    convert<float> (fields, data, n);
+    break;
+  }
+}
+
+epsic::file_mode::file_mode (const std::string& filename, Format format,
+                             uint64_t header_size)
+{
+  file = std::make_shared<mapping> (filename, format, header_size);
+  set_range (0, file->ninstance);
+
+  // estimate the mean Stokes parameters
+  const unsigned block_size = 256;
+  Spinor<double> block[block_size];
+
+  uint64_t nestimate = std::min<uint64_t> (file->ninstance, 1 << 20);
+  Vector<4,double> sum;
+
+  for (uint64_t i=0; i < nestimate; i += block_size)
+  {
+    unsigned n = std::min<uint64_t> (block_size, nestimate - i);
+    convert (block, file->get_instance (i), n, format);
+    accumulate_stokes (sum, block, n);
+  }
+
+  if (sum[0] > 0.0)
+    set_Stokes (Stokes<double> (sum / double(nestimate)));
+}
+
+Spinor<double> epsic::file_mode::get_field ()
+{
+  Spinor<double> e;
+  get_fields (&e, 1);
+  return e;
+}
+
+void epsic::file_mode::get_fields (Spinor<double>* fields, unsigned n)
+{
+  if (next + n > end)
+    throw std::runtime_error ("epsic::file_mode::get_fields - "
+                              "end of data after instance "
+                              + std::to_string (end));
+
+  const char* data = file->get_instance (next);
+  file->prefetch (data + uint64_t(n) * file->instance_size - file->base,
+                  prefetched);
+
+  convert (fields, data, n, file->format);
+  next += n;
+}
+
+uint64_t epsic::file_mode::get_ninstance () const
+{
+  return file->ninstance;
+}
+
+void epsic::file_mode::set_range (uint64_t start, uint64_t _end)
+{
+  if (start > _end || _end > file->ninstance)
+    throw std::runtime_error ("epsic::file_mode::set_range - "
+                              "invalid range of instances");
+  end = _end;
+  prefetched = 0;
+  set_position (start);
+}
+
+void epsic::file_mode::set_position (uint64_t position)
+{
+  if (position > end)
+    throw std::runtime_error ("epsic::file_mode::set_position - "
+                              "beyond the end of the data");
+  next = position;
+  file->prefetch (uint64_t (file->get_instance (next) - file->base), prefetched);
+}
@@ -0,0 +1,101 @@
+//-*-C++-*-
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+//! @file epsic/src/file_mode.h
+
+#ifndef __epsic_file_mode_h
+#define __epsic_file_mode_h
+
+#include "mode.h"
+
+#include <memory>
+#include <string>
+
+namespace epsic
+{
+  //! Electric field instances read from a file of dual-polarization baseband data
+  /*! The file is a sequence of instances, each of which consists of
+    four values (native byte order): the real and imaginary parts of the
+    x and y components of the electric field.  The values are 8-bit or
+    16-bit signed integers or 32-bit floating point numbers, and the
+    first instance may follow a header of any number of bytes.
+
+    The file is mapped into memory and converted directly into the
+    field instances requested by get_fields; pages ahead of the next
+    instance are prefetched while the current pages are converted.
+
+    Copies share the mapping, but each copy reads its own range of
+    instances, so that each thread of a simulation can read a contiguous
+    part of the file.  Reading beyond the end of the range throws an
+    exception.
+
+    The expected mean Stokes parameters are estimated from (up to) the
+    first 2^20 instances, so that the moments of the data may be
+    compared with those of normally distributed fields. */
+  class file_mode : public mode
+  {
+  public:
+
+    //! The type of each value
+    enum Format { Int8, Int16, Float32 };
+
+    //! Return the format named int8, int16 or float32
+    static Format parse_format (const std::string&);
+
+    //! Return the number of bytes in each instance of the specified format
+    static unsigned get_instance_size (Format);
+
+    //! Return the number of instances in the file
+    static uint64_t count_instances (const std::string& filename, Format,
+                                     uint64_t header_size = 0);
+
+    //! Map the file into memory and estimate the mean Stokes parameters
+    file_mode (const std::string& filename, Format, uint64_t header_size = 0);
+
+    //! Return a copy that shares the mapping and starts at the same position
+    file_mode* clone () const { return new file_mode (*this); }
+
+    //! Return the next instance of the electric field vector
+    Spinor<double> get_field ();
+
+    //! Fill the array with the next n instances of the electric field vector
+    void get_fields (Spinor<double>* fields, unsigned n);
+
+    //! Recorded field instances are not assumed to be independent and normal
+    bool is_normal () const { return false; }
+
+    //! Return the number of instances in the file
+    uint64_t get_ninstance () const;
+
+    //! Read the instances from index start up to (but not including) end
+    void set_range (uint64_t start, uint64_t end);
+
+    //! Return the index of the next instance to be read
+    uint64_t get_position () const { return next; }
+
+    //! Set the index of the next instance to be read
+    void set_position (uint64_t);
+
+  private:
+
+    class mapping;
+    std::shared_ptr<mapping> file;
+
+    //! the index of the next instance to be read
+    uint64_t next;
+
+    //! the index of the instance that follows the range
+    uint64_t end;
+
+    //! the offset of the end of the pages that have been prefetched
+    uint64_t prefetched;
+  };
+
+} // end of namespace epsic
+
+#endif // ! defined __epsic_file_mode_h
@@ -6,6 +6,7 @@
  ***************************************************************************/
 
 #include "mode.h"
+#include "field_kernel.h"
 #include "Quaternion.h"
 #include "Pauli.h"
 
@@ -14,30 +15,87 @@ epsic::mode::mode ()
   normal = 0;
   rms = 0.5;
 
+  revision = 1;
+  cache_revision = 0;
+  covariance_cached = false;
+
   mode::set_Stokes (Stokes<double>(1.0));
 }
 
 void epsic::mode::set_Stokes (const Stokes<double>& _mean)
 {
   mean = _mean;
+  changed ();
 
   Quaternion<double,Hermitian> root = sqrt (natural(mean));
   polarizer = convert (root);
 }
 
 Spinor<double> epsic::mode::get_field ()
+{
+  Spinor<double> e;
+  mode::get_fields (&e, 1);
+  return e;
+}
+
+void epsic::mode::get_fields (Spinor<double>* fields, unsigned n)
 {
   if (!normal)
-    throw std::runtime_error( "epsic::mode::get_field - BoxMuller not set");
+    throw std::runtime_error( "epsic::mode::get_fields - BoxMuller not set");
+
+  normals.resize (4*n);
+  normal->fill (normals.data(), 4*n);
+
+  polarize (fields, polarizer, rms, normals.data(), n);
+}
 
-  BoxMuller& gasdev = *normal;
 
-  std::complex<double> x (rms * gasdev(), rms * gasdev());
-  std::complex<double> y (rms * gasdev(), rms * gasdev());
 
-  Spinor<double> e (x, y);
+void epsic::mode::validate_cache () const
+{
+  uint64_t current = get_revision ();
+  if (current == cache_revision)
+    return;
 
-  return polarizer * e;
+  cache_revision = current;
+  covariance_cached = false;
+  crosscovariance_cached.assign (crosscovariance_cached.size(), false);
 }
 
+const Matrix<4,4, double>& epsic::mode::get_cached_covariance () const
+{
+  validate_cache ();
+
+  if (!covariance_cached)
+  {
+    covariance_cache = get_covariance ();
+    covariance_cached = true;
+  }
 
+  return covariance_cache;
+}
+
+/*! Only lags less than the correlation length are stored */
+const Matrix<4,4, double>& epsic::mode::get_cached_crosscovariance (unsigned ilag) const
+{
+  static const Matrix<4,4, double> zero;
+
+  if (ilag >= get_correlation_length())
+    return zero;
+
+  validate_cache ();
+
+  if (ilag >= crosscovariance_cached.size())
+  {
+    crosscovariance_cache.resize (ilag + 1);
+    crosscovariance_cached.resize (ilag + 1, false);
+  }
+
+  if (!crosscovariance_cached[ilag])
+  {
+    crosscovariance_cache[ilag] = get_crosscovariance (ilag);
+    crosscovariance_cached[ilag] = true;
+  }
+
+  return crosscovariance_cache[ilag];
+}
@@ -18,6 +18,8 @@
 #include "Minkowski.h"
 
 #include <iostream>
+#include <vector>
+#include <cstdint>
 
 //! Core classes that generate random electromagnetic fields and compute Stokes parameters
 namespace epsic
@@ -30,6 +32,10 @@ namespace epsic
     mode ();
     virtual ~mode () { }
 
+    //! Return a new copy of this instance
+    /*! The copy shares the BoxMuller object, which may be replaced by set_normal */
+    virtual mode* clone () const { return new mode (*this); }
+
     //! Set the expected mean Stokes parameters
     virtual void set_Stokes (const Stokes<double>& mean);
     //! Get the expected mean Stokes parameters
@@ -45,43 +51,120 @@ namespace epsic
     virtual Matrix<4,4, double> get_crosscovariance (unsigned ilag) const
     { if (ilag>0) return 0; else return get_covariance(); }
 
+    //! Return the number of lags at which the Stokes parameters are correlated
+    /*! get_crosscovariance returns zero at all lags greater than or equal to this value */
+    virtual unsigned get_correlation_length () const { return 1; }
+
     //! Return a random instance of the electric field vector
     virtual Spinor<double> get_field ();
 
+    //! Fill the array with n random instances of the electric field vector
+    virtual void get_fields (Spinor<double>* fields, unsigned n);
+
     //! Return BoxMuller object used to generate normally distributed numbers
     virtual BoxMuller* get_normal () { return normal; }
     virtual void set_normal (BoxMuller* n) { normal = n; }
 
+    //! Return the expected covariances, computed once for each revision
+    const Matrix<4,4, double>& get_cached_covariance () const;
+
+    //! Return the expected cross-covariance at lag, computed once for each revision
+    const Matrix<4,4, double>& get_cached_crosscovariance (unsigned ilag) const;
+
+    //! Return a number that increases whenever the expected statistics change
+    /*! Decorators add the revisions of the modes on which they depend */
+    virtual uint64_t get_revision () const { return revision; }
+
     //! Return the Jones matrix used to polarize
     const Jones<double>& get_polarizer () const { return polarizer; }
+
+    //! Return the standard deviation of each component of the unpolarized field
+    double get_rms () const { return rms; }
+
+    //! Return true if the field instances are independent and normally distributed
+    virtual bool is_normal () const { return true; }
+
+    //! Return the covariance matrix of the electric field, < e e^dagger >
+    virtual Jones<double> get_field_covariance () const
+    { return 2.0 * rms * rms * polarizer * herm(polarizer); }
       
+  protected:
+    //! Invalidate the cached statistics of this mode and of its decorators
+    void changed () { revision ++; }
+
   private:
     Stokes<double> mean;
     Jones<double> polarizer;
 
     BoxMuller* normal;
     double rms;
+
+    //! normal deviates used to generate a block of field instances
+    std::vector<float> normals;
+
+    //! incremented whenever the expected statistics change
+    uint64_t revision;
+
+    //! the revision at which the cached statistics were computed
+    mutable uint64_t cache_revision;
+
+    //! Discard the cached statistics if they were computed at an earlier revision
+    void validate_cache () const;
+
+    mutable Matrix<4,4, double> covariance_cache;
+    mutable bool covariance_cached;
+
+    mutable std::vector< Matrix<4,4, double> > crosscovariance_cache;
+    mutable std::vector< bool > crosscovariance_cached;
   };
 
   //! Allows a mode to be dynamically modified and extended at runtime
+  /*! A decorator does not own the mode that it decorates, unless the
+    decorator is a copy, which owns the copy of the source. */
   class mode_decorator : public mode
   {
   protected:
     mode* source;
 
+    //! the source is a copy made by this instance, deleted on destruction
+    bool owns_source;
+
+    //! Return a copy of the decorator that decorates a copy of the source
+    template<class T> static T* copy (const T* decorator)
+    {
+      T* result = new T (*decorator);
+      mode_decorator* base = result;
+      base->source = base->source->clone();
+      base->owns_source = true;
+      return result;
+    }
+
   public:
-    mode_decorator (mode* s) { source = s; }
+    mode_decorator (mode* s) { source = s; owns_source = false; }
+    ~mode_decorator () { if (owns_source) delete source; }
+
     mode* get_source () { return source; }
 
+    mode_decorator* clone () const { return copy (this); }
+
     void set_Stokes (const Stokes<double>& mean) { source->set_Stokes(mean); }
     Stokes<double> get_Stokes () { return source->get_Stokes(); }
 
-    Matrix<4,4,double> get_covariance() const { return source->get_covariance(); }
+    Matrix<4,4,double> get_covariance() const { return source->get_cached_covariance(); }
     Stokes<double> get_mean () const { return source->get_mean(); }
 
     Spinor<double> get_field () { return source->get_field(); }
+    void get_fields (Spinor<double>* fields, unsigned n) { source->get_fields(fields, n); }
+
     BoxMuller* get_normal () { return source->get_normal(); }
     void set_normal (BoxMuller* n) { source->set_normal(n); }
+
+    uint64_t get_revision () const
+    { return mode::get_revision() + source->get_revision(); }
+
+    //! Decorated field instances are not assumed to be independent and normal
+    bool is_normal () const { return false; }
+    Jones<double> get_field_covariance () const { return source->get_field_covariance(); }
   };
 
   //! Base class of decorators that transform the electric field
@@ -90,10 +173,19 @@ namespace epsic
   public:
     field_transformer (mode* s) : mode_decorator (s) { }
 
+    field_transformer* clone () const = 0;
+
     Spinor<double> get_field () { return transform( source->get_field() ); }
 
+    void get_fields (Spinor<double>* fields, unsigned n)
+    { source->get_fields (fields, n); transform (fields, n); }
+
     //! Derived types define the field transformation
     virtual Spinor<double> transform ( const Spinor<double>& ) = 0;
+
+    //! Transform the array of n field instances in place
+    virtual void transform (Spinor<double>* fields, unsigned n)
+    { for (unsigned i=0; i<n; i++) fields[i] = transform (fields[i]); }
   };
 
 } // end of namespace epsic
@@ -12,8 +12,10 @@
 #define __epsic_modulated_h
 
 #include "mode.h"
+#include "sliding_window.h"
 
 #include <vector>
+#include <algorithm>
 
 #define _DEBUG 0
 #if _DEBUG
@@ -25,6 +27,9 @@ namespace epsic
   //! an amplitude modulated source of electromagnetic radiation
   class modulated_mode : public field_transformer
   {
+    //! modulation factors applied to a block of field instances
+    std::vector<double> factors;
+
   #if _DEBUG
     mutable double tot, totsq;
     uint64_t count;
@@ -39,9 +44,15 @@ namespace epsic
   #endif
     }
 
+    modulated_mode* clone () const = 0;
+
     //! return a random scalar modulation factor
     virtual double modulation () = 0;
 
+    //! fill the array with n random scalar modulation factors
+    virtual void modulations (double* mod, unsigned n)
+    { for (unsigned i=0; i<n; i++) mod[i] = modulation(); }
+
     //! return the mean of the scalar modulation factor
     virtual double get_mod_mean () const = 0;
 
@@ -60,6 +71,23 @@ namespace epsic
       return sqrt(mod) * field;
     }
 
+    //! multiply each electric field by the square root of its modulation factor
+    void transform (Spinor<double>* fields, unsigned n)
+    {
+      factors.resize (n);
+      modulations (factors.data(), n);
+
+      for (unsigned i=0; i<n; i++)
+      {
+  #if _DEBUG
+        tot+=factors[i];
+        totsq+=factors[i]*factors[i];
+        count+=1;
+  #endif
+        fields[i] *= sqrt(factors[i]);
+      }
+    }
+
     //! compute the expected covariances between the Stokes parameters
     Matrix<4,4,double> get_covariance () const
     {
@@ -75,7 +103,7 @@ namespace epsic
       cerr << " measured mean=" << tot << " var=" << totsq << endl;
   #endif
 
-      Matrix<4,4,double> C = source->get_covariance();
+      Matrix<4,4,double> C = source->get_cached_covariance();
       C *= (mean*mean + var);
       Matrix<4,4,double> o = outer (source->get_mean(), source->get_mean());
       o *= var;
@@ -101,10 +129,13 @@ namespace epsic
     //! initialize based on the modulation index \f$ \beta \f$
     lognormal_mode (mode* s, double beta) : modulated_mode (s) { set_beta (beta); }
 
+    lognormal_mode* clone () const { return copy (this); }
+
     //! set the modulation index \f$ \beta \f$
     void set_beta (double beta)
     {
       log_sigma = sqrt( log( beta*beta + 1.0 ) );
+      changed ();
     }
 
     //! get the modulation index \f$ \beta \f$
@@ -125,6 +156,14 @@ namespace epsic
       return exp ( log_sigma * (get_normal()->evaluate() - 0.5*log_sigma) ) ;
     }
 
+    //! fill the array with n random scalar modulation factors
+    void modulations (double* mod, unsigned n)
+    {
+      get_normal()->fill (mod, n);
+      for (unsigned i=0; i<n; i++)
+        mod[i] = exp ( log_sigma * (mod[i] - 0.5*log_sigma) );
+    }
+
     //! return the expected mean of the amplitude-modulating function
     double get_mod_mean () const { return 1.0; }
 
@@ -137,40 +176,60 @@ namespace epsic
   //! an amplitude modulating function smoothed using a running mean
   class boxcar_modulated_mode : public modulated_mode
   {
-    std::vector< double > instances;
+    sliding_window< double > window;
     unsigned smooth;
-    unsigned current;
 
     void setup()
     {
-      current = 0;
-      instances.resize (smooth);
+      window.resize (smooth);
       for (unsigned i=1; i<smooth; i++)
-        instances[i] = mod->modulation();
+        window.add (mod->modulation());
     }
 
     modulated_mode* mod;
 
+    //! mod is a copy made by this instance, which owns the source
+    bool owns_mod;
+
   public:
 
     boxcar_modulated_mode (modulated_mode* s, unsigned n)
-      : modulated_mode(s->get_source()) { smooth = n; mod = s; }
+      : modulated_mode(s->get_source()) { smooth = n; mod = s; owns_mod = false; }
+
+    ~boxcar_modulated_mode () { if (owns_mod) delete mod; }
+
+    boxcar_modulated_mode* clone () const
+    {
+      boxcar_modulated_mode* result = new boxcar_modulated_mode (*this);
+      result->mod = mod->clone();
+      result->owns_mod = true;
+      result->source = result->mod->get_source();
+      return result;
+    }
+
+    //! Return the number of modulation factors in the running mean
+    unsigned get_smooth () const { return smooth; }
+
+    //! Return the modulating function that is smoothed
+    modulated_mode* get_modulator () { return mod; }
 
     double modulation ()
     {
-      if (instances.size() < smooth)
+      if (window.size() < smooth)
         setup ();
 
-      instances[current] = mod->modulation();
-      current = (current + 1) % smooth;
+      return window.add (mod->modulation()) / smooth;
+    }
 
-      double result = 0.0;
-      for (unsigned i=0; i<smooth; i++)
-        result += instances[i];
+    void modulations (double* result, unsigned n)
+    {
+      if (window.size() < smooth)
+        setup ();
 
-      result /= smooth;
+      mod->modulations (result, n);
 
-      return result;
+      for (unsigned j=0; j<n; j++)
+        result[j] = window.add (result[j]) / smooth;
     }
 
     double get_mod_variance () const
@@ -192,6 +251,11 @@ namespace epsic
       result *= double (smooth - ilag) / smooth * get_mod_variance();
       return result;
     }
+
+    unsigned get_correlation_length () const { return smooth; }
+
+    uint64_t get_revision () const
+    { return modulated_mode::get_revision() + mod->get_revision(); }
     
   };
 
@@ -205,6 +269,9 @@ namespace epsic
 
     modulated_mode* mod;
 
+    //! mod is a copy made by this instance, which owns the source
+    bool owns_mod;
+
     std::vector<double> cross_correlation;
 
   public:
@@ -213,7 +280,29 @@ namespace epsic
         unsigned width,
         unsigned sample_size);
 
+    ~square_modulated_mode () { if (owns_mod) delete mod; }
+
+    square_modulated_mode* clone () const
+    {
+      square_modulated_mode* result = new square_modulated_mode (*this);
+      result->mod = mod->clone();
+      result->owns_mod = true;
+      result->source = result->mod->get_source();
+      return result;
+    }
+
+    //! Compute the fraction of instance pairs within the same pulse, as a function of lag
     void compute_cross_correlation (unsigned sample_size);
+
+    //! Return the fraction of instance pairs within the same pulse at the specified lag
+    double get_cross_correlation (unsigned ilag) const
+    { return ilag < width ? cross_correlation[ilag] : 0.0; }
+
+    //! Return the number of instances in each pulse
+    unsigned get_width () const { return width; }
+
+    //! Return the modulating function that sets the height of each pulse
+    modulated_mode* get_modulator () { return mod; }
     
     double modulation ()
     {
@@ -227,6 +316,24 @@ namespace epsic
       return value;
     }
 
+    void modulations (double* result, unsigned n)
+    {
+      unsigned i=0;
+      while (i < n)
+      {
+        if (current == width)
+        {
+          value = mod->modulation();
+          current = 0;
+        }
+
+        unsigned end = std::min (n, i + width - current);
+        current += end - i;
+        for (; i < end; i++)
+          result[i] = value;
+      }
+    }
+
     double get_mod_variance () const
     {
       return mod->get_mod_variance();
@@ -248,6 +355,11 @@ namespace epsic
 
       return result;
     }
+
+    unsigned get_correlation_length () const { return width; }
+
+    uint64_t get_revision () const
+    { return modulated_mode::get_revision() + mod->get_revision(); }
   };
 
 } // end of namespace epsic
@@ -0,0 +1,244 @@
+//-*-C++-*-
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+// epsic/src/moments.h
+
+#ifndef __epsic_moments_H
+#define __epsic_moments_H
+
+#include "checkpoint.h"
+
+#include <cstdint>
+
+namespace epsic
+{
+  //! Accumulates the mean and cross-covariance of pairs of random vectors
+  /*! Deviations from the running means are accumulated using the
+    algorithm of Welford (1962); this avoids the catastrophic
+    cancellation between the mean square and squared mean that occurs
+    when the mean is large compared to the standard deviation.
+
+    Accumulators filled independently (e.g. by different threads or
+    processes) are merged using the pairwise update of Chan, Golub &
+    LeVeque (1979). */
+  template<unsigned M, unsigned N, typename T = double>
+  class cross_moment_accumulator
+  {
+  protected:
+
+    uint64_t count;
+    Vector<M,T> mean_x;
+    Vector<N,T> mean_y;
+
+    //! Sum of outer products of the deviations from the means
+    Matrix<M,N,T> comoment;
+
+  public:
+
+    cross_moment_accumulator () { count = 0; }
+
+    //! Add the next pair of samples
+    /*! Written with loops over the elements, which avoid temporary
+      vectors and matrices and which the compiler can vectorize */
+    void add (const Vector<M,T>& x, const Vector<N,T>& y)
+    {
+      count ++;
+      T weight = T(1.0 / double(count));
+
+      T dx[M], dy[N];
+
+      for (unsigned i=0; i<M; i++)
+      {
+        dx[i] = x[i] - mean_x[i];
+        mean_x[i] += dx[i] * weight;
+      }
+
+      for (unsigned j=0; j<N; j++)
+      {
+        mean_y[j] += (y[j] - mean_y[j]) * weight;
+        dy[j] = y[j] - mean_y[j];
+      }
+
+      for (unsigned i=0; i<M; i++)
+        for (unsigned j=0; j<N; j++)
+          comoment[i][j] += dx[i] * dy[j];
+    }
+
+    //! Merge the statistics accumulated by another instance
+    void combine (const cross_moment_accumulator& that)
+    {
+      if (that.count == 0)
+        return;
+
+      if (count == 0)
+      {
+        *this = that;
+        return;
+      }
+
+      uint64_t total = count + that.count;
+      double weight = double(that.count) / double(total);
+
+      Vector<M,T> dx = that.mean_x - mean_x;
+      Vector<N,T> dy = that.mean_y - mean_y;
+
+      mean_x += dx * T(weight);
+      mean_y += dy * T(weight);
+
+      Matrix<M,N,T> correction = outer (dx, dy);
+      correction *= T(weight * double(count));
+
+      comoment += that.comoment;
+      comoment += correction;
+
+      count = total;
+    }
+
+    //! Return the number of samples added
+    uint64_t get_count () const { return count; }
+
+    //! Return the mean of the first vector
+    const Vector<M,T>& get_mean_x () const { return mean_x; }
+
+    //! Return the mean of the second vector
+    const Vector<N,T>& get_mean_y () const { return mean_y; }
+
+    //! Return the (biased) cross-covariance, normalized by the count
+    Matrix<M,N,T> get_covariance () const
+    {
+      if (count == 0)
+        return Matrix<M,N,T>();
+
+      Matrix<M,N,T> result = comoment;
+      result /= T(count);
+      return result;
+    }
+
+    //! Write the accumulated state to a checkpoint
+    void save (std::ostream& os) const
+    {
+      write_binary (os, count);
+      write_binary (os, mean_x);
+      write_binary (os, mean_y);
+      write_binary (os, comoment);
+    }
+
+    //! Restore the accumulated state from a checkpoint
+    void load (std::istream& is)
+    {
+      read_binary (is, count);
+      read_binary (is, mean_x);
+      read_binary (is, mean_y);
+      read_binary (is, comoment);
+    }
+  };
+
+  //! Accumulates the mean and covariance of a random vector
+  template<unsigned N, typename T = double>
+  class moment_accumulator
+  {
+    uint64_t count;
+    Vector<N,T> mean;
+
+    //! Sum of outer products of the deviations from the mean
+    Matrix<N,N,T> comoment;
+
+  public:
+
+    moment_accumulator () { count = 0; }
+
+    //! Add the next sample
+    void add (const Vector<N,T>& x)
+    {
+      count ++;
+      T weight = T(1.0 / double(count));
+
+      T delta[N], residual[N];
+
+      for (unsigned i=0; i<N; i++)
+      {
+        delta[i] = x[i] - mean[i];
+        mean[i] += delta[i] * weight;
+        residual[i] = x[i] - mean[i];
+      }
+
+      for (unsigned i=0; i<N; i++)
+        for (unsigned j=0; j<N; j++)
+          comoment[i][j] += delta[i] * residual[j];
+    }
+
+    //! Merge the statistics accumulated by another instance
+    void combine (const moment_accumulator& that)
+    {
+      if (that.count == 0)
+        return;
+
+      if (count == 0)
+      {
+        *this = that;
+        return;
+      }
+
+      uint64_t total = count + that.count;
+      double weight = double(that.count) / double(total);
+
+      Vector<N,T> delta = that.mean - mean;
+      mean += delta * T(weight);
+
+      Matrix<N,N,T> correction = outer (delta, delta);
+      correction *= T(weight * double(count));
+
+      comoment += that.comoment;
+      comoment += correction;
+
+      count = total;
+    }
+
+    //! Return the number of samples added
+    uint64_t get_count () const { return count; }
+
+    //! Return the mean
+    const Vector<N,T>& get_mean () const { return mean; }
+
+    //! Return the (biased) covariance, normalized by the count
+    Matrix<N,N,T> get_covariance () const
+    {
+      if (count == 0)
+        return Matrix<N,N,T>();
+
+      Matrix<N,N,T> result = comoment;
+      result /= T(count);
+      return result;
+    }
+
+    //! Return the mean outer product of the deviations from the specified mean
+    Matrix<N,N,T> get_covariance (const Vector<N,T>& about) const
+    {
+      Vector<N,T> offset = mean - about;
+      return get_covariance() + outer (offset, offset);
+    }
+
+    //! Write the accumulated state to a checkpoint
+    void save (std::ostream& os) const
+    {
+      write_binary (os, count);
+      write_binary (os, mean);
+      write_binary (os, comoment);
+    }
+
+    //! Restore the accumulated state from a checkpoint
+    void load (std::istream& is)
+    {
+      read_binary (is, count);
+      read_binary (is, mean);
+      read_binary (is, comoment);
+    }
+  };
+}
+
+#endif
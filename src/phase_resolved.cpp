@@ -0,0 +1,284 @@
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+#include "phase_resolved.h"
+#include "work_pool.h"
+#include "BoxMuller.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <random>
+#include <cmath>
+
+using namespace std;
+
+epsic::phase_resolved::phase_resolved ()
+{
+  reference = 0;
+  nthread = 1;
+  seed = 0;
+}
+
+epsic::phase_resolved::~phase_resolved ()
+{
+  for (unsigned ithread=0; ithread < thread_sample.size(); ithread++)
+    for (unsigned ibin=0; ibin < bins.size(); ibin++)
+    {
+      // the first thread uses the samples of each simulation
+      if (ithread > 0)
+        delete thread_sample[ithread][ibin];
+      delete thread_sinks[ithread][ibin];
+    }
+
+  for (auto normal : thread_normal)
+    delete normal;
+
+  for (auto bin : bins)
+    delete bin;
+}
+
+void epsic::phase_resolved::add (const simulation_config& config, double weight)
+{
+  if (bins.size())
+    throw std::runtime_error ("epsic::phase_resolved::add - "
+                              "cannot add a bin after the simulation has run");
+
+  if (weight <= 0)
+    throw std::runtime_error ("epsic::phase_resolved::add - invalid weight");
+
+  unsigned ibin = configs.size();
+
+  configs.push_back (config);
+  weights.push_back (weight);
+
+  double intensity = config.A.mean[0];
+  if (config.combination == simulation_config::Superposed)
+    intensity += config.B.mean[0];
+
+  double reference_intensity = configs[reference].A.mean[0];
+  if (configs[reference].combination == simulation_config::Superposed)
+    reference_intensity += configs[reference].B.mean[0];
+
+  if (intensity < reference_intensity)
+    reference = ibin;
+}
+
+void epsic::phase_resolved::add_on_off (const simulation_config& on,
+                                        double duty_cycle, double off_intensity)
+{
+  if (duty_cycle <= 0 || duty_cycle >= 1)
+    throw std::runtime_error ("epsic::phase_resolved::add_on_off - "
+                              "invalid duty cycle");
+
+  simulation_config off;
+  off.A.mean = Stokes<double> (off_intensity, 0, 0, 0);
+  off.sample_size = on.sample_size;
+  off.direct_sampling = on.direct_sampling;
+  off.compile = on.compile;
+
+  unsigned ion = configs.size();
+
+  add (on, duty_cycle);
+  add (off, 1.0 - duty_cycle);
+
+  // the off-pulse bin is the reference even if the source is faint
+  reference = ion + 1;
+}
+
+double epsic::phase_resolved::get_weight (unsigned ibin) const
+{
+  double total = 0;
+  for (auto w : weights)
+    total += w;
+
+  return weights.at(ibin) / total;
+}
+
+void epsic::phase_resolved::set_reference (unsigned ibin)
+{
+  if (ibin >= configs.size())
+    throw std::runtime_error ("epsic::phase_resolved::set_reference - "
+                              "invalid bin");
+  reference = ibin;
+}
+
+void epsic::phase_resolved::set_nthread (unsigned n)
+{
+  if (n == 0)
+    throw std::runtime_error ("epsic::phase_resolved::set_nthread - "
+                              "invalid number of threads");
+  if (bins.size())
+    throw std::runtime_error ("epsic::phase_resolved::set_nthread - "
+                              "cannot change the number of threads after run");
+  nthread = n;
+}
+
+/*
+  Each bin is constructed by a single-threaded simulation, whose sample
+  is used by the first thread and copied for the others.  Every thread
+  has one stream of random numbers, shared by all of its bins.
+*/
+void epsic::phase_resolved::setup ()
+{
+  if (configs.empty())
+    throw std::runtime_error ("epsic::phase_resolved::run - no phase bins");
+
+  if (!seed)
+  {
+    std::random_device rd;
+    seed = (uint64_t(rd()) << 32) | rd();
+  }
+
+  for (auto config : configs)
+  {
+    config.nthread = 1;
+    config.seed = seed;
+    config.nlag = 0;
+    config.rho_stats = false;
+    bins.push_back (new simulation (config));
+  }
+
+  thread_normal.resize (nthread);
+  thread_sample.resize (nthread);
+  thread_sinks.resize (nthread);
+
+  for (unsigned ithread=0; ithread < nthread; ithread++)
+  {
+    thread_normal[ithread] = new BoxMuller (seed, ithread);
+
+    for (auto bin : bins)
+    {
+      sample* s = bin->get_sample();
+      if (ithread > 0)
+        s = s->clone();
+
+      s->set_normal (thread_normal[ithread]);
+      thread_sample[ithread].push_back (s);
+
+      statistics* sinks = new statistics;
+      sinks->add (new stokes_moments);
+      sinks->add (new polarization_degree);
+      sinks->add (new intensity_moments);
+      thread_sinks[ithread].push_back (sinks);
+    }
+  }
+}
+
+//! Simulate the share of each bin in blocks, visiting the bins in turn
+static void simulate (std::vector<epsic::sample*>& samples,
+                      std::vector<epsic::statistics*>& sinks,
+                      std::vector<uint64_t> remaining)
+{
+  const unsigned block_size = 1024;
+  std::vector< Vector<4, double> > block (block_size);
+
+  bool done = false;
+  while (!done)
+  {
+    done = true;
+    for (unsigned ibin=0; ibin < samples.size(); ibin++)
+    {
+      unsigned n = std::min<uint64_t> (block_size, remaining[ibin]);
+      if (n == 0)
+        continue;
+
+      for (unsigned i=0; i<n; i++)
+        block[i] = samples[ibin]->get_Stokes();
+
+      sinks[ibin]->consume (block.data(), n);
+
+      remaining[ibin] -= n;
+      done = false;
+    }
+  }
+}
+
+void epsic::phase_resolved::run (uint64_t nsamp)
+{
+  if (bins.empty())
+    setup ();
+
+  std::vector<uint64_t> total (bins.size());
+  for (unsigned ibin=0; ibin < bins.size(); ibin++)
+    total[ibin] = llround (nsamp * get_weight (ibin));
+
+  run_threads (nthread, [&] (unsigned ithread)
+  {
+    std::vector<uint64_t> share (bins.size());
+    for (unsigned ibin=0; ibin < bins.size(); ibin++)
+      share[ibin] = total[ibin] / nthread + (ithread < total[ibin] % nthread);
+
+    simulate (thread_sample[ithread], thread_sinks[ithread], share);
+  });
+}
+
+epsic::statistics* epsic::phase_resolved::combine (unsigned ibin) const
+{
+  statistics* result = thread_sinks[0].at(ibin)->clone();
+
+  for (unsigned ithread=1; ithread < nthread; ithread++)
+    result->combine (*thread_sinks[ithread][ibin]);
+
+  return result;
+}
+
+epsic::simulation_result epsic::phase_resolved::get_result (unsigned ibin) const
+{
+  if (bins.empty())
+    throw std::runtime_error ("epsic::phase_resolved::get_result - "
+                              "the simulation has not been run");
+
+  statistics* sinks = combine (ibin);
+
+  simulation_result result;
+
+  auto moments = dynamic_cast<const stokes_moments*> (sinks->get (0));
+  result.stokes = moments->get_moments();
+
+  auto dop = dynamic_cast<const polarization_degree*> (sinks->get (1));
+  result.degree_of_polarization = dop->get_mean();
+
+  delete sinks;
+
+  sample* s = bins[ibin]->get_sample();
+  result.expected_mean = s->get_mean ();
+  result.expected_covariance = s->get_covariance ();
+
+  return result;
+}
+
+epsic::moment_accumulator<2>
+epsic::phase_resolved::get_intensity_moments (unsigned ibin) const
+{
+  if (bins.empty())
+    throw std::runtime_error ("epsic::phase_resolved::get_intensity_moments - "
+                              "the simulation has not been run");
+
+  statistics* sinks = combine (ibin);
+  auto intensities = dynamic_cast<const intensity_moments*> (sinks->get (2));
+  moment_accumulator<2> result = intensities->get_moments();
+  delete sinks;
+
+  return result;
+}
+
+Vector<4,double> epsic::phase_resolved::get_source_mean (unsigned ibin) const
+{
+  return get_result(ibin).get_mean() - get_result(reference).get_mean();
+}
+
+double epsic::phase_resolved::get_source_variance (unsigned ibin) const
+{
+  simulation_result on = get_result (ibin);
+  simulation_result off = get_result (reference);
+
+  double mean_off = off.get_mean()[0];
+  double mean_src = on.get_mean()[0] - mean_off;
+
+  return on.get_covariance()[0][0] - off.get_covariance()[0][0]
+    - mean_src * mean_off / configs[ibin].sample_size;
+}
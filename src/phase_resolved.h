@@ -0,0 +1,123 @@
+//-*-C++-*-
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+//! @file epsic/src/phase_resolved.h
+
+#ifndef __epsic_phase_resolved_h
+#define __epsic_phase_resolved_h
+
+#include "simulation.h"
+
+namespace epsic
+{
+  //! A simulation of the Stokes samples in each bin of a pulse profile
+  /*! Each phase bin is configured as a separate simulation and is
+    allotted a fraction of the Stokes samples proportional to its
+    weight.  The bins are simulated in a single pass: each thread
+    simulates blocks of samples from every bin in turn, drawing from
+    one stream of random numbers, and accumulates the moments of
+    each bin separately.
+
+    The bin with the lowest expected total intensity is used as the
+    off-pulse reference, from which the source statistics of the
+    other bins are derived. */
+  class phase_resolved
+  {
+    //! the configuration of each bin
+    std::vector<simulation_config> configs;
+
+    //! the fraction of the Stokes samples simulated in each bin
+    std::vector<double> weights;
+
+    //! the simulation that constructs the sample of each bin
+    std::vector<simulation*> bins;
+
+    unsigned reference;
+    unsigned nthread;
+    uint64_t seed;
+
+    std::vector<BoxMuller*> thread_normal;
+
+    //! the sample and sinks of each bin, indexed by thread then bin
+    std::vector< std::vector<sample*> > thread_sample;
+    std::vector< std::vector<statistics*> > thread_sinks;
+
+    //! Construct the bins and the samples, random streams and sinks of each thread
+    void setup ();
+
+    //! Return the sinks of the specified bin, combined over all threads
+    statistics* combine (unsigned ibin) const;
+
+  public:
+
+    phase_resolved ();
+    ~phase_resolved ();
+
+    phase_resolved (const phase_resolved&) = delete;
+    phase_resolved& operator = (const phase_resolved&) = delete;
+
+    //! Add a phase bin with the specified relative weight
+    /*! Bins must be added before the simulation is first run. */
+    void add (const simulation_config&, double weight = 1.0);
+
+    //! Add an on-pulse and an off-pulse bin with the specified duty cycle
+    /*! The off-pulse bin simulates unmodulated, unpolarized noise with
+      the specified total intensity and the sample size of on. */
+    void add_on_off (const simulation_config& on, double duty_cycle,
+                     double off_intensity = 1.0);
+
+    //! Return the number of phase bins
+    unsigned get_nbin () const { return configs.size(); }
+
+    //! Return the configuration of the specified bin
+    const simulation_config& get_config (unsigned ibin) const { return configs.at(ibin); }
+
+    //! Return the normalized weight of the specified bin
+    double get_weight (unsigned ibin) const;
+
+    //! Set the off-pulse reference bin
+    void set_reference (unsigned ibin);
+
+    //! Return the off-pulse reference bin
+    unsigned get_reference () const { return reference; }
+
+    //! Set the number of threads [default: 1]
+    void set_nthread (unsigned n);
+
+    //! Set the seed of the random number generator (0 = random)
+    void set_seed (uint64_t s) { seed = s; }
+
+    //! Return the seed, which is resolved when the simulation is first run
+    uint64_t get_seed () const { return seed; }
+
+    //! Simulate the next nsamp Stokes samples, shared between the bins
+    void run (uint64_t nsamp);
+
+    //! Return the simulated and expected statistics of the specified bin
+    simulation_result get_result (unsigned ibin) const;
+
+    //! Return the moments of the total and polarized intensity in the specified bin
+    moment_accumulator<2> get_intensity_moments (unsigned ibin) const;
+
+    //! Return the mean Stokes parameters of the source in the specified bin
+    /*! The source mean is the mean in the bin minus that of the reference. */
+    Vector<4,double> get_source_mean (unsigned ibin) const;
+
+    //! Return the variance of the total intensity of the source in the specified bin
+    /*! Assuming that each bin is the superposition of the source and
+      the noise in the reference bin, the source variance is
+
+      var_on - var_off - mean_src * mean_off / Nint
+
+      where Nint is the number of instances in each Stokes sample. */
+    double get_source_variance (unsigned ibin) const;
+  };
+
+} // end of namespace epsic
+
+#endif // ! defined __epsic_phase_resolved_h
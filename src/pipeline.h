@@ -0,0 +1,452 @@
+//-*-C++-*-
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+//! @file epsic/src/pipeline.h
+
+#ifndef __epsic_pipeline_h
+#define __epsic_pipeline_h
+
+#include "modulated.h"
+#include "smoothed.h"
+#include "field_kernel.h"
+
+#include <typeinfo>
+#include <stdexcept>
+#include <cmath>
+
+/*
+  Statically composed alternatives to the run-time decorators in
+  modulated.h and smoothed.h.  For example,
+
+    pipeline< gaussian_source, boxcar_mod<lognormal_mod>, boxcar_field >
+
+  generates the same field instances as a boxcar_mode that decorates a
+  boxcar_modulated_mode that smooths a lognormal_mode.  The types of all
+  stages are known at compile time, so that the transformations applied
+  by every stage to each field instance are inlined into a single loop.
+
+  Each stage is configured by copying the parameters of the equivalent
+  decorator, and draws its random numbers from the BoxMuller object in
+  the same order as the decorator; therefore, given the same seed, a
+  pipeline reproduces the decorated mode exactly.
+
+  A stage implements
+
+    bool configure (mode*& m)  copy the parameters of the equivalent
+                               decorator m and set m to its source
+    void start (U& upstream,   initialize any state using the output
+                BoxMuller*)    of the upstream stages
+    void prepare (BoxMuller*,  draw the random numbers needed to apply
+                  unsigned n)  the stage to the next n field instances
+    void apply (Spinor&)       transform the next field instance
+
+  A modulating function (e.g. lognormal_mod) is a stage that multiplies
+  each field instance by the square root of the next modulation factor.
+  It also implements
+
+    bool match (modulated_mode*)  copy the parameters of the equivalent
+                                  modulated_mode
+    double next ()                return the next prepared factor
+    double draw (BoxMuller*)      return a single new factor
+*/
+
+namespace epsic
+{
+  //! Normally distributed field instances, as generated by mode
+  class gaussian_source
+  {
+    Jones<double> polarizer;
+    double rms;
+
+    //! normal deviates used to generate a block of field instances
+    std::vector<float> normals;
+
+  public:
+
+    gaussian_source () { rms = 0; }
+
+    //! Copy the parameters of m, which must be an instance of mode
+    bool configure (mode* m)
+    {
+      if (typeid(*m) != typeid(mode))
+        return false;
+
+      polarizer = m->get_polarizer();
+      rms = m->get_rms();
+      return true;
+    }
+
+    //! Fill the array with n field instances
+    void generate (Spinor<double>* fields, unsigned n, BoxMuller* normal)
+    {
+      normals.resize (4*n);
+      normal->fill (normals.data(), 4*n);
+      polarize (fields, polarizer, rms, normals.data(), n);
+    }
+  };
+
+  //! Base class of stages that amplitude modulate the field
+  template<class Function>
+  class modulation_stage
+  {
+  public:
+
+    bool configure (mode*& m)
+    {
+      modulated_mode* mod = dynamic_cast<modulated_mode*> (m);
+      if (!mod || !static_cast<Function*>(this)->match (mod))
+        return false;
+
+      m = mod->get_source();
+      return true;
+    }
+
+    template<class Upstream>
+    void start (Upstream&, BoxMuller*) { }
+
+    //! multiply the field by the square root of the modulation factor
+    void apply (Spinor<double>& field)
+    {
+      field *= sqrt( static_cast<Function*>(this)->next() );
+    }
+  };
+
+  //! Modulation factors with a lognormal distribution, as by lognormal_mode
+  class lognormal_mod : public modulation_stage<lognormal_mod>
+  {
+    //! standard deviation of the logarithm of the random variate
+    double log_sigma;
+
+    std::vector<double> normals;
+    unsigned current;
+
+    double factor (double x) const
+    {
+      return exp ( log_sigma * (x - 0.5*log_sigma) );
+    }
+
+  public:
+
+    lognormal_mod () { log_sigma = 0; current = 0; }
+
+    bool match (modulated_mode* m)
+    {
+      if (typeid(*m) != typeid(lognormal_mode))
+        return false;
+
+      log_sigma = static_cast<lognormal_mode*>(m)->get_log_sigma();
+      return true;
+    }
+
+    void prepare (BoxMuller* normal, unsigned n)
+    {
+      normals.resize (n);
+      normal->fill (normals.data(), n);
+      current = 0;
+    }
+
+    double next () { return factor (normals[current++]); }
+
+    double draw (BoxMuller* normal) { return factor (normal->evaluate()); }
+  };
+
+  //! Modulating function smoothed by a running mean, as by boxcar_modulated_mode
+  template<class Function>
+  class boxcar_mod : public modulation_stage< boxcar_mod<Function> >
+  {
+    Function mod;
+    sliding_window<double> window;
+    unsigned smooth;
+
+    void setup (BoxMuller* normal)
+    {
+      window.resize (smooth);
+      for (unsigned i=1; i<smooth; i++)
+        window.add (mod.draw (normal));
+    }
+
+  public:
+
+    boxcar_mod () { smooth = 1; }
+
+    bool match (modulated_mode* m)
+    {
+      if (typeid(*m) != typeid(boxcar_modulated_mode))
+        return false;
+
+      boxcar_modulated_mode* boxcar = static_cast<boxcar_modulated_mode*>(m);
+      smooth = boxcar->get_smooth();
+      return mod.match (boxcar->get_modulator());
+    }
+
+    void prepare (BoxMuller* normal, unsigned n)
+    {
+      if (window.size() < smooth)
+        setup (normal);
+
+      mod.prepare (normal, n);
+    }
+
+    double next () { return window.add (mod.next()) / smooth; }
+
+    double draw (BoxMuller* normal)
+    {
+      if (window.size() < smooth)
+        setup (normal);
+
+      return window.add (mod.draw (normal)) / smooth;
+    }
+  };
+
+  //! Rectangular pulses of modulation, as by square_modulated_mode
+  template<class Function>
+  class square_mod : public modulation_stage< square_mod<Function> >
+  {
+    Function mod;
+    unsigned width;
+    unsigned current;
+    double value;
+
+    BoxMuller* normal;
+
+  public:
+
+    square_mod () { width = current = 1; value = 0; normal = 0; }
+
+    bool match (modulated_mode* m)
+    {
+      if (typeid(*m) != typeid(square_modulated_mode))
+        return false;
+
+      square_modulated_mode* square = static_cast<square_modulated_mode*>(m);
+      width = current = square->get_width();
+      return mod.match (square->get_modulator());
+    }
+
+    void prepare (BoxMuller* _normal, unsigned) { normal = _normal; }
+
+    double next () { return draw (normal); }
+
+    double draw (BoxMuller* _normal)
+    {
+      if (current == width)
+      {
+        value = mod.draw (_normal);
+        current = 0;
+      }
+
+      current ++;
+      return value;
+    }
+  };
+
+  //! Field smoothed by a running mean before detection, as by boxcar_mode
+  class boxcar_field
+  {
+    sliding_window< Spinor<double> > window;
+    unsigned smooth;
+    double norm;
+
+  public:
+
+    boxcar_field () { smooth = 1; norm = 1.0; }
+
+    bool configure (mode*& m)
+    {
+      if (typeid(*m) != typeid(boxcar_mode))
+        return false;
+
+      boxcar_mode* boxcar = static_cast<boxcar_mode*>(m);
+      smooth = boxcar->get_smooth();
+      norm = 1.0 / sqrt(smooth);
+      m = boxcar->get_source();
+      return true;
+    }
+
+    template<class Upstream>
+    void start (Upstream& upstream, BoxMuller* normal)
+    {
+      if (window.size() == smooth)
+        return;
+
+      window.resize (smooth);
+      for (unsigned i=1; i<smooth; i++)
+      {
+        Spinor<double> field;
+        upstream.generate (&field, 1, normal);
+        window.add (field);
+      }
+    }
+
+    void prepare (BoxMuller*, unsigned) { }
+
+    void apply (Spinor<double>& field) { field = window.add (field) * norm; }
+  };
+
+  //! The source of field instances at the start of a pipeline
+  template<class Source>
+  class pipeline_source
+  {
+    Source source;
+
+  public:
+
+    bool configure (mode*& m) { return source.configure (m); }
+
+    void begin (Spinor<double>* fields, unsigned n, BoxMuller* normal)
+    {
+      source.generate (fields, n, normal);
+    }
+
+    void apply (Spinor<double>&) { }
+
+    void generate (Spinor<double>* fields, unsigned n, BoxMuller* normal)
+    {
+      begin (fields, n, normal);
+    }
+  };
+
+  //! A stage applied to the output of the upstream stages of a pipeline
+  template<class Upstream, class Stage>
+  class pipeline_stage
+  {
+    Upstream upstream;
+    Stage stage;
+
+  public:
+
+    //! Configure from the outermost decorator inwards
+    bool configure (mode*& m)
+    {
+      return stage.configure (m) && upstream.configure (m);
+    }
+
+    //! Generate the source fields and prepare every stage to transform them
+    void begin (Spinor<double>* fields, unsigned n, BoxMuller* normal)
+    {
+      stage.start (upstream, normal);
+      upstream.begin (fields, n, normal);
+      stage.prepare (normal, n);
+    }
+
+    //! Apply every stage to the field instance
+    void apply (Spinor<double>& field)
+    {
+      upstream.apply (field);
+      stage.apply (field);
+    }
+
+    void generate (Spinor<double>* fields, unsigned n, BoxMuller* normal)
+    {
+      begin (fields, n, normal);
+      for (unsigned i=0; i<n; i++)
+        apply (fields[i]);
+    }
+  };
+
+  //! Nests each stage inside the next
+  template<class Upstream, class... Stages>
+  struct compose_stages
+  {
+    typedef Upstream type;
+  };
+
+  template<class Upstream, class Stage, class... Rest>
+  struct compose_stages<Upstream, Stage, Rest...>
+  {
+    typedef typename compose_stages< pipeline_stage<Upstream,Stage>,
+                                     Rest... >::type type;
+  };
+
+  //! A statically composed mode that reproduces a chain of decorators
+  /*! The decorated chain computes the expected statistics; the
+    pipeline generates the field instances. */
+  template<class Source, class... Stages>
+  class pipeline : public mode_decorator
+  {
+    typedef typename compose_stages< pipeline_source<Source>,
+                                     Stages... >::type stages_type;
+    stages_type stages;
+
+    //! revision of the source when the stages were configured
+    uint64_t configured;
+
+    void configure ()
+    {
+      stages = stages_type();
+
+      mode* m = source;
+      if (!stages.configure (m))
+        throw std::runtime_error ("epsic::pipeline::configure - "
+                                  "mode does not match the stages");
+
+      configured = source->get_revision();
+    }
+
+  public:
+
+    //! Return true if the pipeline can reproduce the mode
+    static bool matches (mode* m)
+    {
+      stages_type test;
+      return test.configure (m);
+    }
+
+    pipeline (mode* s) : mode_decorator (s) { configure (); }
+
+    pipeline* clone () const { return copy (this); }
+
+    Spinor<double> get_field ()
+    {
+      Spinor<double> field;
+      get_fields (&field, 1);
+      return field;
+    }
+
+    void get_fields (Spinor<double>* fields, unsigned n)
+    {
+      if (source->get_revision() != configured)
+        configure ();
+
+      BoxMuller* normal = get_normal();
+      if (!normal)
+        throw std::runtime_error ("epsic::pipeline::get_fields - BoxMuller not set");
+
+      stages.generate (fields, n, normal);
+    }
+
+    Matrix<4,4, double> get_crosscovariance (unsigned ilag) const
+    { return source->get_cached_crosscovariance (ilag); }
+
+    unsigned get_correlation_length () const
+    { return source->get_correlation_length (); }
+  };
+
+  //! Replaces decorated modes with equivalent statically composed pipelines
+  template<class... Pipelines>
+  struct pipeline_registry
+  {
+    //! Return the first of the Pipelines that reproduces m, or m if none do
+    static mode* compile (mode* m) { return m; }
+  };
+
+  template<class First, class... Rest>
+  struct pipeline_registry<First, Rest...>
+  {
+    static mode* compile (mode* m)
+    {
+      if (First::matches (m))
+        return new First (m);
+
+      return pipeline_registry<Rest...>::compile (m);
+    }
+  };
+
+} // end of namespace epsic
+
+#endif // ! defined __epsic_pipeline_h
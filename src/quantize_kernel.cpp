@@ -0,0 +1,209 @@
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+#include "quantize_kernel.h"
+#include "SIMD.h"
+
+#if SIMD_X86
+#include <immintrin.h>
+#endif
+
+#include <stdexcept>
+#include <cstring>
+#include <cmath>
+
+/*
+  The values are scaled, rounded down, offset and clipped in double
+  precision, so that every path produces the same codes; a NaN is
+  clipped to zero.  The vectorized kernels quantize four instances
+  (sixteen values) per iteration and narrow the codes to sixteen bytes,
+  which are then packed by multiplying and adding adjacent codes.
+*/
+
+static_assert (sizeof(Spinor<double>) == 4 * sizeof(double),
+               "Spinor<double> must be stored as four consecutive doubles");
+
+//! Portable implementation
+static void quantize_scalar (unsigned char* packed, const double* e,
+                             unsigned n, unsigned nbit, const double scale[4])
+{
+  const double offset = 1 << (nbit-1);
+  const double top = (1 << nbit) - 1;
+
+  for (unsigned i=0; i<n; i++, e+=4)
+  {
+    unsigned code[4];
+    for (unsigned k=0; k<4; k++)
+    {
+      double c = std::floor (e[k] * scale[k]) + offset;
+      c = (c > 0.0) ? c : 0.0;
+      code[k] = (c < top) ? c : top;
+    }
+
+    switch (nbit)
+    {
+    case 8:
+      for (unsigned k=0; k<4; k++)
+        packed[k] = code[k];
+      packed += 4;
+      break;
+    case 4:
+      packed[0] = code[0] | (code[1] << 4);
+      packed[1] = code[2] | (code[3] << 4);
+      packed += 2;
+      break;
+    case 2:
+      packed[0] = code[0] | (code[1] << 2) | (code[2] << 4) | (code[3] << 6);
+      packed += 1;
+      break;
+    }
+  }
+}
+
+#if SIMD_X86
+
+//! Pack sixteen 8-bit codes into 16, 8 or 4 bytes
+SIMD_TARGET_AVX2 SIMD_INLINE
+static void store_codes (unsigned char* packed, __m128i codes, unsigned nbit)
+{
+  if (nbit == 8)
+  {
+    _mm_storeu_si128 (reinterpret_cast<__m128i*> (packed), codes);
+    return;
+  }
+
+  // c0 + 16 c1 (4-bit) or c0 + 4 c1 (2-bit) in each 16-bit element
+  __m128i pairs = _mm_maddubs_epi16 (codes, _mm_set1_epi16 (nbit == 4 ? 0x1001 : 0x0401));
+
+  if (nbit == 4)
+  {
+    _mm_storel_epi64 (reinterpret_cast<__m128i*> (packed), _mm_packus_epi16 (pairs, pairs));
+    return;
+  }
+
+  // p0 + 16 p1 in each 32-bit element
+  __m128i quads = _mm_madd_epi16 (pairs, _mm_set1_epi32 (0x00100001));
+  quads = _mm_packs_epi32 (quads, quads);
+  int32_t bytes = _mm_cvtsi128_si32 (_mm_packus_epi16 (quads, quads));
+  memcpy (packed, &bytes, sizeof(bytes));
+}
+
+//! Two field instances per 512-bit register
+SIMD_TARGET_AVX512
+static void quantize_avx512 (unsigned char* packed, const double* e,
+                             unsigned n, unsigned nbit, const double scale[4])
+{
+  const __m512d s = _mm512_setr_pd (scale[0], scale[1], scale[2], scale[3],
+                                    scale[0], scale[1], scale[2], scale[3]);
+  const __m512d offset = _mm512_set1_pd (1 << (nbit-1));
+  const __m512d top = _mm512_set1_pd ((1 << nbit) - 1);
+  const __m512d zero = _mm512_setzero_pd ();
+
+  unsigned quads = n / 4;
+  for (unsigned i=0; i<quads; i++, e+=16, packed+=2*nbit)
+  {
+    /* the zero-masking forms of the intrinsics (with every element
+       selected) avoid spurious -Wuninitialized warnings from GCC 12 */
+    __m256i c[2];
+    for (unsigned j=0; j<2; j++)
+    {
+      __m512d v = _mm512_mul_pd (_mm512_loadu_pd (e + 8*j), s);
+      v = _mm512_maskz_roundscale_pd (0xFF, v, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+      v = _mm512_maskz_max_pd (0xFF, _mm512_add_pd (v, offset), zero);
+      v = _mm512_maskz_min_pd (0xFF, v, top);
+      c[j] = _mm512_maskz_cvtpd_epi32 (0xFF, v);
+    }
+
+    // packs operates within 128-bit lanes; restore the order of the codes
+    __m256i words = _mm256_permute4x64_epi64 (_mm256_packs_epi32 (c[0], c[1]), 0xD8);
+    __m128i codes = _mm_packus_epi16 (_mm256_castsi256_si128 (words),
+                                      _mm256_extracti128_si256 (words, 1));
+
+    store_codes (packed, codes, nbit);
+  }
+
+  /* GCC does not clear the upper halves of the registers before the
+     tail call, which makes later SSE code very slow */
+  _mm256_zeroupper ();
+
+  quantize_scalar (packed, e, n % 4, nbit, scale);
+}
+
+//! One field instance per 256-bit register
+SIMD_TARGET_AVX2
+static void quantize_avx2 (unsigned char* packed, const double* e,
+                           unsigned n, unsigned nbit, const double scale[4])
+{
+  const __m256d s = _mm256_loadu_pd (scale);
+  const __m256d offset = _mm256_set1_pd (1 << (nbit-1));
+  const __m256d top = _mm256_set1_pd ((1 << nbit) - 1);
+  const __m256d zero = _mm256_setzero_pd ();
+
+  unsigned quads = n / 4;
+  for (unsigned i=0; i<quads; i++, e+=16, packed+=2*nbit)
+  {
+    __m128i c[4];
+    for (unsigned j=0; j<4; j++)
+    {
+      __m256d v = _mm256_floor_pd (_mm256_mul_pd (_mm256_loadu_pd (e + 4*j), s));
+      v = _mm256_min_pd (_mm256_max_pd (_mm256_add_pd (v, offset), zero), top);
+      c[j] = _mm256_cvtpd_epi32 (v);
+    }
+
+    __m128i codes = _mm_packus_epi16 (_mm_packs_epi32 (c[0], c[1]),
+                                      _mm_packs_epi32 (c[2], c[3]));
+    store_codes (packed, codes, nbit);
+  }
+
+  quantize_scalar (packed, e, n % 4, nbit, scale);
+}
+
+#endif
+
+void epsic::quantize (unsigned char* packed, const Spinor<double>* fields,
+                      unsigned n, unsigned nbit, double scale_x, double scale_y)
+{
+  if (nbit != 2 && nbit != 4 && nbit != 8)
+    throw std::runtime_error ("epsic::quantize - invalid number of bits");
+
+  const double scale[4] = { scale_x, scale_x, scale_y, scale_y };
+  const double* e = reinterpret_cast<const double*> (fields);
+
+  switch (SIMD::get_path())
+  {
+#if SIMD_X86
+  case SIMD::AVX512:
+    quantize_avx512 (packed, e, n, nbit, scale);
+    break;
+  case SIMD::AVX2:
+    quantize_avx2 (packed, e, n, nbit, scale);
+    break;
+#endif
+  default:
+    quantize_scalar (packed, e, n, nbit, scale);
+  }
+}
+
+void epsic::unpack (Spinor<double>* fields, const unsigned char* packed,
+                    unsigned n, unsigned nbit, double scale_x, double scale_y)
+{
+  if (nbit != 2 && nbit != 4 && nbit != 8)
+    throw std::runtime_error ("epsic::unpack - invalid number of bits");
+
+  const double scale[4] = { scale_x, scale_x, scale_y, scale_y };
+  const double offset = (1 << (nbit-1)) - 0.5;
+  const unsigned mask = (1 << nbit) - 1;
+
+  double* e = reinterpret_cast<double*> (fields);
+
+  for (unsigned i=0; i < 4*n; i++)
+  {
+    unsigned bit = i * nbit;
+    unsigned code = (packed[bit / 8] >> (bit % 8)) & mask;
+    e[i] = (code - offset) / scale[i % 4];
+  }
+}
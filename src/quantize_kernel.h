@@ -0,0 +1,35 @@
+//-*-C++-*-
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+//! @file epsic/src/quantize_kernel.h
+
+#ifndef __epsic_quantize_kernel_h
+#define __epsic_quantize_kernel_h
+
+#include "Spinor.h"
+
+namespace epsic
+{
+  //! Quantize n field instances and pack them into nbit-bit codes
+  /*! Each value (Re x, Im x, Re y, Im y) of each instance is multiplied
+    by the scale of its polarization and mapped to the code
+    c = floor(value * scale) + 2^(nbit-1), clipped to [0, 2^nbit - 1];
+    i.e. c represents (c - 2^(nbit-1) + 0.5) / scale.  The codes are
+    packed in order, starting with the least significant bits of each
+    byte, so that each instance occupies nbit/2 bytes.  nbit must be 2,
+    4 or 8.  Uses AVX-512 or AVX2 instructions when supported by the
+    processor. */
+  void quantize (unsigned char* packed, const Spinor<double>* fields,
+                 unsigned n, unsigned nbit, double scale_x, double scale_y);
+
+  //! Unpack n field instances packed by quantize with the same scales
+  void unpack (Spinor<double>* fields, const unsigned char* packed,
+               unsigned n, unsigned nbit, double scale_x, double scale_y);
+}
+
+#endif // ! defined __epsic_quantize_kernel_h
@@ -0,0 +1,97 @@
+//-*-C++-*-
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+//! @file epsic/src/ring_buffer.h
+
+#ifndef __epsic_ring_buffer_h
+#define __epsic_ring_buffer_h
+
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+
+namespace epsic
+{
+  //! Fixed-capacity first-in first-out queue
+  /*! The buffer is lock-free and safe to use when a single producer
+    thread calls push while a single consumer thread calls pop.  The
+    capacity is rounded up to a power of two. */
+  template<typename T>
+  class ring_buffer
+  {
+    std::vector<T> data;
+    uint64_t mask;
+
+    //! total number of elements popped, modified only by the consumer
+    alignas(64) std::atomic<uint64_t> head;
+
+    //! total number of elements pushed, modified only by the producer
+    alignas(64) std::atomic<uint64_t> tail;
+
+  public:
+
+    ring_buffer (unsigned capacity)
+    {
+      uint64_t size = 1;
+      while (size < capacity)
+        size *= 2;
+
+      data.resize (size);
+      mask = size - 1;
+      head = tail = 0;
+    }
+
+    ring_buffer (const ring_buffer&) = delete;
+    ring_buffer& operator = (const ring_buffer&) = delete;
+
+    //! Return the maximum number of elements in the buffer
+    uint64_t capacity () const { return data.size(); }
+
+    //! Return the number of elements that can be popped
+    uint64_t size () const
+    { return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire); }
+
+    //! Return the number of elements that can be pushed
+    uint64_t space () const { return capacity() - size(); }
+
+    //! Return true if there are no elements to pop
+    bool empty () const { return size() == 0; }
+
+    //! Copy up to n elements into the buffer; return the number copied
+    unsigned push (const T* x, unsigned n)
+    {
+      uint64_t end = tail.load (std::memory_order_relaxed);
+      uint64_t start = head.load (std::memory_order_acquire);
+
+      n = std::min<uint64_t> (n, capacity() - (end - start));
+      for (unsigned i=0; i<n; i++)
+        data[(end + i) & mask] = x[i];
+
+      tail.store (end + n, std::memory_order_release);
+      return n;
+    }
+
+    //! Copy up to n elements out of the buffer; return the number copied
+    unsigned pop (T* x, unsigned n)
+    {
+      uint64_t start = head.load (std::memory_order_relaxed);
+      uint64_t end = tail.load (std::memory_order_acquire);
+
+      n = std::min<uint64_t> (n, end - start);
+      for (unsigned i=0; i<n; i++)
+        x[i] = data[(start + i) & mask];
+
+      head.store (start + n, std::memory_order_release);
+      return n;
+    }
+  };
+
+} // end of namespace epsic
+
+#endif // ! defined __epsic_ring_buffer_h
@@ -7,19 +7,85 @@
  ***************************************************************************/
 
 #include "sample.h"
+#include "stokes_kernel.h"
+
+#include <stdexcept>
+#include <cmath>
+
+/*! Uses the Bartlett decomposition of the complex Wishart distribution;
+  the summed coherency matrix is L B B^dagger L^dagger, where L is the
+  Cholesky factor of the field covariance matrix and B is lower
+  triangular with |B_ii|^2 drawn from Gamma(n-i+1) and B_21 drawn from
+  the standard complex normal distribution.  The Stokes parameters of
+  the summed coherency matrix are the sum of the Stokes parameters of
+  the columns of L B. */
+Stokes<double> epsic::sample::get_Wishart_Stokes (const Jones<double>& covariance,
+                                                  BoxMuller* normal)
+{
+  if (!normal)
+    throw std::runtime_error ("epsic::sample::get_Wishart_Stokes - BoxMuller not set");
+
+  // Cholesky decomposition of the field covariance matrix
+  double l00 = sqrt (covariance.j00.real());
+  std::complex<double> l10 = 0.0;
+  if (l00 > 0)
+    l10 = covariance.j10 / l00;
+  double l11 = sqrt (std::max (0.0, covariance.j11.real() - norm(l10)));
+
+  // Bartlett decomposition
+  double b00 = sqrt (normal->gamma (sample_size));
+  double b11 = sqrt (normal->gamma (sample_size - 1));
+  std::complex<double> b10 (normal->evaluate(), normal->evaluate());
+  b10 *= M_SQRT1_2;
+
+  Spinor<double> column0 (l00 * b00, l10 * b00 + l11 * b10);
+  Spinor<double> column1 (0.0, l11 * b11);
+
+  Vector<4, double> tmp;
+  compute_stokes (tmp, column0);
+
+  Stokes<double> result = tmp;
+  compute_stokes (tmp, column1);
+  result += tmp;
+
+  result /= sample_size;
+  return result;
+}
+
+Stokes<double> epsic::single::get_Stokes ()
+{
+  if (direct_sampling && source->is_normal())
+    return get_Wishart_Stokes (source->get_field_covariance(),
+                               source->get_normal());
+
+  fields.resize (block_size);
+
+  Stokes<double> result;
+  for (unsigned i=0; i<sample_size; i+=block_size)
+  {
+    unsigned n = get_block (i, sample_size);
+    source->get_fields (fields.data(), n);
+    accumulate_stokes (result, fields.data(), n);
+  }
+  result /= sample_size;
+  return result;
+}
 
 //! Sums the sample_size by sample_size square on the diagonal
 /*! worker function for sub-classes */
 Matrix<4,4, double> epsic::sample::get_covariance (mode* s, unsigned sample_size)
 {
-  Matrix<4,4, double> result = s->get_covariance ();
+  Matrix<4,4, double> result = s->get_cached_covariance ();
 
   // sum the sample_size instances along the diagonal
   result *= sample_size;
 
-  for (unsigned ilag=1; ilag < sample_size; ilag++)
+  // lags beyond the correlation length do not contribute
+  unsigned max_lag = std::min (sample_size, s->get_correlation_length());
+
+  for (unsigned ilag=1; ilag < max_lag; ilag++)
   {
-    Matrix<4,4, double> out = s->get_crosscovariance (ilag);
+    Matrix<4,4, double> out = s->get_cached_crosscovariance (ilag);
 
 #ifdef _DEBUG
     std::cerr << "ilag=" << ilag << " C=" << out << std::endl;
@@ -40,29 +106,60 @@ Matrix<4,4, double> epsic::sample::get_covariance (mode* s, unsigned sample_size
     covariance matrix of the sample mean
   */
     
-  result /= sample_size * sample_size;
+  result /= double(sample_size) * sample_size;
   return result;
 }
 
 //! Sums the sample_size by sample_size square off the diagonal
-/*! starts at at_lag * sample_size off the diagonal */
+/*! starts at at_lag * sample_size off the diagonal
+
+  The element (i,j) of the square corresponds to the mode lag
+  |at_lag*sample_size + i - j|; each difference d = i - j occurs
+  sample_size - |d| times.  The terms are therefore summed once for
+  each distinct mode lag, weighted by its multiplicity.
+*/
 Matrix<4,4, double> epsic::sample::get_crosscovariance (mode* s, unsigned at_lag,
 						 unsigned sample_size)
 {
   Matrix<4,4, double> result (0);
-    
-  for (unsigned ilag=0; ilag < sample_size; ilag++)
-    for (unsigned jlag=0; jlag < sample_size; jlag++)
+
+  uint64_t length = s->get_correlation_length();
+
+  if (at_lag == 0)
+  {
+    // differences d and -d correspond to the same mode lag
+    uint64_t max_lag = std::min<uint64_t> (sample_size, length);
+    for (unsigned ilag=0; ilag < max_lag; ilag++)
     {
-      unsigned mode_lag = std::abs(int(at_lag*sample_size+ilag) - int(jlag));
-      result += s->get_crosscovariance (mode_lag);
+      Matrix<4,4, double> out = s->get_cached_crosscovariance (ilag);
+      if (ilag == 0)
+        out *= sample_size;
+      else
+        out *= 2.0 * (sample_size - ilag);
+      result += out;
     }
-  
+  }
+  else
+  {
+    // mode lags run from (at_lag-1)*sample_size+1 to (at_lag+1)*sample_size-1
+    uint64_t centre = uint64_t(at_lag) * sample_size;
+    uint64_t start = centre - sample_size + 1;
+    uint64_t end = std::min (centre + sample_size, length);
+
+    for (uint64_t mode_lag=start; mode_lag < end; mode_lag++)
+    {
+      uint64_t offset = mode_lag > centre ? mode_lag - centre : centre - mode_lag;
+      Matrix<4,4, double> out = s->get_cached_crosscovariance (mode_lag);
+      out *= double(sample_size - offset);
+      result += out;
+    }
+  }
+
   /*          
     divide by sample_size squared because this function returns the
     cross covariance matrix of the sample mean
   */
     
-  result /= sample_size * sample_size;
+  result /= double(sample_size) * sample_size;
   return result;
 }
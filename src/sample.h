@@ -12,23 +12,55 @@
 #define __epsic_sample_h
 
 #include "mode.h"
+#include "sliding_window.h"
 
 #include <cstdlib>
 #include <vector>
+#include <algorithm>
 
 namespace epsic
 {
   //! sample of electric field instances used to compute the Stokes parameters
   class sample
   {
+  protected:
+
+    //! maximum number of field instances generated in each block
+    static constexpr unsigned block_size = 256;
+
+    //! Return the number of instances in the block that starts at offset
+    static unsigned get_block (unsigned offset, unsigned size)
+    { return std::min (block_size, size - offset); }
+
+    //! Draw the sample mean Stokes parameters directly, when possible
+    bool direct_sampling;
+
+    //! Return the mean Stokes parameters of sample_size independent instances
+    /*! The instances are drawn from a complex normal distribution with
+      the specified field covariance matrix; their summed coherency
+      matrix is drawn directly from the complex Wishart distribution. */
+    Stokes<double> get_Wishart_Stokes (const Jones<double>& covariance,
+                                       BoxMuller* normal);
+
   public:
 
     unsigned sample_size;
 
-    sample() { sample_size = 1; }
+    sample() { sample_size = 1; direct_sampling = true; }
+
+    //! Enable or disable direct sampling of the sample mean Stokes parameters
+    /*! When enabled, samples of independent normally distributed field
+      instances are drawn at a cost that does not depend on sample_size */
+    void set_direct_sampling (bool flag) { direct_sampling = flag; }
 
     virtual ~sample () {}
 
+    //! Return a new copy of this instance, including copies of all sources
+    virtual sample* clone () const = 0;
+
+    //! Set the random number generator used by all sources
+    virtual void set_normal (BoxMuller*) = 0;
+
     virtual Stokes<double> get_Stokes () = 0;
     virtual Vector<4, double> get_mean () = 0;
     virtual Matrix<4,4, double> get_covariance () = 0;
@@ -43,6 +75,10 @@ namespace epsic
   //! sample defined by a single source of electromagnetic radiation
   class single : public sample
   {
+  protected:
+    //! block of electric field instances
+    std::vector< Spinor<double> > fields;
+
   public:
     mode* source;
 
@@ -50,6 +86,11 @@ namespace epsic
 
     ~single () { delete source; }
 
+    single* clone () const
+    { single* result = new single (*this); result->source = source->clone(); return result; }
+
+    void set_normal (BoxMuller* n) { source->set_normal (n); }
+
     virtual Stokes<double> get_Stokes_instance ()
     {
       Spinor<double> e = source->get_field();
@@ -58,14 +99,7 @@ namespace epsic
       return tmp;
     }
 
-    Stokes<double> get_Stokes ()
-    {
-      Stokes<double> result;
-      for (unsigned i=0; i<sample_size; i++)
-        result += get_Stokes_instance();
-      result /= sample_size;
-      return result;
-    }
+    Stokes<double> get_Stokes ();
 
     Vector<4, double> get_mean ()
     {
@@ -91,14 +125,28 @@ namespace epsic
   protected:
     double intensity_covariance;
 
+    //! random number generator shared by both sources
+    BoxMuller* normal;
+
+    //! Replace the sources with copies; called by clone
+    void clone_sources () { A = A->clone(); B = B->clone(); }
+
+    //! blocks of electric field instances from each source
+    std::vector< Spinor<double> > fields_A;
+    std::vector< Spinor<double> > fields_B;
+
   public:
     mode* A;
     mode* B;
 
-    combination () { A = new mode; B = new mode; intensity_covariance = 0; }
+    combination ()
+    { A = new mode; B = new mode; intensity_covariance = 0; normal = 0; }
+
+    //! Delete both sources, as single deletes its source
+    ~combination () { delete A; delete B; }
 
     virtual void set_normal (BoxMuller* n)
-    { A->set_normal(n); B->set_normal(n); }
+    { A->set_normal(n); B->set_normal(n); normal = n; }
 
     //! Covariant mode intensities
     void set_intensity_covariance (double covar) { intensity_covariance = covar; }
@@ -116,6 +164,10 @@ namespace epsic
   //! sample defined by a superposition of two sources of electromagnetic radiation
   class superposed : public combination
   {
+  public:
+    superposed* clone () const
+    { superposed* result = new superposed (*this); result->clone_sources(); return result; }
+
     Stokes<double> get_Stokes ();
     Vector<4, double> get_mean ();
     Matrix<4,4, double> get_covariance ();
@@ -130,6 +182,9 @@ namespace epsic
 
     composite (double fraction) { A_fraction = fraction; }
 
+    composite* clone () const
+    { composite* result = new composite (*this); result->clone_sources(); return result; }
+
     Stokes<double> get_Stokes ();
     Vector<4, double> get_mean ();
     Matrix<4,4, double> get_covariance ();
@@ -144,6 +199,9 @@ namespace epsic
 
     disjoint (double fraction) { A_fraction = fraction; }
 
+    disjoint* clone () const
+    { disjoint* result = new disjoint (*this); result->clone_sources(); return result; }
+
     Stokes<double> get_Stokes ();
     Vector<4, double> get_mean ();
     Matrix<4,4, double> get_covariance ();
@@ -154,34 +212,38 @@ namespace epsic
   //! sample defined by a post-detection boxcar-smoothed source of electromagnetic radiation
   class boxcar_sample : public single
   {
-    std::vector< Stokes<double> > instances;
+    sliding_window< Stokes<double> > window;
     unsigned smooth;
-    unsigned current;
 
     void setup()
     {
-      current = 0;
-      instances.resize (smooth);
+      window.resize (smooth);
       for (unsigned i=1; i<smooth; i++)
-        instances[i] = single::get_Stokes_instance();
+        window.add (single::get_Stokes_instance());
     }
 
   public:
 
     boxcar_sample (mode* s, unsigned n) : single(s) { smooth = n; }
 
+    boxcar_sample* clone () const
+    { boxcar_sample* result = new boxcar_sample (*this); result->source = source->clone(); return result; }
+
+    Stokes<double> get_Stokes ()
+    {
+      Stokes<double> result;
+      for (unsigned i=0; i<sample_size; i++)
+        result += get_Stokes_instance();
+      result /= sample_size;
+      return result;
+    }
+
     Stokes<double> get_Stokes_instance ()
     {
-      if (instances.size() < smooth)
+      if (window.size() < smooth)
         setup ();
 
-      instances[current] = single::get_Stokes_instance();
-      current = (current + 1) % smooth;
-
-      Stokes<double> result;
-      for (unsigned i=0; i<smooth; i++)
-        result += instances[i];
-
+      Stokes<double> result = window.add (single::get_Stokes_instance());
       result /= smooth;
       return result;
     }
@@ -207,6 +269,8 @@ namespace epsic
   public:
 
     coherent (double coherence);
+    ~coherent () { delete coupling; }
+    coherent* clone () const;
     void set_normal (BoxMuller*);
     
     Stokes<double> get_Stokes ();
@@ -0,0 +1,481 @@
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+#include "simulation.h"
+#include "modulated.h"
+#include "smoothed.h"
+#include "covariant.h"
+#include "pipeline.h"
+#include "work_pool.h"
+#include "BoxMuller.h"
+
+#include <algorithm>
+#include <limits>
+#include <sstream>
+#include <cstring>
+#include <stdexcept>
+#include <random>
+#include <cmath>
+
+using namespace std;
+
+double epsic::simulation_result::get_modulation_index () const
+{
+  return sqrt( stokes.get_covariance()[0][0] ) / stokes.get_mean()[0];
+}
+
+namespace epsic
+{
+  //! Statically composed pipelines for the common combinations of -l, -b, -r and -m
+  typedef pipeline_registry<
+    pipeline< gaussian_source, lognormal_mod >,
+    pipeline< gaussian_source, boxcar_mod<lognormal_mod> >,
+    pipeline< gaussian_source, square_mod<lognormal_mod> >,
+    pipeline< gaussian_source, boxcar_field >,
+    pipeline< gaussian_source, lognormal_mod, boxcar_field >,
+    pipeline< gaussian_source, boxcar_mod<lognormal_mod>, boxcar_field >,
+    pipeline< gaussian_source, square_mod<lognormal_mod>, boxcar_field >
+    > compiled_modes;
+}
+
+epsic::simulation::simulation (const simulation_config& _config)
+  : config (_config)
+{
+  if (config.nthread == 0)
+    throw std::runtime_error ("epsic::simulation - invalid number of threads");
+
+  if (!config.seed)
+  {
+    std::random_device rd;
+    config.seed = (uint64_t(rd()) << 32) | rd();
+  }
+
+  covariant = 0;
+  compiled = false;
+  combined = 0;
+  combined_current = false;
+  nsamp_total = 0;
+  checkpoint_path = SIMD::get_path ();
+
+  if (config.covariant)
+  {
+    covariant = new bivariate_lognormal_modes (config.mode_correlation);
+    covariant->set_diagnostic (true);
+  }
+
+  combination* dual = 0;
+
+  switch (config.combination)
+  {
+  case simulation_config::Single:
+    break;
+  case simulation_config::Superposed:
+    dual = new superposed;
+    break;
+  case simulation_config::Composite:
+    dual = new composite (config.combination_parameter);
+    break;
+  case simulation_config::Disjoint:
+    dual = new disjoint (config.combination_parameter);
+    break;
+  case simulation_config::Coherent:
+    dual = new coherent (config.combination_parameter);
+    // coherent superposition transforms the fields of each mode separately
+    config.compile = false;
+    break;
+  }
+
+  if (dual)
+  {
+    stokes_sample = dual;
+
+    // the sample owns the outermost mode of each source
+    modes.push_back (dual->A);
+    dual->A = setup_mode (dual->A, config.A, 0);
+    modes.pop_back ();
+
+    modes.push_back (dual->B);
+    dual->B = setup_mode (dual->B, config.B, 1);
+    modes.pop_back ();
+
+    if (covariant)
+      dual->set_intensity_covariance (covariant->get_intensity_covariance());
+  }
+  else
+  {
+    mode* source = new mode;
+    modes.push_back (source);
+
+    mode* s = setup_mode (source, config.A, 0);
+
+    // the sample owns the outermost mode
+    modes.pop_back ();
+
+    if (config.smooth_after > 1)
+      stokes_sample = new boxcar_sample (s, config.smooth_after);
+    else
+      stokes_sample = new single (s);
+  }
+
+  stokes_sample->sample_size = config.sample_size;
+  stokes_sample->set_direct_sampling (config.direct_sampling);
+
+  moments_index = sinks.size();
+  sinks.add (new stokes_moments);
+
+  dop_index = sinks.size();
+  sinks.add (new polarization_degree);
+
+  acf_index = rho_index = 0;
+
+  if (config.nlag)
+  {
+    acf_index = sinks.size();
+    sinks.add (new stokes_acf (config.nlag));
+  }
+
+  if (config.rho_stats)
+  {
+    rho_index = sinks.size();
+    sinks.add (new coherency_moments);
+  }
+}
+
+epsic::mode* epsic::simulation::setup_mode (mode* s, const mode_config& setup,
+                                            unsigned index)
+{
+  modulated_mode* mod = 0;
+
+  if (setup.baseband_file.empty())
+    s->set_Stokes (setup.mean);
+  else
+  {
+    // replace the simulated source with recorded fields
+    file_mode* f = new file_mode (setup.baseband_file, setup.baseband_format,
+                                  setup.baseband_offset);
+    recorded.push_back (f);
+    modes.push_back (s = f);
+  }
+
+  if (covariant)
+  {
+    if (setup.beta != 0.0)
+      covariant->set_beta (index, setup.beta);
+    s = mod = covariant->get_modulated_mode (index, s);
+    modes.push_back (s);
+  }
+  else if (setup.beta != 0.0)
+  {
+    s = mod = new lognormal_mode (s, setup.beta);
+    modes.push_back (s);
+  }
+
+  if (setup.smooth_modulator > 1 && mod)
+  {
+    s = new boxcar_modulated_mode (mod, setup.smooth_modulator);
+    modes.push_back (s);
+  }
+
+  if (setup.square_modulator > 1 && mod)
+  {
+    s = new square_modulated_mode (mod, setup.square_modulator, config.sample_size);
+    modes.push_back (s);
+  }
+
+  if (setup.smooth_before > 1)
+  {
+    s = new boxcar_mode (s, setup.smooth_before);
+    modes.push_back (s);
+  }
+
+  if (config.compile)
+  {
+    mode* p = compiled_modes::compile (s);
+    if (p != s)
+    {
+      compiled = true;
+      s = p;
+      modes.push_back (s);
+    }
+  }
+
+  return s;
+}
+
+epsic::simulation::~simulation ()
+{
+  for (unsigned ithread=1; ithread < thread_sample.size(); ithread++)
+  {
+    delete thread_sample[ithread];
+    delete thread_sinks[ithread];
+  }
+
+  for (auto normal : thread_normal)
+    delete normal;
+
+  delete combined;
+  delete stokes_sample;
+
+  for (auto m : modes)
+    delete m;
+
+  delete covariant;
+}
+
+unsigned epsic::simulation::add (statistic* sink)
+{
+  if (thread_sinks.size())
+    throw std::runtime_error ("epsic::simulation::add - "
+                              "cannot add a sink after the simulation has run");
+
+  unsigned index = sinks.size();
+  sinks.add (sink);
+  return index;
+}
+
+/*
+  Each thread simulates its share of the Stokes samples using its own
+  copy of the sample and its own stream of random numbers.  The first
+  thread uses the original sample and sinks, and stream 0.
+
+  The Stokes samples that can be formed from recorded fields are
+  divided between the threads in the same way, and each copy of the
+  sample reads the contiguous range of instances of its share.  The
+  range is set in the original modes before they are copied; therefore,
+  the copies are made in reverse order, ending with the first thread.
+*/
+void epsic::simulation::setup_threads ()
+{
+  unsigned nthread = config.nthread;
+
+  thread_sample.assign (nthread, stokes_sample);
+  thread_sinks.assign (nthread, &sinks);
+  thread_normal.resize (nthread);
+
+  uint64_t nrecorded = std::numeric_limits<uint64_t>::max();
+  for (auto f : recorded)
+    nrecorded = std::min (nrecorded, f->get_ninstance() / config.sample_size);
+
+  for (unsigned ithread=nthread; ithread-- > 0;)
+  {
+    uint64_t first = ithread * (nrecorded / nthread)
+      + std::min<uint64_t> (ithread, nrecorded % nthread);
+    uint64_t share = nrecorded / nthread + (ithread < nrecorded % nthread);
+
+    for (auto f : recorded)
+      f->set_range (first * config.sample_size,
+                    (first + share) * config.sample_size);
+
+    if (ithread > 0)
+    {
+      thread_sample[ithread] = stokes_sample->clone();
+      thread_sinks[ithread] = sinks.clone();
+    }
+
+    thread_normal[ithread] = new BoxMuller (config.seed, ithread);
+    thread_sample[ithread]->set_normal (thread_normal[ithread]);
+  }
+}
+
+//! Simulate nsamp Stokes samples and send them to the sinks in blocks
+static void simulate (epsic::sample* stokes_sample, epsic::statistic* sinks,
+                      uint64_t nsamp)
+{
+  const unsigned block_size = 1024;
+  std::vector< Vector<4, double> > block (block_size);
+
+  for (uint64_t idat=0; idat<nsamp; idat+=block_size)
+  {
+    unsigned n = std::min<uint64_t> (block_size, nsamp-idat);
+    for (unsigned i=0; i<n; i++)
+      block[i] = stokes_sample->get_Stokes();
+
+    sinks->consume (block.data(), n);
+  }
+}
+
+void epsic::simulation::run (uint64_t nsamp)
+{
+  if (thread_sinks.empty())
+    setup_threads ();
+
+  combined_current = false;
+
+  unsigned nthread = config.nthread;
+
+  run_threads (nthread, [&] (unsigned ithread)
+  {
+    uint64_t share = nsamp / nthread + (ithread < nsamp % nthread);
+    simulate (thread_sample[ithread], thread_sinks[ithread], share);
+  });
+
+  nsamp_total += nsamp;
+}
+
+static const char checkpoint_magic[8] = { 'E','P','S','I','C','C','H','K' };
+static const uint32_t checkpoint_version = 2;
+
+static void write (std::ostream& os, const epsic::mode_config& mode)
+{
+  os << mode.mean << " " << mode.beta << " " << mode.smooth_modulator << " "
+     << mode.square_modulator << " " << mode.smooth_before << " ";
+}
+
+//! Return a description of every parameter that affects the simulation
+static string signature (const epsic::simulation_config& config)
+{
+  std::ostringstream os;
+  os.precision (17);
+
+  os << config.combination << " " << config.combination_parameter << " "
+     << config.covariant << " " << config.mode_correlation << " ";
+
+  write (os, config.A);
+  write (os, config.B);
+
+  os << config.sample_size << " " << config.smooth_after << " "
+     << config.nlag << " " << config.rho_stats << " "
+     << config.direct_sampling << " " << config.compile << " "
+     << config.nthread;
+
+  return os.str();
+}
+
+void epsic::simulation::save (std::ostream& os)
+{
+  if (!config.A.baseband_file.empty() || !config.B.baseband_file.empty())
+    throw std::runtime_error ("epsic::simulation::save - "
+                              "cannot save the state of recorded fields");
+
+  if (thread_sinks.empty())
+    setup_threads ();
+
+  os.write (checkpoint_magic, sizeof(checkpoint_magic));
+  write_binary (os, checkpoint_version);
+  write_binary (os, signature (config));
+  write_binary (os, uint32_t (SIMD::get_path()));
+  write_binary (os, config.seed);
+  write_binary (os, nsamp_total);
+
+  for (unsigned ithread=0; ithread < config.nthread; ithread++)
+  {
+    write_binary (os, thread_normal[ithread]->tell());
+    write_binary (os, thread_normal[ithread]->tell_uniform());
+    thread_sinks[ithread]->save (os);
+  }
+
+  if (!os)
+    throw std::runtime_error ("epsic::simulation::save - write failed");
+}
+
+void epsic::simulation::load (std::istream& is)
+{
+  if (thread_sinks.empty())
+    setup_threads ();
+
+  char magic[sizeof(checkpoint_magic)];
+  uint32_t version = 0;
+
+  if (!is.read (magic, sizeof(magic))
+      || memcmp (magic, checkpoint_magic, sizeof(magic)) != 0)
+    throw std::runtime_error ("epsic::simulation::load - not a checkpoint");
+
+  read_binary (is, version);
+  if (version != checkpoint_version)
+    throw std::runtime_error ("epsic::simulation::load - unsupported version");
+
+  string saved;
+  read_binary (is, saved);
+  if (saved != signature (config))
+    throw std::runtime_error ("epsic::simulation::load - "
+                              "checkpoint of a different configuration");
+
+  uint32_t path = 0;
+  read_binary (is, path);
+  if (path > SIMD::AVX512)
+    throw std::runtime_error ("epsic::simulation::load - "
+                              "invalid instruction set");
+  checkpoint_path = SIMD::Path (path);
+
+  uint64_t seed = 0;
+  read_binary (is, seed);
+
+  if (seed != config.seed)
+  {
+    config.seed = seed;
+    for (unsigned ithread=0; ithread < config.nthread; ithread++)
+    {
+      delete thread_normal[ithread];
+      thread_normal[ithread] = new BoxMuller (seed, ithread);
+      thread_sample[ithread]->set_normal (thread_normal[ithread]);
+    }
+  }
+
+  read_binary (is, nsamp_total);
+
+  for (unsigned ithread=0; ithread < config.nthread; ithread++)
+  {
+    uint64_t position = 0;
+    read_binary (is, position);
+    thread_normal[ithread]->seek (position);
+
+    read_binary (is, position);
+    thread_normal[ithread]->seek_uniform (position);
+
+    thread_sinks[ithread]->load (is);
+  }
+
+  combined_current = false;
+}
+
+const epsic::statistic* epsic::simulation::get_statistic (unsigned index)
+{
+  if (!combined_current)
+  {
+    delete combined;
+    combined = sinks.clone();
+
+    for (unsigned ithread=1; ithread < thread_sinks.size(); ithread++)
+      combined->combine (*thread_sinks[ithread]);
+
+    combined_current = true;
+  }
+
+  return combined->get (index);
+}
+
+epsic::simulation_result epsic::simulation::get_result ()
+{
+  simulation_result result;
+
+  auto moments = dynamic_cast<const stokes_moments*> (get_statistic (moments_index));
+  result.stokes = moments->get_moments();
+
+  auto dop = dynamic_cast<const polarization_degree*> (get_statistic (dop_index));
+  result.degree_of_polarization = dop->get_mean();
+
+  if (config.nlag)
+  {
+    auto acf = dynamic_cast<const stokes_acf*> (get_statistic (acf_index));
+    for (unsigned ilag=0; ilag < config.nlag; ilag++)
+    {
+      result.acf.push_back (acf->get_acf(ilag).get_covariance());
+      result.expected_acf.push_back (stokes_sample->get_crosscovariance(ilag));
+    }
+  }
+
+  if (config.rho_stats)
+  {
+    auto rho = dynamic_cast<const coherency_moments*> (get_statistic (rho_index));
+    result.coherency = rho->get_moments();
+  }
+
+  result.expected_mean = stokes_sample->get_mean ();
+  result.expected_covariance = stokes_sample->get_covariance ();
+
+  return result;
+}
@@ -0,0 +1,269 @@
+//-*-C++-*-
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+//! @file epsic/src/simulation.h
+
+#ifndef __epsic_simulation_h
+#define __epsic_simulation_h
+
+#include "sample.h"
+#include "file_mode.h"
+#include "statistic.h"
+#include "Stokes.h"
+#include "SIMD.h"
+
+#include <vector>
+#include <complex>
+#include <iostream>
+#include <cstdint>
+
+class BoxMuller;
+
+namespace epsic
+{
+  class bivariate_lognormal_modes;
+
+  //! Modulation and smoothing of one mode of the simulated radiation
+  struct mode_config
+  {
+    //! population mean Stokes parameters
+    Stokes<double> mean;
+
+    //! modulation index of lognormal amplitude modulation (0 = none)
+    double beta;
+
+    //! box-car smoothing width of the modulation function
+    unsigned smooth_modulator;
+
+    //! width of square pulses of modulation
+    unsigned square_modulator;
+
+    //! box-car smoothing width pre-detection
+    unsigned smooth_before;
+
+    //! file of baseband data from which the fields are read (empty = simulate)
+    std::string baseband_file;
+
+    //! format of the values in the baseband file
+    file_mode::Format baseband_format;
+
+    //! number of bytes that precede the first instance in the baseband file
+    uint64_t baseband_offset;
+
+    mode_config () : mean (1,0,0,0)
+    {
+      beta = 0;
+      smooth_modulator = square_modulator = smooth_before = 0;
+      baseband_format = file_mode::Int8;
+      baseband_offset = 0;
+    }
+  };
+
+  //! Configuration of a simulation, as set by the options of epsic
+  struct simulation_config
+  {
+    //! The combination of two modes, if any
+    enum Combination { Single, Superposed, Composite, Disjoint, Coherent };
+    Combination combination;
+
+    //! fraction of A in a composite or disjoint combination, or coherence
+    double combination_parameter;
+
+    //! correlation coefficient of covariant mode intensities (if covariant)
+    double mode_correlation;
+    bool covariant;
+
+    //! configuration of the first (or only) mode and the second mode
+    mode_config A, B;
+
+    //! number of instances in each Stokes sample
+    unsigned sample_size;
+
+    //! box-car smoothing width post-detection
+    unsigned smooth_after;
+
+    //! number of lags in the auto-covariance function
+    unsigned nlag;
+
+    //! compute the moments of the coherency matrix
+    bool rho_stats;
+
+    //! draw the Stokes parameters of unmodulated modes directly
+    bool direct_sampling;
+
+    //! replace decorated modes with statically composed pipelines [default: false]
+    /*! The pipelines reproduce the decorated modes bit for bit, but run
+      no faster, because the decorators already generate the field
+      instances in blocks; the decorated modes remain the default. */
+    bool compile;
+
+    //! number of simulation threads
+    unsigned nthread;
+
+    //! seed of the random number generator (0 = random)
+    uint64_t seed;
+
+    simulation_config ()
+    {
+      combination = Single;
+      combination_parameter = 0;
+      mode_correlation = 0;
+      covariant = false;
+      sample_size = 1;
+      smooth_after = 0;
+      nlag = 0;
+      rho_stats = false;
+      direct_sampling = true;
+      compile = false;
+      nthread = 1;
+      seed = 0;
+    }
+  };
+
+  //! Simulated and expected statistics of the Stokes samples
+  struct simulation_result
+  {
+    //! moments of the simulated Stokes parameters
+    moment_accumulator<4> stokes;
+
+    //! mean degree of polarization of the simulated Stokes samples
+    double degree_of_polarization;
+
+    //! simulated cross-covariances of the Stokes parameters, by lag
+    std::vector< Matrix<4,4,double> > acf;
+
+    //! moments of the simulated coherency matrix, if computed
+    moment_accumulator<4, std::complex<double> > coherency;
+
+    Vector<4,double> expected_mean;
+    Matrix<4,4,double> expected_covariance;
+    std::vector< Matrix<4,4,double> > expected_acf;
+
+    //! Return the number of simulated Stokes samples
+    uint64_t get_count () const { return stokes.get_count(); }
+
+    //! Return the mean of the simulated Stokes parameters
+    const Vector<4,double>& get_mean () const { return stokes.get_mean(); }
+
+    //! Return the covariance of the simulated Stokes parameters
+    Matrix<4,4,double> get_covariance () const { return stokes.get_covariance(); }
+
+    //! Return the standard deviation of the total intensity over its mean
+    double get_modulation_index () const;
+  };
+
+  //! Constructs and runs a simulation of Stokes samples
+  /*! The Stokes samples are divided between threads, each of which
+    uses its own copy of the sample, its own stream of random numbers,
+    and its own copy of the statistic sinks.  The simulation may be
+    run in several steps; each step continues the random streams. */
+  class simulation
+  {
+    simulation_config config;
+
+    //! the simulated sample of Stokes parameters
+    sample* stokes_sample;
+
+    //! modes created by this instance and not owned by stokes_sample
+    std::vector<mode*> modes;
+
+    //! modes that read recorded fields, owned by modes or stokes_sample
+    std::vector<file_mode*> recorded;
+
+    //! coordinates covariant mode intensities
+    bivariate_lognormal_modes* covariant;
+
+    //! true if a mode was replaced by a statically composed pipeline
+    bool compiled;
+
+    //! the sinks fed by the first thread, copied for the others
+    statistics sinks;
+    unsigned moments_index;
+    unsigned dop_index;
+    unsigned acf_index;
+    unsigned rho_index;
+
+    std::vector<sample*> thread_sample;
+    std::vector<BoxMuller*> thread_normal;
+    std::vector<statistics*> thread_sinks;
+
+    //! the sinks of every thread combined, updated by get_statistic
+    statistics* combined;
+    bool combined_current;
+
+    //! the number of Stokes samples simulated so far
+    uint64_t nsamp_total;
+
+    //! the instruction set used by the simulation that wrote the loaded checkpoint
+    SIMD::Path checkpoint_path;
+
+    //! Construct and decorate a mode as configured
+    mode* setup_mode (mode* s, const mode_config& setup, unsigned index);
+
+    //! Create the samples, random streams and sinks of each thread
+    void setup_threads ();
+
+  public:
+
+    simulation (const simulation_config&);
+    ~simulation ();
+
+    simulation (const simulation&) = delete;
+    simulation& operator = (const simulation&) = delete;
+
+    //! Add a sink of the simulated Stokes samples and return its index
+    /*! Sinks must be added before the simulation is first run. */
+    unsigned add (statistic*);
+
+    //! Simulate the next nsamp Stokes samples
+    void run (uint64_t nsamp);
+
+    //! Return the number of Stokes samples simulated so far
+    uint64_t get_nsamp () const { return nsamp_total; }
+
+    //! Write the state of the sinks and random streams to a checkpoint
+    void save (std::ostream&);
+
+    //! Restore the state of the sinks and random streams from a checkpoint
+    /*! The checkpoint must have been written by a simulation with the
+      same configuration, number of threads and sinks; its seed replaces
+      the configured seed.  The state of the modes is not saved;
+      therefore, the samples of modes with smoothing or square
+      modulation resume with empty windows. */
+    void load (std::istream&);
+
+    //! Return the instruction set used by the simulation that wrote the loaded checkpoint
+    /*! Every instruction set computes the same samples; a checkpoint
+      written on a host with a different instruction set is loaded, but
+      the difference may be reported to help diagnose any discrepancy. */
+    SIMD::Path get_checkpoint_path () const { return checkpoint_path; }
+
+    //! Return the simulated and expected statistics
+    simulation_result get_result ();
+
+    //! Return the specified sink, combined over all threads
+    const statistic* get_statistic (unsigned index);
+
+    //! Return the sample of Stokes parameters
+    sample* get_sample () { return stokes_sample; }
+
+    //! Return the coordinator of covariant mode intensities, if any
+    /*! The statistics of the modulation factors of all threads are
+      accumulated by the coordinator and its copies. */
+    const bivariate_lognormal_modes* get_covariant () const { return covariant; }
+
+    //! Return the configuration, including the seed that is used
+    const simulation_config& get_config () const { return config; }
+
+    //! Return true if a mode is generated by a statically composed pipeline
+    bool is_compiled () const { return compiled; }
+  };
+
+} // end of namespace epsic
+
+#endif // ! defined __epsic_simulation_h
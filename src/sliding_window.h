@@ -0,0 +1,102 @@
+//-*-C++-*-
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+//! @file epsic/src/sliding_window.h
+
+#ifndef __epsic_sliding_window_h
+#define __epsic_sliding_window_h
+
+#include <vector>
+#include <cstdint>
+
+namespace epsic
+{
+  //! Running sum of the most recent values added to a window of fixed width
+  /*! Each value added replaces the oldest value in the window, and the
+    sum is updated by adding the new value and subtracting the oldest,
+    so that the cost of each update does not depend on the width.
+
+    Rounding errors accumulate in the running sum; therefore, the sum
+    is recomputed from the values in the window, using Kahan compensated
+    summation, after every resum_factor * width updates.  The type T
+    must support default construction to zero, +=, -, and -=. */
+  template<typename T>
+  class sliding_window
+  {
+    std::vector<T> values;
+    T sum;
+
+    //! index of the oldest value in the window
+    unsigned current;
+
+    //! number of updates since the sum was last recomputed
+    uint64_t updates;
+
+  public:
+
+    //! The sum is recomputed after this many updates per value in the window
+    static constexpr unsigned resum_factor = 64;
+
+    sliding_window (unsigned width = 0) { resize (width); }
+
+    //! Set the width of the window and fill it with zeros
+    void resize (unsigned width)
+    {
+      values.assign (width, T());
+      sum = T();
+      current = 0;
+      updates = 0;
+    }
+
+    //! Return the width of the window
+    unsigned size () const { return values.size(); }
+
+    //! Replace the oldest value with x and return the sum of the window
+    const T& add (const T& x)
+    {
+      sum += x;
+      sum -= values[current];
+      values[current] = x;
+
+      current ++;
+      if (current == values.size())
+        current = 0;
+
+      updates ++;
+      if (updates == uint64_t(resum_factor) * values.size())
+        resum ();
+
+      return sum;
+    }
+
+    //! Return the sum of the values in the window
+    const T& get_sum () const { return sum; }
+
+    //! Recompute the sum of the values in the window
+    void resum ()
+    {
+      T total = T();
+      T compensation = T();
+
+      for (unsigned i=0; i<values.size(); i++)
+      {
+        T y = values[i] - compensation;
+        T t = total;
+        t += y;
+        compensation = (t - total) - y;
+        total = t;
+      }
+
+      sum = total;
+      updates = 0;
+    }
+  };
+
+} // end of namespace epsic
+
+#endif // ! defined __epsic_sliding_window_h
@@ -12,6 +12,7 @@
 #define __epsic_smoothed_h
 
 #include "mode.h"
+#include "sliding_window.h"
 #include <vector>
 
 namespace epsic
@@ -19,36 +20,43 @@ namespace epsic
   //! a boxcar-smoothed source of electromagnetic radiation
   class boxcar_mode : public mode_decorator
   {
-    std::vector< Spinor<double> > instances;
+    sliding_window< Spinor<double> > window;
     unsigned smooth;
-    unsigned current;
 
     void setup()
     {
-      current = 0;
-      instances.resize (smooth);
+      window.resize (smooth);
       for (unsigned i=1; i<smooth; i++)
-        instances[i] = source->get_field();
+        window.add (source->get_field());
     }
 
   public:
 
     boxcar_mode (mode* s, unsigned n) : mode_decorator(s) { smooth = n; }
 
+    boxcar_mode* clone () const { return copy (this); }
+
+    //! Return the number of field instances in the running mean
+    unsigned get_smooth () const { return smooth; }
+
     Spinor<double> get_field ()
     {
-      if (instances.size() < smooth)
+      if (window.size() < smooth)
         setup ();
 
-      instances[current] = source->get_field();
-      current = (current + 1) % smooth;
+      return window.add (source->get_field()) / sqrt(smooth);
+    }
+
+    void get_fields (Spinor<double>* fields, unsigned n)
+    {
+      if (window.size() < smooth)
+        setup ();
 
-      Spinor<double> result;
-      for (unsigned i=0; i<smooth; i++)
-        result += instances[i];
+      source->get_fields (fields, n);
 
-      result /= sqrt(smooth);
-      return result;
+      double norm = 1.0 / sqrt(smooth);
+      for (unsigned j=0; j<n; j++)
+        fields[j] = window.add (fields[j]) * norm;
     }
   };
 
@@ -7,6 +7,8 @@
 
 #include "modulated.h"
 
+#include <cstdint>
+
 epsic::square_modulated_mode::square_modulated_mode (modulated_mode* _mode,
 					      unsigned _width,
 					      unsigned sample_size)
@@ -15,12 +17,43 @@ epsic::square_modulated_mode::square_modulated_mode (modulated_mode* _mode,
   width = _width;
   current = _width;
   mod = _mode;
+  owns_mod = false;
 
   compute_cross_correlation (sample_size);
 }
 
+//! Return the greatest common divisor of a and b
+static unsigned gcd (unsigned a, unsigned b)
+{
+  while (b)
+  {
+    unsigned r = a % b;
+    a = b;
+    b = r;
+  }
+  return a;
+}
+
+//! Return the number of t in [0,M) for which t modulo width is less than k
+static uint64_t count_within (uint64_t M, unsigned width, unsigned k)
+{
+  return (M / width) * k + std::min<uint64_t> (M % width, k);
+}
+
+/*! Each sample of sample_size instances starts at a phase of the
+  contiguous sequence of pulses that advances by sample_size modulo
+  width from one sample to the next.  There are therefore
+  width/gcd(width,sample_size) populations of samples, which start at
+  phases p*sample_size modulo width.
+
+  For each lag, cross_correlation is the fraction of the pairs of
+  instances separated by lag (averaged over all populations) that lie
+  within the same pulse.  Instance i of a sample that starts at phase
+  phi lies at phase (i+phi) modulo width, and the pair (i,i+lag) lies
+  within the same pulse when that phase is less than width-lag. */
 void epsic::square_modulated_mode::compute_cross_correlation (unsigned sample_size)
 {
+  changed ();
   cross_correlation.resize( width );
 
   if (sample_size <= width)
@@ -31,65 +64,27 @@ void epsic::square_modulated_mode::compute_cross_correlation (unsigned sample_si
     return;
   }
 
-  std::vector<double> matrix ( sample_size * sample_size, 0.0 );
-
-  unsigned cur = 0;
-  unsigned populations = 0;
-  while (cur != width)
-  {
-    unsigned ioff=0;
-    while (ioff < sample_size)
-    {
-      unsigned end = width;
-      if (ioff + end > sample_size)
-	end = sample_size - ioff;
-
-      if (cur == width)
-	cur = 0;
-
-#if _DEBUG
-      std::cerr << "ioff=" << ioff << " cur=" << cur << " end=" << end << std::endl;
-#endif
-      
-      for (; cur < end ; cur++)
-      {
-	for (unsigned col=cur; col < end; col++)
-	  matrix[ ioff*sample_size + (ioff+col-cur) ] += 1.0;
-	ioff ++;
-      }
-    }
-
-#if _DEBUG
-    for (unsigned irow=0; irow < sample_size; irow++)
-    {
-      for (unsigned icol=0; icol < sample_size; icol++)
-      {
-        unsigned jrow=irow;
-        unsigned jcol=icol;
-        if (jcol < jrow)
-          swap (jcol, jrow);
-        std::cerr << matrix[ jrow*sample_size + jcol ] << " ";
-      }
-      std::cerr << std::endl;
-    }
-#endif
-    
-    populations ++;
-  }
+  unsigned populations = width / gcd (width, sample_size);
 
 #if _DEBUG
   std::cerr << "epsic::square_modulated_mode::compute_cross_correlation "
        << populations << " populations" << std::endl;
 #endif
-  
+
   for (unsigned ilag=0; ilag < width; ilag++)
   {
     unsigned nrow = sample_size - ilag;
+    unsigned k = width - ilag;
+
+    uint64_t sum = 0;
+    unsigned phase = 0;
+    for (unsigned ipop=0; ipop < populations; ipop++)
+    {
+      sum += count_within (phase + uint64_t(nrow), width, k)
+        - count_within (phase, width, k);
+      phase = (phase + sample_size) % width;
+    }
 
-    double sum = 0;
-    for (unsigned irow=0; irow < nrow; irow++)
-      sum += matrix[ irow*sample_size + (irow+ilag) ];
-    
-    cross_correlation[ilag] = sum / (nrow * populations);
+    cross_correlation[ilag] = double(sum) / (double(nrow) * populations);
   }
 }
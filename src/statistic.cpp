@@ -0,0 +1,352 @@
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+#include "statistic.h"
+#include "Pauli.h"
+#include "SIMD.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+
+using namespace std;
+
+void epsic::statistic::save (std::ostream&) const
+{
+  throw std::runtime_error ("epsic::statistic::save - sink cannot be checkpointed");
+}
+
+void epsic::statistic::load (std::istream&)
+{
+  throw std::runtime_error ("epsic::statistic::load - sink cannot be checkpointed");
+}
+
+epsic::statistics::statistics (const statistics& that)
+{
+  for (auto sink : that.sinks)
+    sinks.push_back (sink->clone());
+}
+
+epsic::statistics::~statistics ()
+{
+  for (auto sink : sinks)
+    delete sink;
+}
+
+void epsic::statistics::consume (const Vector<4,double>* block, unsigned n)
+{
+  for (auto sink : sinks)
+    sink->consume (block, n);
+}
+
+void epsic::statistics::combine (const statistic& _that)
+{
+  const statistics& that = dynamic_cast<const statistics&> (_that);
+
+  if (that.sinks.size() != sinks.size())
+    throw std::runtime_error ("epsic::statistics::combine - different number of sinks");
+
+  for (unsigned i=0; i<sinks.size(); i++)
+    sinks[i]->combine (*that.sinks[i]);
+}
+
+unsigned epsic::statistics::get_overlap () const
+{
+  unsigned overlap = 0;
+  for (auto sink : sinks)
+    overlap = std::max (overlap, sink->get_overlap());
+  return overlap;
+}
+
+void epsic::statistics::consume_overlap (const Vector<4,double>* block,
+                                         unsigned n)
+{
+  for (auto sink : sinks)
+    sink->consume_overlap (block, std::min (n, sink->get_overlap()));
+}
+
+void epsic::statistics::save (std::ostream& os) const
+{
+  write_binary (os, uint32_t (sinks.size()));
+
+  for (auto sink : sinks)
+    sink->save (os);
+}
+
+void epsic::statistics::load (std::istream& is)
+{
+  uint32_t nsink = 0;
+  read_binary (is, nsink);
+
+  if (nsink != sinks.size())
+    throw std::runtime_error ("epsic::statistics::load - different number of sinks");
+
+  for (auto sink : sinks)
+    sink->load (is);
+}
+
+/*
+  The moments are compiled once for each instruction set extension,
+  which the compiler uses to vectorize the inlined outer products.
+*/
+
+static SIMD_INLINE void add_moments (epsic::moment_accumulator<4>& moments,
+                                     const Vector<4,double>* block, unsigned n)
+{
+  for (unsigned i=0; i<n; i++)
+    moments.add (block[i]);
+}
+
+void epsic::stokes_moments::consume_scalar (const Vector<4,double>* block, unsigned n)
+{
+  add_moments (moments, block, n);
+}
+
+#if SIMD_X86
+
+SIMD_TARGET_AVX2
+void epsic::stokes_moments::consume_avx2 (const Vector<4,double>* block, unsigned n)
+{
+  add_moments (moments, block, n);
+}
+
+SIMD_TARGET_AVX512
+void epsic::stokes_moments::consume_avx512 (const Vector<4,double>* block, unsigned n)
+{
+  add_moments (moments, block, n);
+}
+
+#endif
+
+void epsic::stokes_moments::consume (const Vector<4,double>* block, unsigned n)
+{
+  switch (SIMD::get_path())
+  {
+#if SIMD_X86
+  case SIMD::AVX512:
+    consume_avx512 (block, n);
+    break;
+  case SIMD::AVX2:
+    consume_avx2 (block, n);
+    break;
+#endif
+  default:
+    consume_scalar (block, n);
+  }
+}
+
+void epsic::stokes_moments::combine (const statistic& that)
+{
+  moments.combine (dynamic_cast<const stokes_moments&>(that).moments);
+}
+
+epsic::stokes_acf::stokes_acf (unsigned nlag)
+  : acf (nlag), samples (nlag)
+{
+  current_sample = 0;
+  count = 0;
+}
+
+static SIMD_INLINE void add_lags (std::vector< epsic::cross_moment_accumulator<4,4> >& acf,
+                                  std::vector< Vector<4,double> >& samples,
+                                  unsigned& current_sample, uint64_t& count,
+                                  const Vector<4,double>* block, unsigned n)
+{
+  const unsigned nlag = acf.size();
+
+  for (unsigned i=0; i<n; i++)
+  {
+    samples[current_sample] = block[i];
+    current_sample ++;
+    if (current_sample == nlag)
+      current_sample = 0;
+
+    count ++;
+    if (count < nlag)
+      continue;
+
+    const Vector<4,double>& Sj = samples[current_sample];
+    for (unsigned ilag=0; ilag<nlag; ilag++)
+    {
+      const Vector<4,double>& Si = samples[(current_sample+ilag)%nlag];
+      acf[ilag].add (Si,Sj);
+    }
+  }
+}
+
+void epsic::stokes_acf::consume_scalar (const Vector<4,double>* block, unsigned n)
+{
+  add_lags (acf, samples, current_sample, count, block, n);
+}
+
+#if SIMD_X86
+
+SIMD_TARGET_AVX2
+void epsic::stokes_acf::consume_avx2 (const Vector<4,double>* block, unsigned n)
+{
+  add_lags (acf, samples, current_sample, count, block, n);
+}
+
+SIMD_TARGET_AVX512
+void epsic::stokes_acf::consume_avx512 (const Vector<4,double>* block, unsigned n)
+{
+  add_lags (acf, samples, current_sample, count, block, n);
+}
+
+#endif
+
+void epsic::stokes_acf::consume (const Vector<4,double>* block, unsigned n)
+{
+  if (acf.size() == 0)
+    return;
+
+  switch (SIMD::get_path())
+  {
+#if SIMD_X86
+  case SIMD::AVX512:
+    consume_avx512 (block, n);
+    break;
+  case SIMD::AVX2:
+    consume_avx2 (block, n);
+    break;
+#endif
+  default:
+    consume_scalar (block, n);
+  }
+}
+
+void epsic::stokes_acf::combine (const statistic& _that)
+{
+  const stokes_acf& that = dynamic_cast<const stokes_acf&> (_that);
+
+  if (that.acf.size() != acf.size())
+    throw std::runtime_error ("epsic::stokes_acf::combine - different number of lags");
+
+  for (unsigned ilag=0; ilag<acf.size(); ilag++)
+    acf[ilag].combine (that.acf[ilag]);
+}
+
+unsigned epsic::stokes_acf::get_overlap () const
+{
+  return acf.size() ? acf.size() - 1 : 0;
+}
+
+/*
+  Each of the following samples completes the window that begins with
+  one of the last nlag-1 samples consumed, so the products added are
+  exactly those that would have been added had the samples continued.
+*/
+void epsic::stokes_acf::consume_overlap (const Vector<4,double>* block,
+                                         unsigned n)
+{
+  consume (block, std::min (n, get_overlap()));
+}
+
+/*
+  The most recent samples are saved with the accumulated products, so
+  that a resumed simulation includes the products that straddle the
+  checkpoint.
+*/
+void epsic::stokes_acf::save (std::ostream& os) const
+{
+  write_binary (os, uint32_t (acf.size()));
+
+  for (auto& lag : acf)
+    lag.save (os);
+
+  for (auto& sample : samples)
+    write_binary (os, sample);
+
+  write_binary (os, current_sample);
+  write_binary (os, count);
+}
+
+void epsic::stokes_acf::load (std::istream& is)
+{
+  uint32_t nlag = 0;
+  read_binary (is, nlag);
+
+  if (nlag != acf.size())
+    throw std::runtime_error ("epsic::stokes_acf::load - different number of lags");
+
+  for (auto& lag : acf)
+    lag.load (is);
+
+  for (auto& sample : samples)
+    read_binary (is, sample);
+
+  read_binary (is, current_sample);
+  read_binary (is, count);
+}
+
+void epsic::polarization_degree::consume (const Vector<4,double>* block, unsigned n)
+{
+  for (unsigned i=0; i<n; i++)
+  {
+    const Vector<4,double>& s = block[i];
+    total += sqrt (s[1]*s[1] + s[2]*s[2] + s[3]*s[3]) / s[0];
+  }
+
+  count += n;
+}
+
+void epsic::polarization_degree::combine (const statistic& _that)
+{
+  const polarization_degree& that = dynamic_cast<const polarization_degree&> (_that);
+  total += that.total;
+  count += that.count;
+}
+
+void epsic::polarization_degree::save (std::ostream& os) const
+{
+  write_binary (os, total);
+  write_binary (os, count);
+}
+
+void epsic::polarization_degree::load (std::istream& is)
+{
+  read_binary (is, total);
+  read_binary (is, count);
+}
+
+void epsic::intensity_moments::consume (const Vector<4,double>* block, unsigned n)
+{
+  for (unsigned i=0; i<n; i++)
+  {
+    const Vector<4,double>& s = block[i];
+    double p = sqrt (s[1]*s[1] + s[2]*s[2] + s[3]*s[3]);
+    moments.add (Vector<2,double> (s[0], p));
+  }
+}
+
+void epsic::intensity_moments::combine (const statistic& that)
+{
+  moments.combine (dynamic_cast<const intensity_moments&>(that).moments);
+}
+
+void epsic::coherency_moments::consume (const Vector<4,double>* block, unsigned n)
+{
+  for (unsigned i=0; i<n; i++)
+  {
+    Jones<double> rho = convert (Stokes<double> (block[i]));
+    moments.add (Vector<4, complex<double> > (rho.j00, rho.j01, rho.j10, rho.j11));
+  }
+}
+
+void epsic::coherency_moments::combine (const statistic& that)
+{
+  moments.combine (dynamic_cast<const coherency_moments&>(that).moments);
+}
+
+void epsic::stokes_printer::consume (const Vector<4,double>* block, unsigned n)
+{
+  for (unsigned i=0; i<n; i++)
+    (*output) << block[i][0] << " "
+              << block[i][1] << " "
+              << block[i][2] << " "
+              << block[i][3] << " " << '\n';
+}
@@ -0,0 +1,229 @@
+//-*-C++-*-
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+//! @file epsic/src/statistic.h
+
+#ifndef __epsic_statistic_h
+#define __epsic_statistic_h
+
+#include "moments.h"
+
+#include <complex>
+#include <vector>
+#include <ostream>
+
+namespace epsic
+{
+  //! A sink that computes a statistic from blocks of Stokes samples
+  /*! Each simulation thread feeds its own copy of every sink, and the
+    copies are combined when the threads are finished.  Only the sinks
+    that are needed are created, so that the cost of a statistic is
+    paid only when it is requested. */
+  class statistic
+  {
+  public:
+
+    virtual ~statistic () {}
+
+    //! Return a copy of this sink
+    virtual statistic* clone () const = 0;
+
+    //! Add a block of n Stokes samples
+    virtual void consume (const Vector<4,double>* block, unsigned n) = 0;
+
+    //! Add the statistics accumulated by a copy of this sink
+    virtual void combine (const statistic& that) = 0;
+
+    //! Return the number of following samples needed to complete the statistic
+    /*! A statistic of consecutive samples, such as a lagged product,
+      is incomplete at the end of a range of samples that continues
+      in another copy of this sink. */
+    virtual unsigned get_overlap () const { return 0; }
+
+    //! Add the first n samples that follow the last block consumed
+    /*! These samples are consumed by another copy of this sink; only
+      their products with the samples already consumed are added. */
+    virtual void consume_overlap (const Vector<4,double>*, unsigned) {}
+
+    //! Write the accumulated state to a checkpoint
+    /*! By default, a sink cannot be checkpointed and an exception is thrown */
+    virtual void save (std::ostream&) const;
+
+    //! Restore the accumulated state from a checkpoint
+    virtual void load (std::istream&);
+  };
+
+  //! Sends each block of Stokes samples to every sink in a set
+  class statistics : public statistic
+  {
+    std::vector<statistic*> sinks;
+
+  public:
+
+    statistics () {}
+    statistics (const statistics&);
+    ~statistics ();
+
+    statistics& operator = (const statistics&) = delete;
+
+    statistics* clone () const { return new statistics (*this); }
+
+    //! Add a sink to the set, which takes ownership of it
+    void add (statistic* sink) { sinks.push_back (sink); }
+
+    //! Return the number of sinks in the set
+    unsigned size () const { return sinks.size(); }
+
+    //! Return the specified sink
+    statistic* get (unsigned index) { return sinks.at(index); }
+    const statistic* get (unsigned index) const { return sinks.at(index); }
+
+    void consume (const Vector<4,double>* block, unsigned n);
+    void combine (const statistic& that);
+    unsigned get_overlap () const;
+    void consume_overlap (const Vector<4,double>* block, unsigned n);
+    void save (std::ostream&) const;
+    void load (std::istream&);
+  };
+
+  //! Mean and covariance of the Stokes parameters
+  class stokes_moments : public statistic
+  {
+    moment_accumulator<4> moments;
+
+    void consume_scalar (const Vector<4,double>* block, unsigned n);
+    void consume_avx2 (const Vector<4,double>* block, unsigned n);
+    void consume_avx512 (const Vector<4,double>* block, unsigned n);
+
+  public:
+
+    stokes_moments* clone () const { return new stokes_moments (*this); }
+
+    void consume (const Vector<4,double>* block, unsigned n);
+    void combine (const statistic& that);
+    void save (std::ostream& os) const { moments.save (os); }
+    void load (std::istream& is) { moments.load (is); }
+
+    const moment_accumulator<4>& get_moments () const { return moments; }
+  };
+
+  //! Cross-covariances of the Stokes parameters as a function of lag
+  /*! Lagged products are accumulated separately by each copy; products
+    of samples that straddle the boundary between copies are included
+    only if the following samples are passed to consume_overlap. */
+  class stokes_acf : public statistic
+  {
+    std::vector< cross_moment_accumulator<4,4> > acf;
+
+    //! The most recent nlag samples
+    std::vector< Vector<4,double> > samples;
+    unsigned current_sample;
+    uint64_t count;
+
+    void consume_scalar (const Vector<4,double>* block, unsigned n);
+    void consume_avx2 (const Vector<4,double>* block, unsigned n);
+    void consume_avx512 (const Vector<4,double>* block, unsigned n);
+
+  public:
+
+    stokes_acf (unsigned nlag);
+
+    stokes_acf* clone () const { return new stokes_acf (*this); }
+
+    void consume (const Vector<4,double>* block, unsigned n);
+    void combine (const statistic& that);
+    unsigned get_overlap () const;
+    void consume_overlap (const Vector<4,double>* block, unsigned n);
+    void save (std::ostream&) const;
+    void load (std::istream&);
+
+    unsigned get_nlag () const { return acf.size(); }
+
+    const cross_moment_accumulator<4,4>& get_acf (unsigned ilag) const
+    { return acf[ilag]; }
+  };
+
+  //! Mean degree of polarization of the Stokes samples
+  class polarization_degree : public statistic
+  {
+    double total;
+    uint64_t count;
+
+  public:
+
+    polarization_degree () { total = 0; count = 0; }
+
+    polarization_degree* clone () const { return new polarization_degree (*this); }
+
+    void consume (const Vector<4,double>* block, unsigned n);
+    void combine (const statistic& that);
+    void save (std::ostream&) const;
+    void load (std::istream&);
+
+    //! Return the mean of the degree of polarization of each sample
+    double get_mean () const { return count ? total / count : 0.0; }
+  };
+
+  //! Mean and covariance of the total and polarized intensity
+  /*! The polarized intensity of each sample is sqrt(Q^2 + U^2 + V^2). */
+  class intensity_moments : public statistic
+  {
+    moment_accumulator<2> moments;
+
+  public:
+
+    intensity_moments* clone () const { return new intensity_moments (*this); }
+
+    void consume (const Vector<4,double>* block, unsigned n);
+    void combine (const statistic& that);
+    void save (std::ostream& os) const { moments.save (os); }
+    void load (std::istream& is) { moments.load (is); }
+
+    //! Return the moments of the total (0) and polarized (1) intensity
+    const moment_accumulator<2>& get_moments () const { return moments; }
+  };
+
+  //! Mean and covariance of the elements of the coherency matrix
+  class coherency_moments : public statistic
+  {
+    moment_accumulator<4, std::complex<double> > moments;
+
+  public:
+
+    coherency_moments* clone () const { return new coherency_moments (*this); }
+
+    void consume (const Vector<4,double>* block, unsigned n);
+    void combine (const statistic& that);
+    void save (std::ostream& os) const { moments.save (os); }
+    void load (std::istream& is) { moments.load (is); }
+
+    //! Return the moments of the coherency matrix, flattened in row-major order
+    const moment_accumulator<4, std::complex<double> >& get_moments () const
+    { return moments; }
+  };
+
+  //! Prints each Stokes sample on a separate line
+  /*! Copies print to the same stream; therefore, only one copy should
+    consume samples. */
+  class stokes_printer : public statistic
+  {
+    std::ostream* output;
+
+  public:
+
+    stokes_printer (std::ostream* os) { output = os; }
+
+    stokes_printer* clone () const { return new stokes_printer (*this); }
+
+    void consume (const Vector<4,double>* block, unsigned n);
+    void combine (const statistic&) { }
+  };
+
+} // end of namespace epsic
+
+#endif // ! defined __epsic_statistic_h
@@ -0,0 +1,371 @@
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "stokes_file.h"
+#include "checkpoint.h"
+
+#if HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include <stdexcept>
+#include <cstring>
+
+using namespace std;
+
+static const char magic[8] = { 'E','P','S','I','C','S','T','K' };
+static const char index_magic[8] = { 'E','P','S','I','C','I','D','X' };
+static const uint32_t version = 1;
+
+bool epsic::stokes_file_compression ()
+{
+#if HAVE_ZLIB
+  return true;
+#else
+  return false;
+#endif
+}
+
+epsic::stokes_writer::stokes_writer (const std::string& filename,
+                                     const stokes_file_header& _header,
+                                     unsigned _chunk_size)
+  : header (_header)
+{
+  if (header.dtype_size != 4 && header.dtype_size != 8)
+    throw std::runtime_error ("epsic::stokes_writer - invalid dtype size");
+
+  if (header.compression != stokes_file_header::None && !stokes_file_compression())
+    throw std::runtime_error ("epsic::stokes_writer - compiled without zlib");
+
+  if (_chunk_size == 0)
+    throw std::runtime_error ("epsic::stokes_writer - invalid chunk size");
+
+  file.open (filename.c_str(), std::ios::binary);
+  if (!file)
+    throw std::runtime_error ("epsic::stokes_writer - could not open " + filename);
+
+  file.write (magic, sizeof(magic));
+  write_binary (file, version);
+  write_binary (file, uint32_t (header.dtype_size));
+  write_binary (file, uint32_t (header.compression));
+  write_binary (file, uint32_t (header.sample_size));
+  write_binary (file, header.seed);
+  write_binary (file, header.config);
+
+  // align the values of each chunk
+  while (file.tellp() % 8)
+    file.put (0);
+
+  chunk_size = _chunk_size;
+  for (auto& b : buffer)
+    b.resize (chunk_size * 4 * header.dtype_size);
+
+  filling = 0;
+  nfilled = 0;
+  npending = 0;
+  closing = false;
+
+  output = std::thread (&stokes_writer::write_chunks, this);
+}
+
+epsic::stokes_writer::~stokes_writer ()
+{
+  try
+  {
+    close ();
+  }
+  catch (...)
+  {
+  }
+
+  stop ();
+}
+
+template<typename T>
+static void copy (char* buffer, const Vector<4,double>* block, unsigned n)
+{
+  T* values = reinterpret_cast<T*> (buffer);
+  for (unsigned i=0; i<n; i++)
+    for (unsigned j=0; j<4; j++)
+      values[i*4+j] = block[i][j];
+}
+
+void epsic::stokes_writer::write (const Vector<4,double>* block, unsigned n)
+{
+  while (n)
+  {
+    unsigned count = std::min (n, chunk_size - nfilled);
+    char* start = buffer[filling].data() + nfilled * 4 * header.dtype_size;
+
+    if (header.dtype_size == 4)
+      copy<float> (start, block, count);
+    else
+      copy<double> (start, block, count);
+
+    nfilled += count;
+    block += count;
+    n -= count;
+
+    if (nfilled == chunk_size)
+      submit ();
+  }
+}
+
+void epsic::stokes_writer::submit ()
+{
+  std::unique_lock<std::mutex> lock (mutex);
+
+  // wait until the output thread has finished with the other buffer
+  condition.wait (lock, [this] { return npending == 0; });
+
+  if (error)
+  {
+    lock.unlock ();
+    stop ();
+    std::rethrow_exception (error);
+  }
+
+  npending = nfilled;
+  filling = !filling;
+  nfilled = 0;
+
+  condition.notify_all ();
+}
+
+void epsic::stokes_writer::write_chunks ()
+{
+  std::vector<char> compressed;
+
+  std::unique_lock<std::mutex> lock (mutex);
+
+  while (true)
+  {
+    condition.wait (lock, [this] { return npending || closing; });
+
+    if (npending == 0)
+      return;
+
+    const std::vector<char>& pending = buffer[!filling];
+    uint32_t nsamp = npending;
+    uint32_t nbyte = nsamp * 4 * header.dtype_size;
+
+    lock.unlock ();
+
+    try
+    {
+      const char* data = pending.data();
+
+#if HAVE_ZLIB
+      if (header.compression == stokes_file_header::Zlib)
+      {
+        uLongf size = compressBound (nbyte);
+        compressed.resize (size);
+        if (compress2 (reinterpret_cast<Bytef*>(compressed.data()), &size,
+                       reinterpret_cast<const Bytef*>(data), nbyte,
+                       Z_BEST_SPEED) != Z_OK)
+          throw std::runtime_error ("epsic::stokes_writer - compression failed");
+        data = compressed.data();
+        nbyte = size;
+      }
+#endif
+
+      offsets.push_back (file.tellp());
+      counts.push_back (nsamp);
+
+      write_binary (file, nsamp);
+      write_binary (file, nbyte);
+      file.write (data, nbyte);
+
+      if (!file)
+        throw std::runtime_error ("epsic::stokes_writer - write failed");
+    }
+    catch (...)
+    {
+      lock.lock ();
+      error = std::current_exception ();
+      lock.unlock ();
+    }
+
+    lock.lock ();
+    npending = 0;
+    condition.notify_all ();
+  }
+}
+
+void epsic::stokes_writer::stop ()
+{
+  if (!output.joinable())
+    return;
+
+  {
+    std::lock_guard<std::mutex> lock (mutex);
+    closing = true;
+    condition.notify_all ();
+  }
+
+  output.join ();
+}
+
+void epsic::stokes_writer::close ()
+{
+  if (!output.joinable())
+    return;
+
+  if (nfilled)
+    submit ();
+
+  stop ();
+
+  if (error)
+  {
+    file.close ();
+    std::rethrow_exception (error);
+  }
+
+  uint64_t index_offset = file.tellp();
+  uint32_t nchunk = offsets.size();
+
+  write_binary (file, uint32_t (0));
+  write_binary (file, uint32_t ((2 * nchunk + 2) * sizeof(uint64_t) + sizeof(index_magic)));
+
+  for (auto offset : offsets)
+    write_binary (file, offset);
+  for (auto count : counts)
+    write_binary (file, count);
+
+  write_binary (file, uint64_t (nchunk));
+  write_binary (file, index_offset);
+  file.write (index_magic, sizeof(index_magic));
+
+  file.close ();
+  if (!file)
+    throw std::runtime_error ("epsic::stokes_writer - write failed");
+}
+
+epsic::stokes_reader::stokes_reader (const std::string& filename)
+{
+  file.open (filename.c_str(), std::ios::binary);
+  if (!file)
+    throw std::runtime_error ("epsic::stokes_reader - could not open " + filename);
+
+  char header_magic[sizeof(magic)];
+  if (!file.read (header_magic, sizeof(header_magic))
+      || memcmp (header_magic, magic, sizeof(magic)) != 0)
+    throw std::runtime_error ("epsic::stokes_reader - " + filename
+                              + " is not a file of Stokes samples");
+
+  uint32_t file_version, dtype_size, compression, sample_size;
+  read_binary (file, file_version);
+  read_binary (file, dtype_size);
+  read_binary (file, compression);
+  read_binary (file, sample_size);
+  read_binary (file, header.seed);
+  read_binary (file, header.config);
+
+  if (file_version != version)
+    throw std::runtime_error ("epsic::stokes_reader - unsupported version");
+
+  if (dtype_size != 4 && dtype_size != 8)
+    throw std::runtime_error ("epsic::stokes_reader - invalid dtype size");
+
+  if (compression > stokes_file_header::Zlib)
+    throw std::runtime_error ("epsic::stokes_reader - unknown compression");
+
+  if (compression != stokes_file_header::None && !stokes_file_compression())
+    throw std::runtime_error ("epsic::stokes_reader - compiled without zlib");
+
+  header.dtype_size = dtype_size;
+  header.compression = stokes_file_header::Compression (compression);
+  header.sample_size = sample_size;
+
+  file.seekg ((uint64_t(file.tellg()) + 7) / 8 * 8);
+
+  nchunk = current = 0;
+  finished = false;
+}
+
+bool epsic::stokes_reader::next_chunk ()
+{
+  uint32_t nsamp = 0;
+  uint32_t nbyte = 0;
+
+  if (finished || !file.read (reinterpret_cast<char*>(&nsamp), sizeof(nsamp)))
+    return false;
+
+  read_binary (file, nbyte);
+
+  // an empty chunk precedes the index
+  if (nsamp == 0)
+  {
+    finished = true;
+    return false;
+  }
+
+  uint32_t expected = nsamp * 4 * header.dtype_size;
+  chunk.resize (expected);
+
+  if (header.compression == stokes_file_header::None)
+  {
+    if (nbyte != expected || !file.read (chunk.data(), nbyte))
+      throw std::runtime_error ("epsic::stokes_reader - chunk truncated");
+  }
+  else
+  {
+    compressed.resize (nbyte);
+    if (!file.read (compressed.data(), nbyte))
+      throw std::runtime_error ("epsic::stokes_reader - chunk truncated");
+
+#if HAVE_ZLIB
+    uLongf size = expected;
+    if (uncompress (reinterpret_cast<Bytef*>(chunk.data()), &size,
+                    reinterpret_cast<const Bytef*>(compressed.data()),
+                    nbyte) != Z_OK || size != expected)
+      throw std::runtime_error ("epsic::stokes_reader - decompression failed");
+#endif
+  }
+
+  nchunk = nsamp;
+  current = 0;
+  return true;
+}
+
+template<typename T>
+static void copy (Vector<4,double>* block, const char* buffer, unsigned n)
+{
+  const T* values = reinterpret_cast<const T*> (buffer);
+  for (unsigned i=0; i<n; i++)
+    for (unsigned j=0; j<4; j++)
+      block[i][j] = values[i*4+j];
+}
+
+unsigned epsic::stokes_reader::read (Vector<4,double>* block, unsigned n)
+{
+  unsigned total = 0;
+
+  while (total < n)
+  {
+    if (current == nchunk && !next_chunk())
+      break;
+
+    unsigned count = std::min (n - total, nchunk - current);
+    const char* start = chunk.data() + current * 4 * header.dtype_size;
+
+    if (header.dtype_size == 4)
+      copy<float> (block + total, start, count);
+    else
+      copy<double> (block + total, start, count);
+
+    current += count;
+    total += count;
+  }
+
+  return total;
+}
@@ -0,0 +1,198 @@
+//-*-C++-*-
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+//! @file epsic/src/stokes_file.h
+
+#ifndef __epsic_stokes_file_h
+#define __epsic_stokes_file_h
+
+#include "statistic.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <cstdint>
+
+namespace epsic
+{
+  //! Describes the contents of a binary file of Stokes samples
+  /*! A file of Stokes samples has the following format (native byte order):
+
+      char[8]    "EPSICSTK"
+      uint32_t   version
+      uint32_t   bytes per value (4 = float32, 8 = float64)
+      uint32_t   compression (0 = none, 1 = zlib)
+      uint32_t   number of instances in each Stokes sample
+      uint64_t   seed of the random number generator
+      uint64_t   length of the description, followed by its characters
+
+    padded with zeros to a multiple of eight bytes, followed by chunks,
+    each of which consists of
+
+      uint32_t   number of Stokes samples in the chunk, N
+      uint32_t   number of bytes of data that follow
+
+    and the I,Q,U,V values of N samples, compressed if so specified.
+    The last chunk is followed by an empty chunk (N = 0) whose data
+    is an index of the chunks:
+
+      uint64_t   offset of each chunk from the start of the file
+      uint64_t   number of Stokes samples in each chunk
+      uint64_t   number of chunks
+      uint64_t   offset of the empty chunk from the start of the file
+      char[8]    "EPSICIDX"
+
+    The chunks of a file without an index (e.g. if the writer was
+    interrupted) are located by scanning the file. */
+  struct stokes_file_header
+  {
+    enum Compression { None = 0, Zlib = 1 };
+
+    //! number of bytes in each value: 4 (float32) or 8 (float64)
+    unsigned dtype_size;
+
+    Compression compression;
+
+    //! number of instances in each Stokes sample
+    unsigned sample_size;
+
+    //! seed of the random number generator
+    uint64_t seed;
+
+    //! description of the configuration of the simulation
+    std::string config;
+
+    stokes_file_header ()
+    {
+      dtype_size = 4;
+      compression = None;
+      sample_size = 1;
+      seed = 0;
+    }
+  };
+
+  //! Return true if chunks can be compressed and decompressed
+  bool stokes_file_compression ();
+
+  //! Writes Stokes samples to a binary file using a separate thread
+  /*! Samples are copied into one of two buffers while the other is
+    compressed (if requested) and written by the output thread, so that
+    simulation is not stalled by the file system. */
+  class stokes_writer
+  {
+    std::ofstream file;
+    stokes_file_header header;
+
+    //! number of Stokes samples in each chunk
+    unsigned chunk_size;
+
+    //! the buffer being filled and the buffer being written
+    std::vector<char> buffer[2];
+    unsigned filling;
+    unsigned nfilled;
+
+    //! number of samples in the buffer being written (0 = none)
+    unsigned npending;
+
+    bool closing;
+    std::exception_ptr error;
+
+    //! the offset and number of samples of each chunk written
+    std::vector<uint64_t> offsets;
+    std::vector<uint64_t> counts;
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::thread output;
+
+    //! Compress and write pending buffers until closed
+    void write_chunks ();
+
+    //! Pass the filled buffer to the output thread
+    void submit ();
+
+    //! Stop and join the output thread, if it is running
+    void stop ();
+
+  public:
+
+    //! Open the file, write the header and start the output thread
+    stokes_writer (const std::string& filename, const stokes_file_header&,
+                   unsigned chunk_size = 64 * 1024);
+
+    //! Close the file, if not already closed
+    ~stokes_writer ();
+
+    stokes_writer (const stokes_writer&) = delete;
+    stokes_writer& operator = (const stokes_writer&) = delete;
+
+    //! Add n Stokes samples
+    void write (const Vector<4,double>* block, unsigned n);
+
+    //! Write any buffered samples, stop the output thread and close the file
+    void close ();
+  };
+
+  //! Sends the Stokes samples to a stokes_writer
+  /*! Copies share the same writer; therefore, only one copy should
+    consume samples. */
+  class stokes_recorder : public statistic
+  {
+    std::shared_ptr<stokes_writer> writer;
+
+  public:
+
+    stokes_recorder (std::shared_ptr<stokes_writer> w) : writer (w) { }
+
+    stokes_recorder* clone () const { return new stokes_recorder (*this); }
+
+    void consume (const Vector<4,double>* block, unsigned n)
+    { writer->write (block, n); }
+
+    void combine (const statistic&) { }
+  };
+
+  //! Reads Stokes samples from a binary file written by stokes_writer
+  class stokes_reader
+  {
+    std::ifstream file;
+    stokes_file_header header;
+
+    //! the values of the current chunk and the next sample to be read
+    std::vector<char> chunk;
+    unsigned nchunk;
+    unsigned current;
+
+    std::vector<char> compressed;
+
+    //! true after the last chunk has been read
+    bool finished;
+
+    //! Read the next chunk; return false at the end of the file
+    bool next_chunk ();
+
+  public:
+
+    //! Open the file and read the header
+    stokes_reader (const std::string& filename);
+
+    //! Return the header
+    const stokes_file_header& get_header () const { return header; }
+
+    //! Read up to n Stokes samples; return the number read (0 at the end)
+    unsigned read (Vector<4,double>* block, unsigned n);
+  };
+
+} // end of namespace epsic
+
+#endif // ! defined __epsic_stokes_file_h
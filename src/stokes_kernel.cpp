@@ -0,0 +1,199 @@
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+#include "stokes_kernel.h"
+#include "SIMD.h"
+
+#if SIMD_X86
+#include <immintrin.h>
+#endif
+
+/*
+  Each Spinor<double> is stored as four consecutive doubles,
+  e = (xr, xi, yr, yi), so that a block of field instances can be
+  loaded directly into vector registers.  The products needed for the
+  Stokes parameters are formed by multiplying e by itself and by two
+  permutations of itself:
+
+    e * e               = (xr^2, xi^2, yr^2, yi^2)   -> I and Q
+    e * (yr, yi, xr, xi) = (xr*yr, xi*yi, ...)        -> U = 2(xr*yr + xi*yi)
+    e * (yi, yr, xi, xr) = (xr*yi, xi*yr, ...)        -> V = 2(xr*yi - xi*yr)
+
+  Only the first two elements of the last two products are used.
+
+  Every path accumulates the products of even and odd instances
+  separately, multiplying and adding without fused multiply-add, so
+  that the sums do not depend on the instruction set.
+*/
+
+static_assert (sizeof(Spinor<double>) == 4 * sizeof(double),
+               "Spinor<double> must be stored as four consecutive doubles");
+
+//! Combine the accumulated products into the Stokes parameters
+static void add_products (Vector<4,double>& sum, const double* sq,
+                          const double* u, const double* v)
+{
+  double var_x = sq[0] + sq[1];
+  double var_y = sq[2] + sq[3];
+
+  sum[0] += var_x + var_y;
+  sum[1] += var_x - var_y;
+  sum[2] += 2.0 * (u[0] + u[1]);
+  sum[3] += 2.0 * (v[0] - v[1]);
+}
+
+//! Add the products of the instance at e to the accumulated products
+static SIMD_INLINE void add_instance (double* sq, double* u, double* v,
+                                     const double* e)
+{
+  for (unsigned j=0; j<4; j++)
+    sq[j] += e[j] * e[j];
+
+  u[0] += e[0] * e[2];
+  u[1] += e[1] * e[3];
+  v[0] += e[0] * e[3];
+  v[1] += e[1] * e[2];
+}
+
+//! Add the Stokes parameters of the last instance, if n is odd
+static void add_remainder (Vector<4,double>& sum, const double* e, unsigned n)
+{
+  if (n % 2 == 0)
+    return;
+
+  double sq[4] = { 0, 0, 0, 0 };
+  double u[2] = { 0, 0 };
+  double v[2] = { 0, 0 };
+
+  add_instance (sq, u, v, e);
+  add_products (sum, sq, u, v);
+}
+
+//! Portable implementation
+/*! As in the vectorized kernels, the products of the even and odd
+  instances are accumulated separately and then added, so that every
+  path computes the same sums. */
+static void accumulate_scalar (Vector<4,double>& sum, const double* e, unsigned n)
+{
+  double sq[2][4] = { { 0, 0, 0, 0 }, { 0, 0, 0, 0 } };
+  double u[2][2] = { { 0, 0 }, { 0, 0 } };
+  double v[2][2] = { { 0, 0 }, { 0, 0 } };
+
+  unsigned pairs = n / 2;
+  for (unsigned i=0; i<pairs; i++, e+=8)
+    for (unsigned k=0; k<2; k++)
+      add_instance (sq[k], u[k], v[k], e + 4*k);
+
+  for (unsigned j=0; j<4; j++)
+    sq[0][j] += sq[1][j];
+
+  for (unsigned j=0; j<2; j++)
+  {
+    u[0][j] += u[1][j];
+    v[0][j] += v[1][j];
+  }
+
+  add_products (sum, sq[0], u[0], v[0]);
+
+  add_remainder (sum, e, n);
+}
+
+#if SIMD_X86
+
+//! Two field instances per 512-bit register
+SIMD_TARGET_AVX512
+static void accumulate_avx512 (Vector<4,double>& sum, const double* e, unsigned n)
+{
+  __m512d sq = _mm512_setzero_pd();
+  __m512d u = _mm512_setzero_pd();
+  __m512d v = _mm512_setzero_pd();
+
+  /* the zero-masking forms of the permutations (with every element
+     selected) avoid spurious -Wuninitialized warnings from GCC 12 */
+  unsigned pairs = n / 2;
+  for (unsigned i=0; i<pairs; i++, e+=8)
+  {
+    __m512d r = _mm512_loadu_pd (e);
+    sq = _mm512_add_pd (sq, _mm512_mul_pd (r, r));
+    u = _mm512_add_pd (u, _mm512_mul_pd (r, _mm512_maskz_permutex_pd (0xFF, r, 0x4E)));
+    v = _mm512_add_pd (v, _mm512_mul_pd (r, _mm512_maskz_permutex_pd (0xFF, r, 0x1B)));
+  }
+
+  double s[8], a[8], b[8];
+  _mm512_storeu_pd (s, sq);
+  _mm512_storeu_pd (a, u);
+  _mm512_storeu_pd (b, v);
+
+  /* clear the upper halves of the registers, which GCC omits here;
+     otherwise later SSE code (e.g. exp in libm) is very slow */
+  _mm256_zeroupper ();
+
+  // fold the upper instance onto the lower instance
+  for (unsigned j=0; j<4; j++)
+  {
+    s[j] += s[j+4];
+    a[j] += a[j+4];
+    b[j] += b[j+4];
+  }
+
+  add_products (sum, s, a, b);
+
+  add_remainder (sum, e, n);
+}
+
+//! One field instance per 256-bit register, two independent accumulators
+SIMD_TARGET_AVX2
+static void accumulate_avx2 (Vector<4,double>& sum, const double* e, unsigned n)
+{
+  __m256d sq[2] = { _mm256_setzero_pd(), _mm256_setzero_pd() };
+  __m256d u[2] = { _mm256_setzero_pd(), _mm256_setzero_pd() };
+  __m256d v[2] = { _mm256_setzero_pd(), _mm256_setzero_pd() };
+
+  unsigned pairs = n / 2;
+  for (unsigned i=0; i<pairs; i++, e+=8)
+  {
+    for (unsigned k=0; k<2; k++)
+    {
+      __m256d r = _mm256_loadu_pd (e + 4*k);
+      sq[k] = _mm256_add_pd (sq[k], _mm256_mul_pd (r, r));
+      u[k] = _mm256_add_pd (u[k], _mm256_mul_pd (r, _mm256_permute4x64_pd (r, 0x4E)));
+      v[k] = _mm256_add_pd (v[k], _mm256_mul_pd (r, _mm256_permute4x64_pd (r, 0x1B)));
+    }
+  }
+
+  double s[4], a[4], b[4];
+  _mm256_storeu_pd (s, _mm256_add_pd (sq[0], sq[1]));
+  _mm256_storeu_pd (a, _mm256_add_pd (u[0], u[1]));
+  _mm256_storeu_pd (b, _mm256_add_pd (v[0], v[1]));
+  _mm256_zeroupper ();
+
+  add_products (sum, s, a, b);
+
+  add_remainder (sum, e, n);
+}
+
+#endif
+
+void epsic::accumulate_stokes (Vector<4,double>& sum,
+                               const Spinor<double>* fields, unsigned n)
+{
+  const double* e = reinterpret_cast<const double*> (fields);
+
+  switch (SIMD::get_path())
+  {
+#if SIMD_X86
+  case SIMD::AVX512:
+    accumulate_avx512 (sum, e, n);
+    break;
+  case SIMD::AVX2:
+    accumulate_avx2 (sum, e, n);
+    break;
+#endif
+  default:
+    accumulate_scalar (sum, e, n);
+  }
+}
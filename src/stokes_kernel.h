@@ -0,0 +1,27 @@
+//-*-C++-*-
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+//! @file epsic/src/stokes_kernel.h
+
+#ifndef __epsic_stokes_kernel_h
+#define __epsic_stokes_kernel_h
+
+#include "Spinor.h"
+#include "Vector.h"
+
+namespace epsic
+{
+  //! Add the sum of the Stokes parameters of n field instances to sum
+  /*! Equivalent to calling compute_stokes for each instance and adding
+    the results; uses AVX-512 or AVX2 instructions when supported
+    by the processor. */
+  void accumulate_stokes (Vector<4,double>& sum,
+                          const Spinor<double>* fields, unsigned n);
+}
+
+#endif // ! defined __epsic_stokes_kernel_h
@@ -0,0 +1,235 @@
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+#include "stokes_store.h"
+#include "work_pool.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+
+using namespace std;
+
+static_assert (sizeof(Vector<4,double>) == 4 * sizeof(double),
+               "Vector<4,double> is not a packed array of four doubles");
+
+epsic::stokes_store::stokes_store (const std::string& filename)
+{
+  int fd = open (filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw std::runtime_error ("epsic::stokes_store - could not open " + filename);
+
+  struct stat info;
+  if (fstat (fd, &info) < 0 || info.st_size == 0)
+  {
+    ::close (fd);
+    throw std::runtime_error ("epsic::stokes_store - could not stat " + filename);
+  }
+
+  size = info.st_size;
+  void* mapped = mmap (0, size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close (fd);
+
+  if (mapped == MAP_FAILED)
+    throw std::runtime_error ("epsic::stokes_store - could not map " + filename);
+
+  base = static_cast<const char*> (mapped);
+  madvise (mapped, size, MADV_SEQUENTIAL);
+
+  try
+  {
+    parse (filename);
+  }
+  catch (...)
+  {
+    munmap (mapped, size);
+    throw;
+  }
+}
+
+epsic::stokes_store::~stokes_store ()
+{
+  munmap (const_cast<char*>(base), size);
+}
+
+template<typename T>
+static T get (const char* base, size_t size, uint64_t offset)
+{
+  if (offset + sizeof(T) > size)
+    throw std::runtime_error ("epsic::stokes_store - file truncated");
+
+  T result;
+  memcpy (&result, base + offset, sizeof(T));
+  return result;
+}
+
+void epsic::stokes_store::parse (const std::string& filename)
+{
+  // parse the header with the reader
+  stokes_reader reader (filename);
+  header = reader.get_header();
+
+  if (header.compression != stokes_file_header::None)
+    throw std::runtime_error ("epsic::stokes_store - " + filename
+                              + " is compressed and cannot be mapped");
+
+  uint64_t start = 8 + 4*sizeof(uint32_t) + 2*sizeof(uint64_t) + header.config.size();
+  start = (start + 7) / 8 * 8;
+
+  uint64_t sample_bytes = 4 * header.dtype_size;
+
+  // use the index, if there is one
+  if (size >= start + 16 && memcmp (base + size - 8, "EPSICIDX", 8) == 0)
+  {
+    uint64_t index_offset = get<uint64_t> (base, size, size - 16);
+    uint64_t nchunk = get<uint64_t> (base, size, size - 24);
+
+    uint64_t entries = index_offset + 2*sizeof(uint32_t);
+    if (entries + 2 * nchunk * sizeof(uint64_t) > size)
+      throw std::runtime_error ("epsic::stokes_store - invalid index");
+
+    for (uint64_t ichunk=0; ichunk < nchunk; ichunk++)
+    {
+      uint64_t offset = get<uint64_t> (base, size, entries + ichunk*8);
+      uint64_t count = get<uint64_t> (base, size, entries + (nchunk+ichunk)*8);
+
+      if (offset + 8 + count * sample_bytes > size)
+        throw std::runtime_error ("epsic::stokes_store - invalid index");
+
+      offsets.push_back (offset + 2*sizeof(uint32_t));
+      counts.push_back (count);
+    }
+  }
+  else
+  {
+    // scan the complete chunks
+    uint64_t offset = start;
+    while (offset + 8 <= size)
+    {
+      uint32_t count = get<uint32_t> (base, size, offset);
+      uint32_t nbyte = get<uint32_t> (base, size, offset + 4);
+
+      if (count == 0 || nbyte != count * sample_bytes
+          || offset + 8 + nbyte > size)
+        break;
+
+      offsets.push_back (offset + 8);
+      counts.push_back (count);
+      offset += 8 + nbyte;
+    }
+  }
+
+  nsamp = 0;
+  for (auto count : counts)
+    nsamp += count;
+}
+
+void epsic::stokes_store::consume (unsigned start, unsigned end,
+                                   statistic* sink) const
+{
+  const unsigned block_size = 1024;
+  std::vector< Vector<4,double> > block;
+
+  for (unsigned ichunk=start; ichunk < end; ichunk++)
+  {
+    uint64_t count = counts[ichunk];
+
+    if (header.dtype_size == 8)
+    {
+      auto samples = reinterpret_cast<const Vector<4,double>*> (base + offsets[ichunk]);
+
+      for (uint64_t i=0; i < count; i += block_size)
+        sink->consume (samples + i, std::min<uint64_t> (block_size, count - i));
+
+      continue;
+    }
+
+    const float* values = get_values<float> (ichunk);
+    block.resize (block_size);
+
+    for (uint64_t i=0; i < count; i += block_size)
+    {
+      unsigned n = std::min<uint64_t> (block_size, count - i);
+      for (unsigned j=0; j < n; j++)
+        for (unsigned k=0; k < 4; k++)
+          block[j][k] = values[(i+j)*4 + k];
+
+      sink->consume (block.data(), n);
+    }
+  }
+}
+
+void epsic::stokes_store::consume_overlap (unsigned start,
+                                           statistic* sink) const
+{
+  unsigned overlap = sink->get_overlap();
+  if (overlap == 0)
+    return;
+
+  std::vector< Vector<4,double> > block;
+
+  for (unsigned ichunk=start; ichunk < offsets.size(); ichunk++)
+  {
+    uint64_t count = std::min<uint64_t> (counts[ichunk], overlap - block.size());
+
+    for (uint64_t i=0; i < count; i++)
+    {
+      Vector<4,double> sample;
+      for (unsigned k=0; k < 4; k++)
+        sample[k] = (header.dtype_size == 8)
+          ? get_values<double>(ichunk)[i*4 + k]
+          : get_values<float>(ichunk)[i*4 + k];
+      block.push_back (sample);
+    }
+
+    if (block.size() == overlap)
+      break;
+  }
+
+  sink->consume_overlap (block.data(), block.size());
+}
+
+void epsic::stokes_store::analyze (statistic* sink, unsigned nthread) const
+{
+  if (nthread == 0)
+    throw std::runtime_error ("epsic::stokes_store::analyze - invalid number of threads");
+
+  unsigned nchunk = offsets.size();
+  nthread = std::max (1u, std::min (nthread, nchunk));
+
+  std::vector<statistic*> copies (nthread, sink);
+  for (unsigned ithread=1; ithread < nthread; ithread++)
+    copies[ithread] = sink->clone();
+
+  try
+  {
+    run_threads (nthread, [&] (unsigned ithread)
+    {
+      unsigned end = (ithread+1) * nchunk / nthread;
+      consume (ithread * nchunk / nthread, end, copies[ithread]);
+      if (ithread+1 < nthread)
+        consume_overlap (end, copies[ithread]);
+    });
+  }
+  catch (...)
+  {
+    for (unsigned ithread=1; ithread < nthread; ithread++)
+      delete copies[ithread];
+    throw;
+  }
+
+  for (unsigned ithread=1; ithread < nthread; ithread++)
+  {
+    sink->combine (*copies[ithread]);
+    delete copies[ithread];
+  }
+}
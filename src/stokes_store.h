@@ -0,0 +1,94 @@
+//-*-C++-*-
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+//! @file epsic/src/stokes_store.h
+
+#ifndef __epsic_stokes_store_h
+#define __epsic_stokes_store_h
+
+#include "stokes_file.h"
+
+namespace epsic
+{
+  //! A file of Stokes samples, mapped into memory for repeated analysis
+  /*! The chunks of an uncompressed file written by stokes_writer are
+    located using its index (or, if there is no index, by scanning the
+    chunks) and are viewed in place, without copying.  float64 samples
+    are sent directly to the sinks; float32 samples are converted in
+    blocks. */
+  class stokes_store
+  {
+    stokes_file_header header;
+
+    //! the mapped file
+    const char* base;
+    size_t size;
+
+    //! the offset of the values and the number of samples in each chunk
+    std::vector<uint64_t> offsets;
+    std::vector<uint64_t> counts;
+
+    uint64_t nsamp;
+
+    //! Parse the header and locate the chunks
+    void parse (const std::string& filename);
+
+    //! Send the samples in chunks [start, end) to the sink
+    void consume (unsigned start, unsigned end, statistic* sink) const;
+
+    //! Send the overlap of samples that follow chunk start to the sink
+    void consume_overlap (unsigned start, statistic* sink) const;
+
+  public:
+
+    //! Map the file into memory
+    stokes_store (const std::string& filename);
+
+    //! Unmap the file
+    ~stokes_store ();
+
+    stokes_store (const stokes_store&) = delete;
+    stokes_store& operator = (const stokes_store&) = delete;
+
+    //! Return the header
+    const stokes_file_header& get_header () const { return header; }
+
+    //! Return the total number of Stokes samples
+    uint64_t get_nsamp () const { return nsamp; }
+
+    //! Return the number of chunks
+    unsigned get_nchunk () const { return offsets.size(); }
+
+    //! Return the number of Stokes samples in the specified chunk
+    uint64_t get_nsamp (unsigned ichunk) const { return counts.at(ichunk); }
+
+    //! Return a view of the I,Q,U,V values of the specified chunk
+    /*! T must be float for a float32 file or double for a float64 file */
+    template<typename T>
+    const T* get_values (unsigned ichunk) const;
+
+    //! Send every Stokes sample to the sink, divided between nthread copies
+    /*! Each thread consumes a contiguous range of chunks with its own
+      copy of the sink, followed by the overlap of samples that the
+      sink needs from the next range; the copies are then combined in
+      order, so that the result does not depend on nthread. */
+    void analyze (statistic* sink, unsigned nthread = 1) const;
+  };
+
+  template<typename T>
+  const T* stokes_store::get_values (unsigned ichunk) const
+  {
+    if (sizeof(T) != header.dtype_size)
+      throw std::runtime_error ("epsic::stokes_store::get_values - wrong type");
+
+    return reinterpret_cast<const T*> (base + offsets.at(ichunk));
+  }
+
+} // end of namespace epsic
+
+#endif // ! defined __epsic_stokes_store_h
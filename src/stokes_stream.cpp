@@ -0,0 +1,219 @@
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+#include "stokes_stream.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+epsic::stokes_stream::Format
+epsic::stokes_stream::parse_format (const std::string& name)
+{
+  if (name == "float32")
+    return Float32;
+  if (name == "float64")
+    return Float64;
+  if (name == "text")
+    return Text;
+
+  throw std::runtime_error ("epsic::stokes_stream::parse_format - unknown format " + name);
+}
+
+epsic::stokes_stream::stokes_stream (const std::string& filename, Format _format,
+                                     unsigned _block_size)
+{
+  if (_block_size == 0)
+    throw std::runtime_error ("epsic::stokes_stream - invalid block size");
+
+  format = _format;
+  block_size = _block_size;
+
+  if (filename == "-")
+  {
+    file = stdin;
+    close_file = false;
+  }
+  else
+  {
+    file = fopen (filename.c_str(), (format == Text) ? "r" : "rb");
+    if (!file)
+      throw std::runtime_error ("epsic::stokes_stream - could not open " + filename);
+    close_file = true;
+  }
+
+  for (unsigned i=0; i<2; i++)
+  {
+    buffer[i].resize (block_size);
+    count[i] = 0;
+    full[i] = false;
+  }
+
+  stopping = false;
+
+  input = std::thread (&stokes_stream::read_blocks, this);
+}
+
+epsic::stokes_stream::~stokes_stream ()
+{
+  {
+    std::lock_guard<std::mutex> lock (mutex);
+    stopping = true;
+    condition.notify_all ();
+  }
+
+  input.join ();
+
+  if (close_file)
+    fclose (file);
+}
+
+template<typename T>
+static void convert (Vector<4,double>* block, const char* bytes, unsigned n)
+{
+  const T* values = reinterpret_cast<const T*> (bytes);
+  for (unsigned i=0; i<n; i++)
+    for (unsigned j=0; j<4; j++)
+      block[i][j] = values[i*4+j];
+}
+
+unsigned epsic::stokes_stream::read_block (Vector<4,double>* block)
+{
+  if (format == Text)
+  {
+    char* line = 0;
+    size_t length = 0;
+    unsigned n = 0;
+
+    while (n < block_size && getline (&line, &length, file) > 0)
+    {
+      const char* start = line + strspn (line, " \t");
+      if (*start == '#' || *start == '\n' || *start == '\0')
+        continue;
+
+      char* end = 0;
+      for (unsigned j=0; j<4; j++, start = end)
+      {
+        block[n][j] = strtod (start, &end);
+        if (end == start)
+        {
+          free (line);
+          throw std::runtime_error ("epsic::stokes_stream - could not parse "
+                                    "four values on a line");
+        }
+      }
+      n++;
+    }
+
+    free (line);
+    return n;
+  }
+
+  unsigned sample_bytes = 4 * ((format == Float32) ? sizeof(float) : sizeof(double));
+  bytes.resize (block_size * sample_bytes);
+
+  size_t nbyte = fread (bytes.data(), 1, bytes.size(), file);
+
+  if (ferror (file))
+    throw std::runtime_error ("epsic::stokes_stream - read failed");
+
+  if (nbyte % sample_bytes)
+    throw std::runtime_error ("epsic::stokes_stream - last sample truncated");
+
+  unsigned n = nbyte / sample_bytes;
+
+  if (format == Float32)
+    convert<float> (block, bytes.data(), n);
+  else
+    convert<double> (block, bytes.data(), n);
+
+  return n;
+}
+
+void epsic::stokes_stream::read_blocks ()
+{
+  unsigned filling = 0;
+
+  std::unique_lock<std::mutex> lock (mutex);
+
+  while (true)
+  {
+    condition.wait (lock, [&] { return !full[filling] || stopping; });
+
+    if (stopping)
+      return;
+
+    lock.unlock ();
+
+    unsigned n = 0;
+    std::exception_ptr failure;
+
+    try
+    {
+      n = read_block (buffer[filling].data());
+    }
+    catch (...)
+    {
+      failure = std::current_exception ();
+    }
+
+    lock.lock ();
+
+    count[filling] = n;
+    full[filling] = true;
+    error = failure;
+    condition.notify_all ();
+
+    // an empty buffer marks the end of the input
+    if (n == 0 || error)
+      return;
+
+    filling = !filling;
+  }
+}
+
+uint64_t epsic::stokes_stream::analyze (statistic* sink)
+{
+  const unsigned consume_size = 1024;
+
+  uint64_t total = 0;
+  unsigned using_buffer = 0;
+
+  std::unique_lock<std::mutex> lock (mutex);
+
+  while (true)
+  {
+    condition.wait (lock, [&] { return full[using_buffer]; });
+
+    unsigned n = count[using_buffer];
+
+    if (n == 0)
+    {
+      if (error)
+        std::rethrow_exception (error);
+      return total;
+    }
+
+    lock.unlock ();
+
+    const Vector<4,double>* block = buffer[using_buffer].data();
+    for (unsigned i=0; i < n; i += consume_size)
+      sink->consume (block + i, std::min (consume_size, n - i));
+
+    total += n;
+
+    lock.lock ();
+
+    full[using_buffer] = false;
+    condition.notify_all ();
+
+    using_buffer = !using_buffer;
+  }
+}
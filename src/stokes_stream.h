@@ -0,0 +1,94 @@
+//-*-C++-*-
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+//! @file epsic/src/stokes_stream.h
+
+#ifndef __epsic_stokes_stream_h
+#define __epsic_stokes_stream_h
+
+#include "statistic.h"
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <cstdio>
+#include <cstdint>
+
+namespace epsic
+{
+  //! Stokes samples read from the standard input, a pipe or a file
+  /*! Each sample consists of the I,Q,U,V values, stored (in native byte
+    order) as float32 or float64, or written as text with the four values
+    of each sample on a separate line (e.g. the output of epsic -F text).
+    Blank lines and lines that start with # are ignored.
+
+    Blocks of samples are read and converted by a separate thread into
+    one of two buffers while the samples in the other buffer are sent to
+    the sink, so that reading overlaps with computation. */
+  class stokes_stream
+  {
+  public:
+
+    enum Format { Float32, Float64, Text };
+
+    //! Return the format named float32, float64 or text
+    static Format parse_format (const std::string&);
+
+    //! Open the named file or, if the name is "-", the standard input
+    stokes_stream (const std::string& filename, Format,
+                   unsigned block_size = 64 * 1024);
+
+    //! Stop the input thread and close the file
+    ~stokes_stream ();
+
+    stokes_stream (const stokes_stream&) = delete;
+    stokes_stream& operator = (const stokes_stream&) = delete;
+
+    //! Send every Stokes sample to the sink; return the number of samples
+    uint64_t analyze (statistic* sink);
+
+  private:
+
+    Format format;
+    FILE* file;
+    bool close_file;
+
+    //! number of Stokes samples in each block
+    unsigned block_size;
+
+    //! the Stokes samples in each buffer
+    std::vector< Vector<4,double> > buffer[2];
+
+    //! number of samples in each buffer (0 = end of input)
+    unsigned count[2];
+
+    //! true when the buffer has been filled and not yet consumed
+    bool full[2];
+
+    bool stopping;
+    std::exception_ptr error;
+
+    std::vector<char> bytes;
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::thread input;
+
+    //! Fill the buffers until the end of the input
+    void read_blocks ();
+
+    //! Read up to block_size samples into the block; return the number read
+    unsigned read_block (Vector<4,double>* block);
+  };
+
+} // end of namespace epsic
+
+#endif // ! defined __epsic_stokes_stream_h
@@ -6,18 +6,29 @@
  ***************************************************************************/
 
 #include "sample.h"
+#include "stokes_kernel.h"
 
 Stokes<double> epsic::superposed::get_Stokes ()
 {
+  // the sum of independent normal fields is normal
+  if (direct_sampling && A->is_normal() && B->is_normal())
+    return get_Wishart_Stokes (A->get_field_covariance()
+                               + B->get_field_covariance(), A->get_normal());
+
+  fields_A.resize (block_size);
+  fields_B.resize (block_size);
+
   Stokes<double> result;
-  for (unsigned i=0; i<sample_size; i++)
+  for (unsigned i=0; i<sample_size; i+=block_size)
   {
-    Spinor<double> e_A = A->get_field();
-    Spinor<double> e_B = B->get_field();
-    
-    Vector<4, double> tmp;
-    compute_stokes (tmp, e_A + e_B);
-    result += tmp;
+    unsigned n = get_block (i, sample_size);
+    A->get_fields (fields_A.data(), n);
+    B->get_fields (fields_B.data(), n);
+
+    for (unsigned j=0; j<n; j++)
+      fields_A[j] += fields_B[j];
+
+    accumulate_stokes (result, fields_A.data(), n);
   }
   result /= sample_size;
   return result;
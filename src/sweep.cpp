@@ -0,0 +1,125 @@
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+#include "sweep.h"
+#include "work_pool.h"
+
+#include <random>
+
+using namespace std;
+
+//! Return a well-mixed function of x (the finalizer of splitmix64)
+static uint64_t mix (uint64_t x)
+{
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+uint64_t epsic::sweep::get_seed (unsigned point, unsigned trial) const
+{
+  uint64_t index = uint64_t(point) * ntrial + trial + 1;
+  uint64_t result = mix (seed + index * 0x9e3779b97f4a7c15ULL);
+
+  // zero would request a random seed
+  return result ? result : 1;
+}
+
+void epsic::sweep::run (unsigned nthread)
+{
+  if (!seed)
+  {
+    std::random_device rd;
+    seed = (uint64_t(rd()) << 32) | rd();
+  }
+
+  trials.resize (points.size() * ntrial);
+
+  std::vector<work_stealing_pool::task> tasks;
+
+  for (unsigned ipoint=0; ipoint < points.size(); ipoint++)
+    for (unsigned itrial=0; itrial < ntrial; itrial++)
+    {
+      sweep_trial* result = &trials[ipoint * ntrial + itrial];
+      result->point = ipoint;
+      result->trial = itrial;
+      result->seed = get_seed (ipoint, itrial);
+
+      tasks.push_back ( [this, result] ()
+      {
+        const sweep_point& point = points[result->point];
+
+        simulation_config config = point.config;
+        config.nthread = 1;
+        config.seed = result->seed;
+
+        simulation sim (config);
+        sim.run (point.nsamp);
+
+        simulation_result stats = sim.get_result ();
+
+        result->count = stats.get_count();
+        result->mean = stats.get_mean();
+        result->covariance = stats.get_covariance();
+        result->degree_of_polarization = stats.degree_of_polarization;
+      } );
+    }
+
+  work_stealing_pool pool (nthread);
+  pool.run (tasks);
+}
+
+static const char* combination_name (epsic::simulation_config::Combination c)
+{
+  switch (c)
+  {
+  case epsic::simulation_config::Superposed: return "superposed";
+  case epsic::simulation_config::Composite: return "composite";
+  case epsic::simulation_config::Disjoint: return "disjoint";
+  case epsic::simulation_config::Coherent: return "coherent";
+  default: return "single";
+  }
+}
+
+void epsic::sweep::write (std::ostream& os) const
+{
+  os << "point trial seed nint nsamp combination parameter correlation"
+    " I_A Q_A U_A V_A beta_A I_B Q_B U_B V_B beta_B count"
+    " mean_I mean_Q mean_U mean_V var_I var_Q var_U var_V" << '\n';
+
+  for (auto& result : trials)
+  {
+    const sweep_point& point = points[result.point];
+    const simulation_config& config = point.config;
+
+    os << result.point << " " << result.trial << " " << result.seed << " "
+       << config.sample_size << " " << point.nsamp << " "
+       << combination_name (config.combination) << " "
+       << config.combination_parameter << " ";
+
+    if (config.covariant)
+      os << config.mode_correlation << " ";
+    else
+      os << "- ";
+
+    for (const mode_config* m : { &config.A, &config.B })
+    {
+      for (unsigned i=0; i<4; i++)
+        os << m->mean[i] << " ";
+      os << m->beta << " ";
+    }
+
+    os << result.count;
+
+    for (unsigned i=0; i<4; i++)
+      os << " " << result.mean[i];
+    for (unsigned i=0; i<4; i++)
+      os << " " << result.covariance[i][i];
+
+    os << '\n';
+  }
+}
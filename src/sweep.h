@@ -0,0 +1,93 @@
+//-*-C++-*-
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+//! @file epsic/src/sweep.h
+
+#ifndef __epsic_sweep_h
+#define __epsic_sweep_h
+
+#include "simulation.h"
+
+#include <ostream>
+
+namespace epsic
+{
+  //! A point in the grid of simulation parameters
+  struct sweep_point
+  {
+    simulation_config config;
+
+    //! number of Stokes samples simulated by each trial
+    uint64_t nsamp;
+
+    sweep_point () { nsamp = 1024 * 1024; }
+  };
+
+  //! The simulated statistics of one trial at one point
+  struct sweep_trial
+  {
+    unsigned point;
+    unsigned trial;
+    uint64_t seed;
+
+    uint64_t count;
+    Vector<4,double> mean;
+    Matrix<4,4,double> covariance;
+    double degree_of_polarization;
+  };
+
+  //! Runs independent trials of simulations over a grid of parameters
+  /*! Every trial is a separate single-threaded simulation with its own
+    seed, derived from the seed of the sweep and the index of the trial.
+    The trials are run on a work_stealing_pool, because their cost
+    varies widely with the number of instances in each Stokes sample. */
+  class sweep
+  {
+    std::vector<sweep_point> points;
+    std::vector<sweep_trial> trials;
+
+    unsigned ntrial;
+    uint64_t seed;
+
+  public:
+
+    sweep () { ntrial = 1; seed = 0; }
+
+    //! Add a point to the grid
+    void add (const sweep_point& point) { points.push_back (point); }
+
+    //! Return the number of points in the grid
+    unsigned get_npoint () const { return points.size(); }
+
+    //! Return the specified point
+    const sweep_point& get_point (unsigned i) const { return points.at(i); }
+
+    //! Set the number of trials simulated at each point
+    void set_ntrial (unsigned n) { ntrial = n; }
+    unsigned get_ntrial () const { return ntrial; }
+
+    //! Set the seed from which the seed of each trial is derived (0 = random)
+    void set_seed (uint64_t s) { seed = s; }
+    uint64_t get_seed () const { return seed; }
+
+    //! Return the seed of the specified trial at the specified point
+    uint64_t get_seed (unsigned point, unsigned trial) const;
+
+    //! Run every trial at every point using nthread threads
+    void run (unsigned nthread);
+
+    //! Return the results of every trial, ordered by point then trial
+    const std::vector<sweep_trial>& get_trials () const { return trials; }
+
+    //! Write one line per trial, preceded by a line of column names
+    void write (std::ostream&) const;
+  };
+
+} // end of namespace epsic
+
+#endif // ! defined __epsic_sweep_h
@@ -0,0 +1,117 @@
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+#include "simulation.h"
+
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+/*
+ * Verifies that a simulation resumed from a checkpoint produces exactly
+ * the same statistics as one that was not interrupted, even with a
+ * different instruction set, and that a checkpoint cannot be loaded by
+ * a different configuration
+ */
+
+int main ()
+{
+  const uint64_t nsamp = 100000;
+
+  epsic::simulation_config config;
+  config.combination = epsic::simulation_config::Superposed;
+  config.A.mean = Stokes<double> (1.0, 0.5, 0, 0);
+  config.A.beta = 0.3;
+  config.B.mean = Stokes<double> (1.0, 0, 0, 0.2);
+  config.sample_size = 4;
+  config.nlag = 3;
+  config.rho_stats = true;
+  config.nthread = 2;
+  config.seed = 123;
+
+  epsic::simulation whole (config);
+  whole.run (2*nsamp);
+
+  stringstream checkpoint;
+
+  // the first half is simulated without vector instructions
+  {
+    SIMD::set_path (SIMD::Scalar);
+    epsic::simulation first (config);
+    first.run (nsamp);
+    first.save (checkpoint);
+    SIMD::set_path (SIMD::get_supported());
+  }
+
+  // the seed is restored from the checkpoint
+  config.seed = 456;
+
+  epsic::simulation second (config);
+  second.load (checkpoint);
+
+  if (second.get_nsamp() != nsamp || second.get_config().seed != 123
+      || second.get_checkpoint_path() != SIMD::Scalar)
+  {
+    cerr << "simulation::load nsamp=" << second.get_nsamp()
+         << " seed=" << second.get_config().seed << " path="
+         << SIMD::get_name (second.get_checkpoint_path()) << " FAIL" << endl;
+    return -1;
+  }
+
+  second.run (nsamp);
+
+  epsic::simulation_result a = whole.get_result ();
+  epsic::simulation_result b = second.get_result ();
+
+  if (a.get_count() != b.get_count() || a.get_mean() != b.get_mean()
+      || a.get_covariance() != b.get_covariance()
+      || a.degree_of_polarization != b.degree_of_polarization)
+  {
+    cerr << "resumed Stokes moments differ FAIL" << endl;
+    return -1;
+  }
+
+  for (unsigned ilag=0; ilag < config.nlag; ilag++)
+    if (a.acf[ilag] != b.acf[ilag])
+    {
+      cerr << "resumed auto-covariance at lag " << ilag << " differs FAIL" << endl;
+      return -1;
+    }
+
+  if (a.coherency.get_mean() != b.coherency.get_mean()
+      || a.coherency.get_covariance() != b.coherency.get_covariance())
+  {
+    cerr << "resumed coherency moments differ FAIL" << endl;
+    return -1;
+  }
+
+  config.sample_size = 5;
+  epsic::simulation other (config);
+
+  checkpoint.clear ();
+  checkpoint.seekg (0);
+
+  bool caught = false;
+  try
+  {
+    other.load (checkpoint);
+  }
+  catch (std::runtime_error& error)
+  {
+    caught = true;
+  }
+
+  if (!caught)
+  {
+    cerr << "checkpoint of a different configuration loaded FAIL" << endl;
+    return -1;
+  }
+
+  cerr << "checkpoint tests PASS" << endl;
+  return 0;
+}
@@ -0,0 +1,168 @@
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+#include "covariant.h"
+#include "sample.h"
+
+#include <thread>
+#include <vector>
+#include <iostream>
+
+using namespace std;
+
+/*
+ * Verifies that covariant modes driven by different threads receive
+ * the same pairs of modulation factors as when driven by one thread,
+ * that an output that waits for a partner that never uses its factors
+ * gives up after the timeout, and that a copy of a sample of covariant modes deletes every mode
+ * that it copied
+ */
+
+//! a mode that counts its instances
+class counted_mode : public epsic::mode
+{
+public:
+  static int count;
+
+  counted_mode () { count ++; }
+  counted_mode (const counted_mode& that) : epsic::mode (that) { count ++; }
+  ~counted_mode () { count --; }
+
+  counted_mode* clone () const { return new counted_mode (*this); }
+};
+
+int counted_mode::count = 0;
+
+//! fill the array with n factors from mode, in blocks of various sizes
+void consume (epsic::modulated_mode* mode, vector<double>* result)
+{
+  unsigned n = result->size();
+  unsigned i = 0;
+  unsigned block = 1;
+  while (i < n)
+  {
+    unsigned count = std::min (block, n - i);
+    mode->modulations (result->data() + i, count);
+    i += count;
+    block = (block * 7) % 1500 + 1;
+  }
+}
+
+int main ()
+{
+  const unsigned n = 100000;
+
+  // reference: both modes driven by one thread in equal blocks
+  BoxMuller serial_normal (17, 0);
+  epsic::bivariate_lognormal_modes serial (0.5);
+  serial.set_normal (&serial_normal);
+
+  epsic::modulated_mode* serial_A = serial.get_modulated_mode (0, new epsic::mode);
+  epsic::modulated_mode* serial_B = serial.get_modulated_mode (1, new epsic::mode);
+
+  vector<double> expect_A (n), expect_B (n);
+  for (unsigned i=0; i<n; i+=100)
+  {
+    serial_A->modulations (expect_A.data() + i, 100);
+    serial_B->modulations (expect_B.data() + i, 100);
+  }
+
+  // each mode driven by its own thread at a different pace
+  BoxMuller parallel_normal (17, 0);
+  epsic::bivariate_lognormal_modes parallel (0.5);
+  parallel.set_normal (&parallel_normal);
+  parallel.set_blocking (true);
+
+  epsic::modulated_mode* parallel_A = parallel.get_modulated_mode (0, new epsic::mode);
+  epsic::modulated_mode* parallel_B = parallel.get_modulated_mode (1, new epsic::mode);
+
+  vector<double> got_A (n), got_B (n);
+  std::thread thread_A (consume, parallel_A, &got_A);
+  std::thread thread_B (consume, parallel_B, &got_B);
+  thread_A.join ();
+  thread_B.join ();
+
+  if (got_A != expect_A || got_B != expect_B)
+  {
+    cerr << "covariant_mode pairs differ when driven by two threads FAIL" << endl;
+    return -1;
+  }
+
+  {
+    BoxMuller normal (17, 0);
+    epsic::bivariate_lognormal_modes stalled (0.5);
+    stalled.set_normal (&normal);
+    stalled.set_blocking (true, 0.01);
+
+    epsic::mode* source_A = new epsic::mode;
+    epsic::mode* source_B = new epsic::mode;
+    epsic::modulated_mode* A = stalled.get_modulated_mode (0, source_A);
+    epsic::modulated_mode* B = stalled.get_modulated_mode (1, source_B);
+
+    // B never uses its factors, so A cannot have more than a buffer full
+    vector<double> got (epsic::covariant_mode::buffer_size + 1);
+    bool timed_out = false;
+    try
+    {
+      A->modulations (got.data(), got.size());
+    }
+    catch (std::runtime_error&)
+    {
+      timed_out = true;
+    }
+
+    delete A;
+    delete B;
+    delete source_A;
+    delete source_B;
+
+    if (!timed_out)
+    {
+      cerr << "covariant_mode did not time out waiting for its partner FAIL" << endl;
+      return -1;
+    }
+  }
+
+  {
+    epsic::bivariate_lognormal_modes coordinator (0.5);
+
+    epsic::superposed dual;
+    delete dual.A;
+    delete dual.B;
+
+    epsic::mode* source_A = new counted_mode;
+    epsic::mode* source_B = new counted_mode;
+
+    epsic::modulated_mode* mod_A = coordinator.get_modulated_mode (0, source_A);
+    dual.A = new epsic::boxcar_modulated_mode (mod_A, 4);
+    dual.B = coordinator.get_modulated_mode (1, source_B);
+
+    for (unsigned i=0; i<3; i++)
+    {
+      epsic::sample* copy = dual.clone ();
+      BoxMuller normal (17, i+1);
+      copy->set_normal (&normal);
+      copy->get_Stokes ();
+      delete copy;
+    }
+
+    if (counted_mode::count != 2)
+    {
+      cerr << "covariant_mode copies left " << counted_mode::count - 2
+           << " sources undeleted FAIL" << endl;
+      return -1;
+    }
+
+    // the original modes are owned by their creator, except those of the sample
+    delete mod_A;
+    delete source_A;
+    delete source_B;
+  }
+
+  cerr << "covariant_mode test PASS" << endl;
+  return 0;
+}
@@ -0,0 +1,151 @@
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+#include "ensemble.h"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <cmath>
+
+using namespace std;
+
+/*
+ * Verifies that the mean of each Stokes parameter over an ensemble of
+ * trials is consistent with the expected mean, that its standard
+ * deviation matches the expected standard error, that the estimates
+ * survive a round trip through the binary format, and that the source
+ * statistics of a phase-resolved ensemble are consistent with those of
+ * the on-pulse bin
+ */
+
+int main ()
+{
+  const unsigned ntrial = 64;
+  const uint64_t nsamp = 4000;
+
+  epsic::simulation_config config;
+  config.A.mean = Stokes<double> (1.0, 0.3, 0.2, 0.1);
+
+  epsic::ensemble trials (config, nsamp, ntrial);
+  trials.set_seed (13);
+  trials.run (2);
+
+  if (trials.get_ntrial() != ntrial || trials.get_nestimator() != 16)
+  {
+    cerr << "ensemble dimensions FAIL" << endl;
+    return -1;
+  }
+
+  epsic::simulation sim (config);
+  epsic::simulation_result expected = sim.get_result ();
+
+  for (unsigned i=0; i<4; i++)
+  {
+    double mean = trials.get_mean (i);
+    double stddev = trials.get_stddev (i);
+
+    double variance = expected.expected_covariance[i][i];
+    double error = sqrt (variance / nsamp);
+
+    if (fabs (mean - expected.expected_mean[i]) > 5 * error / sqrt(ntrial))
+    {
+      cerr << "ensemble " << trials.get_name(i) << " mean=" << mean
+           << " expected=" << expected.expected_mean[i] << " FAIL" << endl;
+      return -1;
+    }
+
+    if (stddev < 0.7 * error || stddev > 1.3 * error)
+    {
+      cerr << "ensemble " << trials.get_name(i) << " stddev=" << stddev
+           << " expected=" << error << " FAIL" << endl;
+      return -1;
+    }
+
+    if (trials.get_expected (i) != expected.expected_mean[i])
+    {
+      cerr << "ensemble " << trials.get_name(i) << " get_expected FAIL" << endl;
+      return -1;
+    }
+  }
+
+  if (trials.get_index ("covar_QU") != 9)
+  {
+    cerr << "ensemble get_index FAIL" << endl;
+    return -1;
+  }
+
+  stringstream binary;
+  trials.write_binary (binary);
+
+  epsic::ensemble copy (binary);
+
+  if (copy.get_ntrial() != ntrial || copy.get_nestimator() != 16)
+  {
+    cerr << "ensemble binary round trip dimensions FAIL" << endl;
+    return -1;
+  }
+
+  for (unsigned t=0; t<ntrial; t++)
+    for (unsigned i=0; i<copy.get_nestimator(); i++)
+      if (copy.get_value(t,i) != trials.get_value(t,i)
+          || copy.get_name(i) != trials.get_name(i))
+      {
+        cerr << "ensemble binary round trip trial=" << t
+             << " estimator=" << i << " FAIL" << endl;
+        return -1;
+      }
+
+  stringstream csv;
+  trials.write_csv (csv);
+
+  unsigned nline = 0;
+  string line;
+  while (getline (csv, line))
+    nline ++;
+
+  if (nline != ntrial + 1)
+  {
+    cerr << "ensemble csv lines=" << nline << " FAIL" << endl;
+    return -1;
+  }
+
+  // an on-pulse bin with a duty cycle of 0.5 and an off-pulse reference
+  epsic::phase_resolved profile;
+  profile.add_on_off (config, 0.5);
+
+  epsic::ensemble bins (profile, 2*nsamp, ntrial);
+  bins.set_seed (13);
+  bins.run (2);
+
+  // four estimators in each bin and two source estimators in the on-pulse bin
+  if (bins.get_ntrial() != ntrial || bins.get_nestimator() != 10
+      || profile.get_reference() != 1)
+  {
+    cerr << "phase-resolved ensemble dimensions FAIL" << endl;
+    return -1;
+  }
+
+  for (string name : { "mean_I_0", "mu2_I_0", "src_mean_I_0", "src_var_I_0" })
+  {
+    unsigned i = bins.get_index (name);
+
+    double mean = bins.get_mean (i);
+    double error = bins.get_stddev (i) / sqrt(ntrial);
+    double target = bins.get_expected (i);
+
+    if (std::isnan (target) || fabs (mean - target) > 5 * error)
+    {
+      cerr << "phase-resolved ensemble " << name << " mean=" << mean
+           << " expected=" << target << " FAIL" << endl;
+      return -1;
+    }
+  }
+
+  cerr << "ensemble tests PASS" << endl;
+  return 0;
+}
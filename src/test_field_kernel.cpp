@@ -0,0 +1,91 @@
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+#include "field_kernel.h"
+#include "BoxMuller.h"
+#include "SIMD.h"
+
+#include <vector>
+#include <iostream>
+#include <cmath>
+
+using namespace std;
+
+/*
+ * Verifies that polarize reproduces the product of a Jones matrix and
+ * a spinor of scaled normal deviates, using every instruction set
+ * supported by the processor, and that every instruction set computes
+ * exactly the same fields
+ */
+
+int main ()
+{
+  const unsigned nmax = 100;
+  const double rms = 0.7;
+
+  BoxMuller normal (11, 0);
+  vector<float> deviates (4*nmax);
+  normal.fill (deviates.data(), deviates.size());
+
+  Jones<double> polarizer (complex<double> (0.9, 0.1), complex<double> (-0.3, 0.4),
+                           complex<double> (0.2, -0.6), complex<double> (1.1, 0.5));
+
+  vector< Spinor<double> > expect (nmax);
+  for (unsigned i=0; i<nmax; i++)
+  {
+    const float* d = deviates.data() + 4*i;
+    complex<double> x (rms * d[0], rms * d[1]);
+    complex<double> y (rms * d[2], rms * d[3]);
+    expect[i] = polarizer * Spinor<double> (x, y);
+  }
+
+  // every instruction set computes exactly the fields of the portable implementation
+  SIMD::set_path (SIMD::Scalar);
+  vector< Spinor<double> > scalar (nmax);
+  epsic::polarize (scalar.data(), polarizer, rms, deviates.data(), nmax);
+
+  for (int path = SIMD::Scalar; path <= SIMD::get_supported(); path++)
+  {
+    SIMD::set_path (SIMD::Path(path));
+
+    for (unsigned n=0; n<=nmax; n += (n < 20) ? 1 : 27)
+    {
+      vector< Spinor<double> > got (nmax + 1);
+      epsic::polarize (got.data(), polarizer, rms, deviates.data(), n);
+
+      for (unsigned i=0; i<n; i++)
+        if (abs (got[i].x - expect[i].x) > 1e-12 ||
+            abs (got[i].y - expect[i].y) > 1e-12)
+        {
+          cerr << "polarize " << SIMD::get_name (SIMD::Path(path))
+               << " n=" << n << " i=" << i << " got=" << got[i]
+               << " expected=" << expect[i] << " FAIL" << endl;
+          return -1;
+        }
+
+      for (unsigned i=0; i<n; i++)
+        if (got[i].x != scalar[i].x || got[i].y != scalar[i].y)
+        {
+          cerr << "polarize " << SIMD::get_name (SIMD::Path(path))
+               << " n=" << n << " i=" << i << " got=" << got[i]
+               << " differs from scalar=" << scalar[i] << " FAIL" << endl;
+          return -1;
+        }
+
+      // elements beyond n are not modified
+      if (got[n].x != complex<double>() || got[n].y != complex<double>())
+      {
+        cerr << "polarize " << SIMD::get_name (SIMD::Path(path))
+             << " wrote beyond n=" << n << " FAIL" << endl;
+        return -1;
+      }
+    }
+  }
+
+  cerr << "polarize test PASS" << endl;
+  return 0;
+}
@@ -0,0 +1,210 @@
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+#include "file_mode.h"
+#include "simulation.h"
+
+#include <iostream>
+#include <fstream>
+#include <random>
+#include <memory>
+#include <cstdio>
+#include <cmath>
+
+using namespace std;
+
+//! Write a header of nheader bytes followed by the values
+template<typename T>
+void write_file (const char* filename, unsigned nheader, const vector<double>& values)
+{
+  ofstream out (filename, ios::binary);
+  for (unsigned i=0; i < nheader; i++)
+    out.put ('H');
+  for (double v : values)
+  {
+    T value = v;
+    out.write (reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+}
+
+/*
+ * Verifies that a file_mode converts each format of baseband data into
+ * field instances, that each copy reads its own range of the file, that
+ * the mean Stokes parameters are estimated from the data, and that a
+ * simulation of recorded fields computes the moments of their Stokes
+ * parameters, with each thread reading contiguous instances
+ */
+
+int main ()
+{
+  const char* filename = "test_file_mode.dat";
+  const unsigned ninstance = 1000;
+  const unsigned nheader = 16;
+
+  std::mt19937 generator (13);
+  std::normal_distribution<double> normal (0.0, 10.0);
+
+  vector<double> values (4 * ninstance);
+  for (auto& v : values)
+    v = std::round (normal (generator));
+
+  // polarize the x component
+  for (unsigned i=0; i < ninstance; i++)
+    values[i*4] *= 2;
+
+  Vector<4,double> expected;
+  for (unsigned i=0; i < ninstance; i++)
+  {
+    Spinor<double> e (complex<double> (values[i*4], values[i*4+1]),
+                      complex<double> (values[i*4+2], values[i*4+3]));
+    Vector<4,double> stokes;
+    compute_stokes (stokes, e);
+    expected += stokes;
+  }
+  expected /= double (ninstance);
+
+  for (string format : { "int8", "int16", "float32" })
+  {
+    epsic::file_mode::Format f = epsic::file_mode::parse_format (format);
+
+    if (f == epsic::file_mode::Int8)
+      write_file<int8_t> (filename, nheader, values);
+    else if (f == epsic::file_mode::Int16)
+      write_file<int16_t> (filename, nheader, values);
+    else
+      write_file<float> (filename, nheader, values);
+
+    if (epsic::file_mode::count_instances (filename, f, nheader) != ninstance)
+    {
+      cerr << "file_mode::count_instances " << format << " FAIL" << endl;
+      return -1;
+    }
+
+    epsic::file_mode source (filename, f, nheader);
+
+    if (source.get_ninstance() != ninstance)
+    {
+      cerr << "file_mode::get_ninstance " << format << " FAIL" << endl;
+      return -1;
+    }
+
+    Stokes<double> mean = source.get_mean();
+    for (unsigned i=0; i<4; i++)
+      if (fabs (mean[i] - expected[i]) > 1e-9 * expected[0])
+      {
+        cerr << "file_mode " << format << " mean=" << mean
+             << " expected=" << expected << " FAIL" << endl;
+        return -1;
+      }
+
+    // each copy reads its own range of the file
+    std::unique_ptr<epsic::file_mode> copy (source.clone());
+    copy->set_range (500, ninstance);
+    source.set_range (0, 500);
+
+    vector< Spinor<double> > fields (ninstance);
+    fields[0] = source.get_field ();
+    source.get_fields (fields.data() + 1, 499);
+    for (unsigned i=500; i < ninstance; i += 100)
+      copy->get_fields (fields.data() + i, 100);
+
+    for (unsigned i=0; i < ninstance; i++)
+      if (fields[i].x != complex<double> (values[i*4], values[i*4+1])
+          || fields[i].y != complex<double> (values[i*4+2], values[i*4+3]))
+      {
+        cerr << "file_mode " << format << " instance " << i << " FAIL" << endl;
+        return -1;
+      }
+
+    if (source.get_position() != 500 || copy->get_position() != ninstance)
+    {
+      cerr << "file_mode::get_position " << format << " FAIL" << endl;
+      return -1;
+    }
+
+    bool thrown = false;
+    try
+    {
+      source.get_field ();
+    }
+    catch (std::exception&)
+    {
+      thrown = true;
+    }
+
+    if (!thrown)
+    {
+      cerr << "file_mode " << format << " read beyond the end of data FAIL" << endl;
+      return -1;
+    }
+  }
+
+  // a simulation of the recorded fields
+  const unsigned sample_size = 10;
+
+  epsic::simulation_config config;
+  config.A.baseband_file = filename;
+  config.A.baseband_format = epsic::file_mode::Float32;
+  config.A.baseband_offset = nheader;
+  config.sample_size = sample_size;
+  config.seed = 1;
+
+  epsic::simulation sim (config);
+  sim.run (ninstance / sample_size);
+
+  epsic::simulation_result result = sim.get_result ();
+
+  for (unsigned i=0; i<4; i++)
+    if (fabs (result.get_mean()[i] - expected[i]) > 1e-9 * expected[0]
+        || fabs (result.expected_mean[i] - expected[i]) > 1e-9 * expected[0])
+    {
+      cerr << "simulation of recorded fields mean=" << result.get_mean()
+           << " expected=" << expected << " FAIL" << endl;
+      return -1;
+    }
+
+  bool thrown = false;
+  try
+  {
+    sim.run (1);
+  }
+  catch (std::exception&)
+  {
+    thrown = true;
+  }
+
+  if (!thrown)
+  {
+    cerr << "simulation beyond the end of the recorded fields FAIL" << endl;
+    return -1;
+  }
+
+  /* each thread forms its Stokes samples from a contiguous range of
+     instances; therefore, the moments are those of the samples formed
+     by a single thread */
+  Matrix<4,4,double> covariance = result.get_covariance ();
+
+  config.nthread = 3;
+  epsic::simulation threaded (config);
+  threaded.run (ninstance / sample_size);
+
+  Matrix<4,4,double> threaded_covariance = threaded.get_result().get_covariance ();
+
+  for (unsigned i=0; i<4; i++)
+    for (unsigned j=0; j<4; j++)
+      if (fabs (threaded_covariance[i][j] - covariance[i][j]) > 1e-9 * covariance[0][0])
+      {
+        cerr << "simulation of recorded fields with 3 threads covariance="
+             << threaded_covariance << " expected=" << covariance << " FAIL" << endl;
+        return -1;
+      }
+
+  remove (filename);
+
+  cerr << "file_mode tests PASS" << endl;
+  return 0;
+}
@@ -0,0 +1,72 @@
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+#include "modulated.h"
+#include "covariant.h"
+
+#include <iostream>
+
+using namespace std;
+
+/*
+ * Verifies that the cached covariances of a decorated mode are
+ * recomputed after the statistics of any mode in the chain change
+ */
+
+//! returns true if the cached statistics equal freshly computed ones
+bool consistent (const epsic::mode* m, const char* when)
+{
+  bool ok = m->get_cached_covariance() == m->get_covariance();
+
+  for (unsigned ilag=0; ilag < 4; ilag++)
+    ok = ok && m->get_cached_crosscovariance(ilag) == m->get_crosscovariance(ilag);
+
+  if (!ok)
+    cerr << "mode cache is stale " << when << " FAIL" << endl;
+
+  return ok;
+}
+
+int main ()
+{
+  epsic::mode* source = new epsic::mode;
+  epsic::lognormal_mode* lognormal = new epsic::lognormal_mode (source, 1.0);
+  epsic::boxcar_modulated_mode boxcar (lognormal, 3);
+
+  if (!consistent (&boxcar, "initially"))
+    return -1;
+
+  Matrix<4,4, double> before = boxcar.get_cached_covariance ();
+
+  source->set_Stokes (Stokes<double> (2.0, 0.5, 0.0, 0.0));
+  if (!consistent (&boxcar, "after set_Stokes"))
+    return -1;
+
+  if (boxcar.get_cached_covariance() == before)
+  {
+    cerr << "mode cache not invalidated by set_Stokes FAIL" << endl;
+    return -1;
+  }
+
+  lognormal->set_beta (0.5);
+  if (!consistent (&boxcar, "after set_beta"))
+    return -1;
+
+  epsic::bivariate_lognormal_modes coordinator (0.5);
+  epsic::modulated_mode* covariant
+    = coordinator.get_modulated_mode (0, new epsic::mode);
+
+  if (!consistent (covariant, "of covariant mode"))
+    return -1;
+
+  coordinator.set_beta (0, 2.0);
+  if (!consistent (covariant, "after covariant set_beta"))
+    return -1;
+
+  cerr << "mode cache test PASS" << endl;
+  return 0;
+}
@@ -0,0 +1,121 @@
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+#include "moments.h"
+#include "BoxMuller.h"
+
+#include <vector>
+#include <iostream>
+#include <cmath>
+
+using namespace std;
+
+/*
+ * Verifies that moment_accumulator estimates the covariance of samples
+ * with a mean that is much larger than the standard deviation, and that
+ * merging partial accumulators reproduces the serial result
+ */
+
+int main ()
+{
+  const unsigned nsamp = 1000000;
+  const double offset = 1e8;
+
+  BoxMuller normal (13, 0);
+  vector<double> deviates (2*nsamp);
+  normal.fill (deviates.data(), deviates.size());
+
+  vector< Vector<2,double> > x (nsamp);
+  for (unsigned i=0; i<nsamp; i++)
+  {
+    x[i][0] = offset + deviates[2*i];
+    x[i][1] = offset + 0.5*deviates[2*i] + 2.0*deviates[2*i+1];
+  }
+
+  // two-pass reference computed in extended precision
+  long double mean[2] = { 0, 0 };
+  for (unsigned i=0; i<nsamp; i++)
+    for (unsigned j=0; j<2; j++)
+      mean[j] += x[i][j];
+  for (unsigned j=0; j<2; j++)
+    mean[j] /= nsamp;
+
+  long double covar[2][2] = { { 0, 0 }, { 0, 0 } };
+  for (unsigned i=0; i<nsamp; i++)
+    for (unsigned j=0; j<2; j++)
+      for (unsigned k=0; k<2; k++)
+        covar[j][k] += (x[i][j] - mean[j]) * (x[i][k] - mean[k]);
+
+  epsic::moment_accumulator<2> serial;
+  for (unsigned i=0; i<nsamp; i++)
+    serial.add (x[i]);
+
+  Matrix<2,2,double> result = serial.get_covariance ();
+
+  for (unsigned j=0; j<2; j++)
+    for (unsigned k=0; k<2; k++)
+    {
+      double expect = covar[j][k] / nsamp;
+      if (fabs(result[j][k] - expect) > 1e-6 * fabs(expect))
+      {
+        cerr << "moment_accumulator covariance[" << j << "][" << k << "]="
+             << result[j][k] << " expected=" << expect << " FAIL" << endl;
+        return -1;
+      }
+    }
+
+  // merge accumulators of unequal size
+  const unsigned nsplit = 7;
+  vector< epsic::moment_accumulator<2> > parts (nsplit);
+  for (unsigned i=0; i<nsamp; i++)
+    parts[ (i*i) % nsplit ].add (x[i]);
+
+  epsic::moment_accumulator<2> merged;
+  for (unsigned i=0; i<nsplit; i++)
+    merged.combine (parts[i]);
+
+  Matrix<2,2,double> merged_covar = merged.get_covariance ();
+
+  if (merged.get_count() != nsamp)
+  {
+    cerr << "moment_accumulator::combine count FAIL" << endl;
+    return -1;
+  }
+
+  for (unsigned j=0; j<2; j++)
+  {
+    if (fabs(merged.get_mean()[j] - serial.get_mean()[j]) > 1e-12 * offset)
+    {
+      cerr << "moment_accumulator::combine mean FAIL" << endl;
+      return -1;
+    }
+
+    for (unsigned k=0; k<2; k++)
+      if (fabs(merged_covar[j][k] - result[j][k]) > 1e-6 * fabs(result[j][k]))
+      {
+        cerr << "moment_accumulator::combine covariance FAIL" << endl;
+        return -1;
+      }
+  }
+
+  // the cross-covariance of a vector with itself is its covariance
+  epsic::cross_moment_accumulator<2,2> cross;
+  for (unsigned i=0; i<nsamp; i++)
+    cross.add (x[i], x[i]);
+
+  Matrix<2,2,double> cross_covar = cross.get_covariance ();
+  for (unsigned j=0; j<2; j++)
+    for (unsigned k=0; k<2; k++)
+      if (fabs(cross_covar[j][k] - result[j][k]) > 1e-6 * fabs(result[j][k]))
+      {
+        cerr << "cross_moment_accumulator covariance FAIL" << endl;
+        return -1;
+      }
+
+  cerr << "moment_accumulator tests PASS" << endl;
+  return 0;
+}
@@ -0,0 +1,111 @@
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+#include "phase_resolved.h"
+
+#include <iostream>
+#include <cmath>
+
+using namespace std;
+
+/*
+ * Verifies that the Stokes samples are shared between phase bins in
+ * proportion to their weights, that the moments of each bin match
+ * their expected values, and that the source mean and variance derived
+ * from on-pulse and off-pulse bins match those of the source alone
+ */
+
+int main ()
+{
+  const uint64_t nsamp = 1 << 20;
+  const unsigned nint = 4;
+  const double source = 2.0;
+  const double duty_cycle = 0.25;
+
+  // the source superposed on unpolarized noise of unit intensity
+  epsic::simulation_config on;
+  on.combination = epsic::simulation_config::Superposed;
+  on.A.mean = Stokes<double> (source, 0, 0, 0);
+  on.B.mean = Stokes<double> (1, 0, 0, 0);
+  on.sample_size = nint;
+
+  epsic::phase_resolved bins;
+  bins.add_on_off (on, duty_cycle);
+  bins.set_nthread (2);
+  bins.set_seed (31);
+  bins.run (nsamp);
+
+  if (bins.get_nbin() != 2 || bins.get_reference() != 1)
+  {
+    cerr << "phase_resolved on/off bins FAIL" << endl;
+    return -1;
+  }
+
+  for (unsigned ibin=0; ibin < 2; ibin++)
+  {
+    epsic::simulation_result result = bins.get_result (ibin);
+
+    uint64_t expected_count = llround (nsamp * bins.get_weight (ibin));
+    if (result.get_count() != expected_count)
+    {
+      cerr << "phase_resolved bin " << ibin << " count=" << result.get_count()
+           << " expected=" << expected_count << " FAIL" << endl;
+      return -1;
+    }
+
+    double mean = result.get_mean()[0];
+    double variance = result.get_covariance()[0][0];
+    double error = sqrt (result.expected_covariance[0][0] / result.get_count());
+
+    if (fabs (mean - result.expected_mean[0]) > 5 * error)
+    {
+      cerr << "phase_resolved bin " << ibin << " mean=" << mean
+           << " expected=" << result.expected_mean[0] << " FAIL" << endl;
+      return -1;
+    }
+
+    if (fabs (variance / result.expected_covariance[0][0] - 1.0) > 0.02)
+    {
+      cerr << "phase_resolved bin " << ibin << " var=" << variance
+           << " expected=" << result.expected_covariance[0][0] << " FAIL" << endl;
+      return -1;
+    }
+  }
+
+  // the variance of the mean of nint instances of unpolarized noise
+  double expected_variance = source * source / (2 * nint);
+
+  double src_mean = bins.get_source_mean(0)[0];
+  double src_variance = bins.get_source_variance (0);
+
+  if (fabs (src_mean - source) > 0.01 ||
+      fabs (src_variance / expected_variance - 1.0) > 0.05)
+  {
+    cerr << "phase_resolved source mean=" << src_mean
+         << " var=" << src_variance << " expected=" << expected_variance
+         << " FAIL" << endl;
+    return -1;
+  }
+
+  epsic::phase_resolved profile;
+  for (double intensity : { 1.5, 1.0, 3.0 })
+  {
+    epsic::simulation_config bin;
+    bin.A.mean = Stokes<double> (intensity, 0, 0, 0);
+    profile.add (bin);
+  }
+
+  if (profile.get_reference() != 1)
+  {
+    cerr << "phase_resolved reference=" << profile.get_reference()
+         << " expected=1 FAIL" << endl;
+    return -1;
+  }
+
+  cerr << "phase_resolved tests PASS" << endl;
+  return 0;
+}
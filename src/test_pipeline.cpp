@@ -0,0 +1,125 @@
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+#include "pipeline.h"
+
+#include <iostream>
+
+using namespace std;
+using namespace epsic;
+
+/*
+ * Verifies that each statically composed pipeline generates exactly
+ * the same field instances as the equivalent chain of decorators
+ */
+
+//! Build a chain of decorators that draws from normal
+mode* decorated (BoxMuller* normal, unsigned smooth_mod,
+                 unsigned square_mod, unsigned smooth_field)
+{
+  mode* source = new mode;
+  source->set_Stokes (Stokes<double> (1.0, 0.3, -0.2, 0.4));
+  source->set_normal (normal);
+
+  modulated_mode* mod = new lognormal_mode (source, 0.8);
+  mode* s = mod;
+
+  if (smooth_mod > 1)
+    s = new boxcar_modulated_mode (mod, smooth_mod);
+
+  if (square_mod > 1)
+    s = new square_modulated_mode (mod, square_mod, 16);
+
+  if (smooth_field > 1)
+    s = new boxcar_mode (s, smooth_field);
+
+  return s;
+}
+
+template<class Pipeline>
+bool test (const char* name, unsigned smooth_mod,
+           unsigned square_mod, unsigned smooth_field)
+{
+  BoxMuller normal_A (17, 0);
+  BoxMuller normal_B (17, 0);
+
+  mode* expect = decorated (&normal_A, smooth_mod, square_mod, smooth_field);
+  mode* chain = decorated (&normal_B, smooth_mod, square_mod, smooth_field);
+
+  if (!Pipeline::matches (chain))
+  {
+    cerr << "pipeline " << name << " does not match FAIL" << endl;
+    return false;
+  }
+
+  Pipeline compiled (chain);
+
+  // block sizes that include single instances and odd lengths
+  const unsigned nblock = 6;
+  const unsigned sizes[nblock] = { 1, 7, 64, 1, 1, 33 };
+
+  for (unsigned iblock=0; iblock < nblock; iblock++)
+  {
+    unsigned n = sizes[iblock];
+    vector< Spinor<double> > want (n), got (n);
+
+    expect->get_fields (want.data(), n);
+    compiled.get_fields (got.data(), n);
+
+    for (unsigned i=0; i<n; i++)
+      if (want[i].x != got[i].x || want[i].y != got[i].y)
+      {
+        cerr << "pipeline " << name << " block=" << iblock << " i=" << i
+             << " got=" << got[i] << " expected=" << want[i] << " FAIL" << endl;
+        return false;
+      }
+  }
+
+  if (compiled.get_covariance() != expect->get_covariance())
+  {
+    cerr << "pipeline " << name << " covariance FAIL" << endl;
+    return false;
+  }
+
+  return true;
+}
+
+int main ()
+{
+  bool ok = true;
+
+  ok &= test< pipeline<gaussian_source, lognormal_mod> > ("l", 1, 1, 1);
+
+  ok &= test< pipeline<gaussian_source, boxcar_mod<lognormal_mod> > >
+    ("l+b", 5, 1, 1);
+
+  ok &= test< pipeline<gaussian_source, square_mod<lognormal_mod> > >
+    ("l+r", 1, 4, 1);
+
+  ok &= test< pipeline<gaussian_source, lognormal_mod, boxcar_field> >
+    ("l+m", 1, 1, 3);
+
+  ok &= test< pipeline<gaussian_source, boxcar_mod<lognormal_mod>, boxcar_field> >
+    ("l+b+m", 4, 1, 3);
+
+  ok &= test< pipeline<gaussian_source, square_mod<lognormal_mod>, boxcar_field> >
+    ("l+r+m", 1, 5, 2);
+
+  // a pipeline does not match a chain with different stages
+  BoxMuller normal (17, 0);
+  if (pipeline<gaussian_source, lognormal_mod>::matches (decorated (&normal, 3, 1, 1)))
+  {
+    cerr << "pipeline l matches l+b FAIL" << endl;
+    ok = false;
+  }
+
+  if (!ok)
+    return -1;
+
+  cerr << "pipeline tests PASS" << endl;
+  return 0;
+}
@@ -0,0 +1,109 @@
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+#include "quantize_kernel.h"
+#include "SIMD.h"
+
+#include <vector>
+#include <iostream>
+#include <limits>
+#include <cmath>
+
+using namespace std;
+
+/*
+ * Verifies that quantize maps each value to the expected code and packs
+ * the codes in order, using every instruction set supported by the
+ * processor, and that unpack recovers the value represented by each code
+ */
+
+int main ()
+{
+  const unsigned nmax = 61;
+  const double scale_x = 1.7;
+  const double scale_y = 0.3;
+
+  vector< Spinor<double> > fields (nmax);
+  for (unsigned i=0; i<nmax; i++)
+    fields[i] = Spinor<double> (complex<double> (50 * sin (i * 0.71), 40 * cos (i * 1.3)),
+                                complex<double> (300 * sin (i * 2.1 + 1), -3.0 * i));
+
+  // values that are clipped, on the boundary between codes, and not a number
+  fields[3].x = complex<double> (1e9, -1e9);
+  fields[4].y = complex<double> (2.0 / scale_y, -2.0 / scale_y);
+  fields[5].x = complex<double> (numeric_limits<double>::quiet_NaN(), 0.0);
+
+  for (unsigned nbit : { 2, 4, 8 })
+  {
+    const int offset = 1 << (nbit-1);
+    const int top = (1 << nbit) - 1;
+
+    // the expected codes of each value
+    vector<unsigned> codes (4*nmax);
+    for (unsigned i=0; i<nmax; i++)
+    {
+      double values[4] = { fields[i].x.real() * scale_x, fields[i].x.imag() * scale_x,
+                           fields[i].y.real() * scale_y, fields[i].y.imag() * scale_y };
+      for (unsigned k=0; k<4; k++)
+      {
+        double c = floor (values[k]) + offset;
+        codes[i*4+k] = std::isnan (c) ? 0 : std::max (0.0, std::min (c, double(top)));
+      }
+    }
+
+    for (int path = SIMD::Scalar; path <= SIMD::get_supported(); path++)
+    {
+      SIMD::set_path (SIMD::Path(path));
+
+      for (unsigned n=0; n<=nmax; n += (n < 12) ? 1 : 7)
+      {
+        unsigned nbyte = n * nbit / 2;
+        vector<unsigned char> packed (nbyte + 1, 0xA5);
+
+        epsic::quantize (packed.data(), fields.data(), n, nbit, scale_x, scale_y);
+
+        for (unsigned i=0; i < 4*n; i++)
+        {
+          unsigned bit = i * nbit;
+          unsigned code = (packed[bit/8] >> (bit%8)) & top;
+          if (code != codes[i])
+          {
+            cerr << "quantize " << SIMD::get_name (SIMD::Path(path))
+                 << " nbit=" << nbit << " n=" << n << " value=" << i
+                 << " code=" << code << " expected=" << codes[i] << " FAIL" << endl;
+            return -1;
+          }
+        }
+
+        if (packed[nbyte] != 0xA5)
+        {
+          cerr << "quantize " << SIMD::get_name (SIMD::Path(path))
+               << " nbit=" << nbit << " wrote beyond n=" << n << " FAIL" << endl;
+          return -1;
+        }
+
+        vector< Spinor<double> > unpacked (n);
+        epsic::unpack (unpacked.data(), packed.data(), n, nbit, scale_x, scale_y);
+
+        for (unsigned i=0; i<n; i++)
+        {
+          double values[4] = { unpacked[i].x.real() * scale_x, unpacked[i].x.imag() * scale_x,
+                               unpacked[i].y.real() * scale_y, unpacked[i].y.imag() * scale_y };
+          for (unsigned k=0; k<4; k++)
+            if (fabs (values[k] - (int (codes[i*4+k]) - offset + 0.5)) > 1e-12)
+            {
+              cerr << "unpack nbit=" << nbit << " instance=" << i << " FAIL" << endl;
+              return -1;
+            }
+        }
+      }
+    }
+  }
+
+  cerr << "quantize test PASS" << endl;
+  return 0;
+}
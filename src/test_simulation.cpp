@@ -0,0 +1,128 @@
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+#include "simulation.h"
+
+#include <iostream>
+#include <cmath>
+
+using namespace std;
+
+/*
+ * Verifies that a simulation run in several steps reproduces a single
+ * run with the same seed, that extra sinks receive every sample, and
+ * that the simulated moments of a modulated mode approach the
+ * expected moments
+ */
+
+int main ()
+{
+  const uint64_t nsamp = 100000;
+
+  epsic::simulation_config config;
+  config.A.mean = Stokes<double> (1.0, 0.3, 0.0, 0.4);
+  config.A.beta = 0.5;
+  config.A.smooth_modulator = 3;
+  config.sample_size = 4;
+  config.nlag = 3;
+  config.seed = 42;
+
+  epsic::simulation once (config);
+  once.run (nsamp);
+  epsic::simulation_result expect = once.get_result ();
+
+  epsic::simulation steps (config);
+  unsigned index = steps.add (new epsic::stokes_moments);
+
+  steps.run (nsamp / 4);
+  if (steps.get_result().get_count() != nsamp / 4)
+  {
+    cerr << "simulation::run count after first step FAIL" << endl;
+    return -1;
+  }
+
+  steps.run (nsamp - nsamp / 4);
+  epsic::simulation_result result = steps.get_result ();
+
+  if (result.get_count() != nsamp)
+  {
+    cerr << "simulation::run count=" << result.get_count() << " FAIL" << endl;
+    return -1;
+  }
+
+  if (result.get_mean() != expect.get_mean() ||
+      result.get_covariance() != expect.get_covariance())
+  {
+    cerr << "simulation::run in steps does not reproduce a single run FAIL" << endl;
+    return -1;
+  }
+
+  for (unsigned ilag=0; ilag < config.nlag; ilag++)
+    if (result.acf[ilag] != expect.acf[ilag])
+    {
+      cerr << "simulation::run in steps acf lag=" << ilag << " FAIL" << endl;
+      return -1;
+    }
+
+  auto extra = dynamic_cast<const epsic::stokes_moments*> (steps.get_statistic (index));
+  if (!extra || extra->get_moments().get_count() != nsamp)
+  {
+    cerr << "simulation::add sink did not receive every sample FAIL" << endl;
+    return -1;
+  }
+
+  // several threads, each with its own stream of random numbers
+  config.nthread = 3;
+  epsic::simulation threads (config);
+  threads.run (nsamp);
+  result = threads.get_result ();
+
+  if (result.get_count() != nsamp)
+  {
+    cerr << "simulation with threads count=" << result.get_count() << " FAIL" << endl;
+    return -1;
+  }
+
+  for (unsigned i=0; i<4; i++)
+  {
+    double sigma = sqrt (result.expected_covariance[i][i] / nsamp);
+    if (fabs (result.get_mean()[i] - result.expected_mean[i]) > 5 * sigma)
+    {
+      cerr << "simulation mean[" << i << "]=" << result.get_mean()[i]
+           << " expected=" << result.expected_mean[i] << " FAIL" << endl;
+      return -1;
+    }
+
+    double var = result.get_covariance()[i][i];
+    double expected_var = result.expected_covariance[i][i];
+    if (fabs (var - expected_var) > 0.05 * expected_var)
+    {
+      cerr << "simulation var[" << i << "]=" << var
+           << " expected=" << expected_var << " FAIL" << endl;
+      return -1;
+    }
+  }
+
+  // many short simulations in one process
+  config.nthread = 1;
+  config.combination = epsic::simulation_config::Superposed;
+  config.B.mean = Stokes<double> (1.0, -0.3, 0.0, 0.0);
+  for (unsigned i=0; i<100; i++)
+  {
+    config.seed = i + 1;
+    epsic::simulation sim (config);
+    sim.run (100);
+    if (sim.get_result().get_count() != 100)
+    {
+      cerr << "simulation " << i << " count FAIL" << endl;
+      return -1;
+    }
+  }
+
+  cerr << "simulation tests PASS" << endl;
+  return 0;
+}
@@ -0,0 +1,66 @@
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+#include "sliding_window.h"
+#include "Spinor.h"
+
+#include <vector>
+#include <iostream>
+#include <cmath>
+
+using namespace std;
+
+/*
+ * Verifies that the running sum of a sliding window does not drift from
+ * the sum of the values in the window, even after many updates with
+ * values that span many orders of magnitude
+ */
+
+int main ()
+{
+  const unsigned width = 7;
+  const unsigned nvalue = 1000000;
+
+  vector<double> values (nvalue);
+  for (unsigned i=0; i<nvalue; i++)
+    values[i] = (i % 3 == 0) ? 1e8 * sin(i) : 1e-3 * cos(i);
+
+  epsic::sliding_window<double> window (width);
+  epsic::sliding_window< Spinor<double> > fields (width);
+
+  for (unsigned i=0; i<nvalue; i++)
+  {
+    double sum = window.add (values[i]);
+    Spinor<double> field = fields.add (Spinor<double> (values[i], -values[i]));
+
+    if (i % 1000 != 999)
+      continue;
+
+    long double expect = 0;
+    for (unsigned j=i+1-width; j<=i; j++)
+      expect += values[j];
+
+    // the precision of the sum is limited by the largest value in the window
+    double tolerance = 1e-6;
+
+    if (fabs (sum - expect) > tolerance)
+    {
+      cerr << "sliding_window sum=" << sum << " expected=" << double(expect)
+           << " after " << i+1 << " values FAIL" << endl;
+      return -1;
+    }
+
+    if (field.x != sum || field.y != -sum)
+    {
+      cerr << "sliding_window<Spinor> sum=" << field << " FAIL" << endl;
+      return -1;
+    }
+  }
+
+  cerr << "sliding_window test PASS" << endl;
+  return 0;
+}
@@ -0,0 +1,98 @@
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+#include "modulated.h"
+
+#include <vector>
+#include <iostream>
+#include <cmath>
+
+using namespace std;
+
+/*
+ * Verifies that square_modulated_mode::compute_cross_correlation
+ * reproduces the fraction of instance pairs within the same pulse
+ * computed by explicitly laying out the pulses of every population
+ */
+
+//! The original brute-force computation, which uses O(sample_size^2) memory
+vector<double> brute_force (unsigned width, unsigned sample_size)
+{
+  vector<double> cross_correlation (width, 1.0);
+
+  if (sample_size <= width)
+    return cross_correlation;
+
+  vector<double> matrix ( sample_size * sample_size, 0.0 );
+
+  unsigned cur = 0;
+  unsigned populations = 0;
+  while (cur != width)
+  {
+    unsigned ioff=0;
+    while (ioff < sample_size)
+    {
+      unsigned end = width;
+      if (ioff + end > sample_size)
+        end = sample_size - ioff;
+
+      if (cur == width)
+        cur = 0;
+
+      for (; cur < end ; cur++)
+      {
+        for (unsigned col=cur; col < end; col++)
+          matrix[ ioff*sample_size + (ioff+col-cur) ] += 1.0;
+        ioff ++;
+      }
+    }
+    populations ++;
+  }
+
+  for (unsigned ilag=0; ilag < width; ilag++)
+  {
+    unsigned nrow = sample_size - ilag;
+
+    double sum = 0;
+    for (unsigned irow=0; irow < nrow; irow++)
+      sum += matrix[ irow*sample_size + (irow+ilag) ];
+
+    cross_correlation[ilag] = sum / (nrow * populations);
+  }
+
+  return cross_correlation;
+}
+
+int main ()
+{
+  epsic::lognormal_mode* lognormal = new epsic::lognormal_mode (new epsic::mode, 1.0);
+
+  for (unsigned width=1; width <= 12; width++)
+  {
+    for (unsigned sample_size=1; sample_size <= 40; sample_size++)
+    {
+      epsic::square_modulated_mode square (lognormal, width, sample_size);
+      vector<double> expect = brute_force (width, sample_size);
+
+      for (unsigned ilag=0; ilag < width; ilag++)
+      {
+        double got = square.get_cross_correlation (ilag);
+        if (fabs (got - expect[ilag]) > 1e-12)
+        {
+          cerr << "square_modulated_mode width=" << width
+               << " sample_size=" << sample_size << " lag=" << ilag
+               << " got=" << got << " expected=" << expect[ilag]
+               << " FAIL" << endl;
+          return -1;
+        }
+      }
+    }
+  }
+
+  cerr << "square_modulated_mode::compute_cross_correlation test PASS" << endl;
+  return 0;
+}
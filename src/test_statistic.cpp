@@ -0,0 +1,148 @@
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+#include "statistic.h"
+#include "BoxMuller.h"
+#include "SIMD.h"
+
+#include <sstream>
+#include <iostream>
+#include <cmath>
+
+using namespace std;
+
+/*
+ * Verifies that the statistic sinks compute the same results whether
+ * the Stokes samples are consumed one at a time or in blocks, using
+ * every instruction set supported by the processor, and that copies
+ * fed with parts of the data combine to the serial result
+ */
+
+bool close (double a, double b)
+{
+  return fabs(a - b) <= 1e-10 * (fabs(a) + fabs(b) + 1e-300);
+}
+
+bool close (const Matrix<4,4,double>& a, const Matrix<4,4,double>& b)
+{
+  for (unsigned i=0; i<4; i++)
+    for (unsigned j=0; j<4; j++)
+      if (!close (a[i][j], b[i][j]))
+        return false;
+  return true;
+}
+
+int main ()
+{
+  const unsigned nsamp = 10000;
+  const unsigned nlag = 5;
+
+  BoxMuller normal (3, 0);
+  vector<double> deviates (4*nsamp);
+  normal.fill (deviates.data(), deviates.size());
+
+  vector< Vector<4,double> > stokes (nsamp);
+  for (unsigned i=0; i<nsamp; i++)
+  {
+    const double* d = deviates.data() + 4*i;
+    stokes[i] = Vector<4,double> (4.0 + d[0], 0.5*d[1], 0.5*d[2], 0.5*d[3]);
+  }
+
+  // reference computed one sample at a time
+  epsic::moment_accumulator<4> expect;
+  vector< epsic::cross_moment_accumulator<4,4> > expect_acf (nlag);
+  double expect_dop = 0;
+
+  for (unsigned i=0; i<nsamp; i++)
+  {
+    expect.add (stokes[i]);
+    if (i+1 >= nlag)
+      for (unsigned ilag=0; ilag<nlag; ilag++)
+        expect_acf[ilag].add (stokes[i+1-nlag+ilag], stokes[i+1-nlag]);
+
+    const Vector<4,double>& s = stokes[i];
+    expect_dop += sqrt (s[1]*s[1] + s[2]*s[2] + s[3]*s[3]) / s[0];
+  }
+  expect_dop /= nsamp;
+
+  for (int path = SIMD::Scalar; path <= SIMD::get_supported(); path++)
+  {
+    SIMD::set_path (SIMD::Path(path));
+    const char* name = SIMD::get_name (SIMD::Path(path));
+
+    epsic::statistics sinks;
+    epsic::stokes_moments* moments = new epsic::stokes_moments;
+    epsic::stokes_acf* acf = new epsic::stokes_acf (nlag);
+    epsic::polarization_degree* dop = new epsic::polarization_degree;
+    sinks.add (moments);
+    sinks.add (acf);
+    sinks.add (dop);
+
+    // blocks of irregular size, including blocks shorter than nlag
+    for (unsigned i=0, n=1; i<nsamp; i+=n, n=(n*7)%61+1)
+      sinks.consume (stokes.data() + i, std::min (n, nsamp-i));
+
+    if (moments->get_moments().get_count() != nsamp ||
+        !close (moments->get_moments().get_covariance(), expect.get_covariance()))
+    {
+      cerr << "stokes_moments " << name << " FAIL" << endl;
+      return -1;
+    }
+
+    for (unsigned ilag=0; ilag<nlag; ilag++)
+      if (!close (acf->get_acf(ilag).get_covariance(),
+                  expect_acf[ilag].get_covariance()))
+      {
+        cerr << "stokes_acf " << name << " lag=" << ilag << " FAIL" << endl;
+        return -1;
+      }
+
+    if (!close (dop->get_mean(), expect_dop))
+    {
+      cerr << "polarization_degree " << name << " got=" << dop->get_mean()
+           << " expected=" << expect_dop << " FAIL" << endl;
+      return -1;
+    }
+  }
+
+  // copies fed with halves of the data combine to the serial moments
+  epsic::statistics first;
+  epsic::stokes_moments* moments = new epsic::stokes_moments;
+  first.add (moments);
+
+  epsic::statistics* second = first.clone();
+
+  first.consume (stokes.data(), nsamp/2);
+  second->consume (stokes.data() + nsamp/2, nsamp - nsamp/2);
+  first.combine (*second);
+  delete second;
+
+  if (!close (moments->get_moments().get_covariance(), expect.get_covariance()))
+  {
+    cerr << "statistics::combine FAIL" << endl;
+    return -1;
+  }
+
+  // each sample is printed on a separate line
+  ostringstream os;
+  epsic::stokes_printer printer (&os);
+  printer.consume (stokes.data(), 3);
+
+  istringstream is (os.str());
+  unsigned lines = 0;
+  for (string line; getline (is, line); )
+    lines ++;
+
+  if (lines != 3)
+  {
+    cerr << "stokes_printer lines=" << lines << " FAIL" << endl;
+    return -1;
+  }
+
+  cerr << "statistic tests PASS" << endl;
+  return 0;
+}
@@ -0,0 +1,153 @@
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+#include "stokes_file.h"
+#include "simulation.h"
+
+#include <iostream>
+#include <stdexcept>
+#include <cstdio>
+#include <cmath>
+
+using namespace std;
+
+/*
+ * Verifies that the Stokes samples written by stokes_writer, in each
+ * format and with and without compression, are read by stokes_reader,
+ * and that the samples recorded during a simulation have the moments
+ * computed by the simulation
+ */
+
+static bool round_trip (unsigned dtype_size,
+                        epsic::stokes_file_header::Compression compression)
+{
+  const char* filename = "test_stokes_file.dat";
+  const unsigned nsamp = 2500;
+
+  vector< Vector<4,double> > samples (nsamp);
+  for (unsigned i=0; i<nsamp; i++)
+    for (unsigned j=0; j<4; j++)
+      samples[i][j] = sin (i * 0.1 + j) * (j+1);
+
+  epsic::stokes_file_header header;
+  header.dtype_size = dtype_size;
+  header.compression = compression;
+  header.sample_size = 16;
+  header.seed = 1234;
+  header.config = "round trip";
+
+  {
+    // small chunks exercise the exchange of buffers and a partial chunk
+    epsic::stokes_writer writer (filename, header, 300);
+    writer.write (samples.data(), 1000);
+    writer.write (samples.data() + 1000, nsamp - 1000);
+    writer.close ();
+  }
+
+  epsic::stokes_reader reader (filename);
+  const epsic::stokes_file_header& read = reader.get_header();
+
+  if (read.dtype_size != dtype_size || read.compression != compression
+      || read.sample_size != 16 || read.seed != 1234
+      || read.config != "round trip")
+  {
+    cerr << "stokes_reader header FAIL" << endl;
+    return false;
+  }
+
+  vector< Vector<4,double> > copy (nsamp + 10);
+  unsigned nread = reader.read (copy.data(), 777);
+  nread += reader.read (copy.data() + nread, copy.size() - nread);
+
+  if (nread != nsamp || reader.read (copy.data(), 1) != 0)
+  {
+    cerr << "stokes_reader read " << nread << " samples FAIL" << endl;
+    return false;
+  }
+
+  double tolerance = (dtype_size == 8) ? 0.0 : 1e-6;
+
+  for (unsigned i=0; i<nsamp; i++)
+    for (unsigned j=0; j<4; j++)
+      if (fabs (copy[i][j] - samples[i][j]) > tolerance * (j+1))
+      {
+        cerr << "stokes_reader sample " << i << " dtype=" << dtype_size
+             << " compression=" << compression << " FAIL" << endl;
+        return false;
+      }
+
+  remove (filename);
+  return true;
+}
+
+int main ()
+{
+  if (!round_trip (4, epsic::stokes_file_header::None)
+      || !round_trip (8, epsic::stokes_file_header::None))
+    return -1;
+
+  if (epsic::stokes_file_compression()
+      && (!round_trip (4, epsic::stokes_file_header::Zlib)
+          || !round_trip (8, epsic::stokes_file_header::Zlib)))
+    return -1;
+
+  const char* filename = "test_stokes_record.dat";
+  const uint64_t nsamp = 20000;
+
+  epsic::stokes_file_header header;
+  header.dtype_size = 8;
+
+  epsic::simulation_config config;
+  config.seed = 5;
+
+  epsic::simulation sim (config);
+  auto writer = std::make_shared<epsic::stokes_writer> (filename, header);
+  sim.add (new epsic::stokes_recorder (writer));
+  sim.run (nsamp);
+  writer->close ();
+
+  epsic::stokes_reader reader (filename);
+  epsic::stokes_moments moments;
+
+  vector< Vector<4,double> > block (1000);
+  while (unsigned n = reader.read (block.data(), block.size()))
+    moments.consume (block.data(), n);
+
+  epsic::simulation_result result = sim.get_result ();
+
+  if (moments.get_moments().get_count() != nsamp
+      || moments.get_moments().get_mean() != result.get_mean())
+  {
+    cerr << "stokes_recorder samples differ from simulation FAIL" << endl;
+    return -1;
+  }
+
+  remove (filename);
+
+  // a failed write is reported by write or close, without terminating
+  bool reported = false;
+  try
+  {
+    epsic::stokes_writer full ("/dev/full", header, 1000);
+    vector< Vector<4,double> > samples (100000);
+    full.write (samples.data(), samples.size());
+    full.close ();
+  }
+  catch (std::runtime_error&)
+  {
+    reported = true;
+  }
+
+  if (!reported)
+  {
+    cerr << "stokes_writer did not report a failed write FAIL" << endl;
+    return -1;
+  }
+
+  cerr << "stokes_file tests PASS" << endl;
+  return 0;
+}
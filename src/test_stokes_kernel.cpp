@@ -0,0 +1,87 @@
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+#include "stokes_kernel.h"
+#include "BoxMuller.h"
+#include "SIMD.h"
+
+#include <vector>
+#include <iostream>
+#include <cmath>
+
+using namespace std;
+
+/*
+ * Verifies that accumulate_stokes reproduces the sum of the Stokes
+ * parameters computed by compute_stokes for each instance, using every
+ * instruction set supported by the processor, and that every instruction
+ * set computes exactly the same sum
+ */
+
+int main ()
+{
+  const unsigned nmax = 1000;
+
+  BoxMuller normal (5, 0);
+  vector<double> deviates (4*nmax);
+  normal.fill (deviates.data(), deviates.size());
+
+  vector< Spinor<double> > fields (nmax);
+  for (unsigned i=0; i<nmax; i++)
+  {
+    const double* d = deviates.data() + 4*i;
+    fields[i] = Spinor<double> (complex<double> (d[0], d[1]),
+                                complex<double> (d[2], d[3]));
+  }
+
+  // the sums computed by the portable implementation
+  vector< Vector<4,double> > scalar;
+
+  for (int path = SIMD::Scalar; path <= SIMD::get_supported(); path++)
+  {
+    SIMD::set_path (SIMD::Path(path));
+
+    for (unsigned n=0, index=0; n<=nmax; n += (n < 40) ? 1 : 239, index++)
+    {
+      Vector<4,double> expect;
+      for (unsigned i=0; i<n; i++)
+      {
+        Vector<4,double> tmp;
+        compute_stokes (tmp, fields[i]);
+        expect += tmp;
+      }
+
+      // accumulate_stokes adds to the existing sum
+      Vector<4,double> got (1.0, 2.0, 3.0, 4.0);
+      epsic::accumulate_stokes (got, fields.data(), n);
+      got -= Vector<4,double> (1.0, 2.0, 3.0, 4.0);
+
+      for (unsigned j=0; j<4; j++)
+        if (fabs (got[j] - expect[j]) > 1e-12 * (n + 1) * 4.0)
+        {
+          cerr << "accumulate_stokes " << SIMD::get_name (SIMD::Path(path))
+               << " n=" << n << " got=" << got
+               << " expected=" << expect << " FAIL" << endl;
+          return -1;
+        }
+
+      // every instruction set computes exactly the same sum
+      if (path == SIMD::Scalar)
+        scalar.push_back (got);
+      else if (got != scalar[index])
+      {
+        cerr << "accumulate_stokes " << SIMD::get_name (SIMD::Path(path))
+             << " n=" << n << " got=" << got
+             << " differs from scalar=" << scalar[index] << " FAIL" << endl;
+        return -1;
+      }
+    }
+  }
+
+  cerr << "accumulate_stokes test PASS" << endl;
+  return 0;
+}
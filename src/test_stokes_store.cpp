@@ -0,0 +1,153 @@
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+#include "stokes_store.h"
+
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <cstdio>
+#include <cmath>
+
+using namespace std;
+
+/*
+ * Verifies that a stokes_store locates the chunks of a file with or
+ * without an index, that its views of each chunk hold the samples
+ * that were written, and that its analysis in parallel matches that
+ * of the samples themselves, including the lagged products that span
+ * the ranges of chunks consumed by different threads
+ */
+
+int main ()
+{
+  const char* filename = "test_stokes_store.dat";
+  const char* truncated = "test_stokes_store_noindex.dat";
+  const unsigned nsamp = 10000;
+  const unsigned chunk_size = 512;
+  const unsigned nlag = 8;
+
+  vector< Vector<4,double> > samples (nsamp);
+  for (unsigned i=0; i<nsamp; i++)
+    for (unsigned j=0; j<4; j++)
+      samples[i][j] = cos (i * 0.37 + j) + (j == 0) * 2.0;
+
+  epsic::stokes_moments expected;
+  expected.consume (samples.data(), nsamp);
+
+  epsic::stokes_acf expected_acf (nlag);
+  expected_acf.consume (samples.data(), nsamp);
+
+  for (unsigned dtype_size : { 4, 8 })
+  {
+    epsic::stokes_file_header header;
+    header.dtype_size = dtype_size;
+    header.config = "test";
+
+    {
+      epsic::stokes_writer writer (filename, header, chunk_size);
+      writer.write (samples.data(), nsamp);
+      writer.close ();
+    }
+
+    // copy the file without its index
+    {
+      ifstream in (filename, ios::binary);
+      vector<char> bytes ((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+      unsigned nchunk = (nsamp + chunk_size - 1) / chunk_size;
+      bytes.resize (bytes.size() - 8 - (2*nchunk + 2) * 8 - 8);
+      ofstream out (truncated, ios::binary);
+      out.write (bytes.data(), bytes.size());
+    }
+
+    for (const char* name : { filename, truncated })
+    {
+      epsic::stokes_store store (name);
+
+      unsigned nchunk = (nsamp + chunk_size - 1) / chunk_size;
+      if (store.get_nsamp() != nsamp || store.get_nchunk() != nchunk
+          || store.get_header().config != "test")
+      {
+        cerr << "stokes_store " << name << " nsamp=" << store.get_nsamp()
+             << " nchunk=" << store.get_nchunk() << " FAIL" << endl;
+        return -1;
+      }
+
+      double tolerance = (dtype_size == 8) ? 0.0 : 1e-6;
+      unsigned isamp = 0;
+
+      for (unsigned ichunk=0; ichunk < nchunk; ichunk++)
+        for (unsigned i=0; i < store.get_nsamp(ichunk); i++, isamp++)
+          for (unsigned j=0; j<4; j++)
+          {
+            double value = (dtype_size == 8)
+              ? store.get_values<double>(ichunk)[i*4+j]
+              : store.get_values<float>(ichunk)[i*4+j];
+
+            if (fabs (value - samples[isamp][j]) > tolerance * 3)
+            {
+              cerr << "stokes_store view of sample " << isamp << " FAIL" << endl;
+              return -1;
+            }
+          }
+
+      for (unsigned nthread : { 1, 3 })
+      {
+        epsic::statistics sinks;
+        sinks.add (new epsic::stokes_moments);
+        sinks.add (new epsic::stokes_acf (nlag));
+        store.analyze (&sinks, nthread);
+
+        auto moments = dynamic_cast<epsic::stokes_moments*> (sinks.get(0));
+        const epsic::moment_accumulator<4>& a = moments->get_moments();
+        const epsic::moment_accumulator<4>& b = expected.get_moments();
+
+        if (a.get_count() != nsamp)
+        {
+          cerr << "stokes_store::analyze count=" << a.get_count() << " FAIL" << endl;
+          return -1;
+        }
+
+        for (unsigned i=0; i<4; i++)
+          if (fabs (a.get_mean()[i] - b.get_mean()[i]) > 1e-6
+              || fabs (a.get_covariance()[i][i] - b.get_covariance()[i][i]) > 1e-6)
+          {
+            cerr << "stokes_store::analyze nthread=" << nthread
+                 << " moments differ FAIL" << endl;
+            return -1;
+          }
+
+        auto acf = dynamic_cast<epsic::stokes_acf*> (sinks.get(1));
+        for (unsigned ilag=0; ilag<nlag; ilag++)
+        {
+          const epsic::cross_moment_accumulator<4,4>& c = acf->get_acf(ilag);
+          const epsic::cross_moment_accumulator<4,4>& d = expected_acf.get_acf(ilag);
+
+          bool same = c.get_count() == d.get_count();
+          for (unsigned i=0; i<4; i++)
+            for (unsigned j=0; j<4; j++)
+              if (fabs (c.get_covariance()[i][j] - d.get_covariance()[i][j]) > 1e-6)
+                same = false;
+
+          if (!same)
+          {
+            cerr << "stokes_store::analyze nthread=" << nthread
+                 << " lag=" << ilag << " count=" << c.get_count()
+                 << " expected=" << d.get_count() << " FAIL" << endl;
+            return -1;
+          }
+        }
+      }
+    }
+  }
+
+  remove (filename);
+  remove (truncated);
+
+  cerr << "stokes_store tests PASS" << endl;
+  return 0;
+}
@@ -0,0 +1,128 @@
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+#include "stokes_stream.h"
+
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cmath>
+
+using namespace std;
+
+/*
+ * Verifies that a stokes_stream reads every Stokes sample of a file in
+ * each format, in blocks smaller and larger than the file, and sends
+ * them in order to the sink
+ */
+
+int main ()
+{
+  const char* filename = "test_stokes_stream.dat";
+  const unsigned nsamp = 10000;
+
+  vector< Vector<4,double> > samples (nsamp);
+  for (unsigned i=0; i<nsamp; i++)
+    for (unsigned j=0; j<4; j++)
+      samples[i][j] = cos (i * 0.37 + j) + (j == 0) * 2.0;
+
+  for (string format : { "float32", "float64", "text" })
+  {
+    {
+      ofstream out (filename, ios::binary);
+
+      if (format == "text")
+      {
+        out.precision (17);
+        out << "# I Q U V" << endl;
+        epsic::stokes_printer printer (&out);
+        printer.consume (samples.data(), nsamp);
+      }
+
+      for (unsigned i=0; format != "text" && i<nsamp; i++)
+        for (unsigned j=0; j<4; j++)
+        {
+          if (format == "float32")
+          {
+            float value = samples[i][j];
+            out.write (reinterpret_cast<const char*>(&value), sizeof(value));
+          }
+          else
+            out.write (reinterpret_cast<const char*>(&samples[i][j]), sizeof(double));
+        }
+    }
+
+    for (unsigned block_size : { 333, 100000 })
+    {
+      epsic::stokes_stream stream (filename, epsic::stokes_stream::parse_format (format),
+                                   block_size);
+
+      vector< Vector<4,double> > read;
+
+      struct collector : public epsic::statistic
+      {
+        vector< Vector<4,double> >* read;
+        collector* clone () const { return new collector (*this); }
+        void consume (const Vector<4,double>* block, unsigned n)
+        { read->insert (read->end(), block, block + n); }
+        void combine (const epsic::statistic&) { }
+      } sink;
+
+      sink.read = &read;
+
+      uint64_t count = stream.analyze (&sink);
+
+      if (count != nsamp || read.size() != nsamp)
+      {
+        cerr << "stokes_stream " << format << " block_size=" << block_size
+             << " count=" << count << " FAIL" << endl;
+        return -1;
+      }
+
+      double tolerance = (format == "float32") ? 1e-6 : 1e-15;
+
+      for (unsigned i=0; i<nsamp; i++)
+        for (unsigned j=0; j<4; j++)
+          if (fabs (read[i][j] - samples[i][j]) > tolerance * 3)
+          {
+            cerr << "stokes_stream " << format << " sample " << i << " FAIL" << endl;
+            return -1;
+          }
+    }
+  }
+
+  // a truncated sample is an error
+  {
+    ofstream out (filename, ios::binary);
+    double value = 1.0;
+    for (unsigned i=0; i<5; i++)
+      out.write (reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+
+  bool thrown = false;
+  try
+  {
+    epsic::stokes_stream stream (filename, epsic::stokes_stream::Float64);
+    epsic::stokes_moments moments;
+    stream.analyze (&moments);
+  }
+  catch (std::exception&)
+  {
+    thrown = true;
+  }
+
+  if (!thrown)
+  {
+    cerr << "stokes_stream truncated sample FAIL" << endl;
+    return -1;
+  }
+
+  remove (filename);
+
+  cerr << "stokes_stream tests PASS" << endl;
+  return 0;
+}
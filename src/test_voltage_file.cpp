@@ -0,0 +1,157 @@
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+#include "voltage_file.h"
+#include "quantize_kernel.h"
+#include "modulated.h"
+#include "smoothed.h"
+#include "BoxMuller.h"
+
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <cstdio>
+#include <cmath>
+
+using namespace std;
+
+/*
+ * Verifies that a voltage_writer quantizes the fields of a mode in
+ * blocks that are scaled by their root-mean-square values, that the
+ * file does not depend on the number or the speed of the threads, and
+ * that a voltage_reader recovers the quantized fields
+ */
+
+//! Return the contents of the file
+static string read_file (const char* filename)
+{
+  ifstream in (filename, ios::binary);
+  return string (istreambuf_iterator<char> (in), istreambuf_iterator<char> ());
+}
+
+int main ()
+{
+  const char* filename = "test_voltage_file.dat";
+  const uint64_t ninstance = 10000;
+  const unsigned block_size = 1536;
+
+  epsic::mode unmodulated;
+  unmodulated.set_Stokes (Stokes<double> (2.0, 1.0, 0.5, 0.0));
+
+  // the modulation continues across blocks
+  epsic::lognormal_mode modulated (&unmodulated, 0.3);
+  epsic::boxcar_mode source (&modulated, 4);
+
+  for (unsigned nbit : { 2, 4, 8 })
+  {
+    epsic::voltage_file_header header;
+    header.nbit = nbit;
+    header.block_size = block_size;
+    header.seed = 17;
+    header.config = "test";
+
+    string single_threaded;
+
+    for (unsigned nthread : { 1, 3 })
+    {
+      {
+        epsic::voltage_writer writer (filename, header);
+        writer.write (&source, ninstance, nthread);
+        writer.close ();
+      }
+
+      if (nthread == 1)
+        single_threaded = read_file (filename);
+      else if (read_file (filename) != single_threaded)
+      {
+        cerr << "voltage_file nbit=" << nbit << " nthread=" << nthread
+             << " differs from nthread=1 FAIL" << endl;
+        return -1;
+      }
+
+      epsic::voltage_reader reader (filename);
+
+      if (reader.get_header().nbit != nbit
+          || reader.get_header().block_size != block_size
+          || reader.get_header().seed != 17
+          || reader.get_header().config != "test")
+      {
+        cerr << "voltage_reader header nbit=" << nbit << " FAIL" << endl;
+        return -1;
+      }
+
+      vector< Spinor<double> > read (ninstance + 1);
+      if (reader.read (read.data(), 1000) != 1000
+          || reader.read (read.data() + 1000, ninstance) != ninstance - 1000
+          || reader.read (read.data(), 1) != 0)
+      {
+        cerr << "voltage_reader nbit=" << nbit << " count FAIL" << endl;
+        return -1;
+      }
+
+      // regenerate the fields in order with stream 0
+      BoxMuller normal (header.seed, 0);
+      unique_ptr<epsic::mode> copy (source.clone());
+      copy->set_normal (&normal);
+
+      double sum_x = 0.0;
+
+      for (uint64_t start=0, iblock=0; start < ninstance; start += block_size, iblock++)
+      {
+        unsigned n = std::min<uint64_t> (block_size, ninstance - start);
+
+        vector< Spinor<double> > fields (n);
+        copy->get_fields (fields.data(), n);
+
+        double rms_x = 0.0, rms_y = 0.0;
+        for (auto& e : fields)
+        {
+          rms_x += norm (e.x);
+          rms_y += norm (e.y);
+        }
+        rms_x = sqrt (rms_x / (2*n));
+        rms_y = sqrt (rms_y / (2*n));
+
+        float step_x = epsic::get_optimal_step (nbit) * rms_x;
+        float step_y = epsic::get_optimal_step (nbit) * rms_y;
+
+        vector<unsigned char> packed (n * nbit / 2);
+        epsic::quantize (packed.data(), fields.data(), n, nbit, 1.0/step_x, 1.0/step_y);
+        epsic::unpack (fields.data(), packed.data(), n, nbit, 1.0/step_x, 1.0/step_y);
+
+        for (unsigned i=0; i<n; i++)
+        {
+          if (fields[i].x != read[start+i].x || fields[i].y != read[start+i].y)
+          {
+            cerr << "voltage_file nbit=" << nbit << " nthread=" << nthread
+                 << " instance " << start+i << " FAIL" << endl;
+            return -1;
+          }
+          sum_x += norm (read[start+i].x);
+        }
+      }
+
+      // the quantized power of the x polarization approximates that of the mode
+      double power_x = sum_x / ninstance;
+      double expected = 0.5 * (2.0 + 1.0);
+      double tolerance = (nbit == 2) ? 0.2 : 0.05;
+
+      if (fabs (power_x / expected - 1.0) > tolerance)
+      {
+        cerr << "voltage_file nbit=" << nbit << " power_x=" << power_x
+             << " expected=" << expected << " FAIL" << endl;
+        return -1;
+      }
+    }
+  }
+
+  remove (filename);
+
+  cerr << "voltage_file tests PASS" << endl;
+  return 0;
+}
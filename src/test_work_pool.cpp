@@ -0,0 +1,155 @@
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+#include "work_pool.h"
+#include "sweep.h"
+
+#include <iostream>
+#include <stdexcept>
+#include <chrono>
+#include <thread>
+
+using namespace std;
+
+/*
+ * Verifies that work_stealing_pool runs every task exactly once, that
+ * idle threads steal the tasks of a thread with expensive tasks, that
+ * exceptions are propagated, that run_threads runs every worker to
+ * completion before rethrowing the exception of the first, and that the
+ * results of a sweep do not depend on the number of threads
+ */
+
+int main ()
+{
+  const unsigned ntask = 200;
+  const unsigned nthread = 4;
+
+  vector< atomic<unsigned> > count (ntask);
+  vector<epsic::work_stealing_pool::task> tasks;
+
+  for (unsigned i=0; i<ntask; i++)
+  {
+    count[i] = 0;
+    tasks.push_back ( [&count, i] ()
+    {
+      // the tasks in the share of the first thread are expensive
+      if (i < ntask / nthread)
+        std::this_thread::sleep_for (std::chrono::microseconds (500));
+      count[i] ++;
+    } );
+  }
+
+  epsic::work_stealing_pool pool (nthread);
+  pool.run (tasks);
+
+  for (unsigned i=0; i<ntask; i++)
+    if (count[i] != 1)
+    {
+      cerr << "work_stealing_pool task " << i << " ran " << count[i]
+           << " times FAIL" << endl;
+      return -1;
+    }
+
+  if (pool.get_steals() == 0)
+  {
+    cerr << "work_stealing_pool no tasks were stolen FAIL" << endl;
+    return -1;
+  }
+
+  tasks[ntask/2] = [] () { throw std::runtime_error ("expected"); };
+
+  bool caught = false;
+  try
+  {
+    pool.run (tasks);
+  }
+  catch (std::runtime_error& error)
+  {
+    caught = true;
+  }
+
+  if (!caught)
+  {
+    cerr << "work_stealing_pool exception not propagated FAIL" << endl;
+    return -1;
+  }
+
+  vector< atomic<unsigned> > ran (nthread);
+  for (auto& r : ran)
+    r = 0;
+
+  string message;
+  try
+  {
+    epsic::run_threads (nthread, [&ran] (unsigned ithread)
+    {
+      ran[ithread] ++;
+      if (ithread >= 2)
+        throw std::runtime_error ("worker " + to_string (ithread));
+    });
+  }
+  catch (std::runtime_error& error)
+  {
+    message = error.what();
+  }
+
+  for (unsigned ithread=0; ithread < nthread; ithread++)
+    if (ran[ithread] != 1)
+    {
+      cerr << "run_threads worker " << ithread << " ran " << ran[ithread]
+           << " times FAIL" << endl;
+      return -1;
+    }
+
+  if (message != "worker 2")
+  {
+    cerr << "run_threads rethrew '" << message << "' FAIL" << endl;
+    return -1;
+  }
+
+  epsic::sweep serial;
+  epsic::sweep parallel;
+
+  for (unsigned nint : { 1, 8, 32 })
+  {
+    epsic::sweep_point point;
+    point.config.sample_size = nint;
+    point.config.A.beta = 0.5;
+    point.nsamp = 2000;
+    serial.add (point);
+    parallel.add (point);
+  }
+
+  for (epsic::sweep* s : { &serial, &parallel })
+  {
+    s->set_ntrial (5);
+    s->set_seed (77);
+  }
+
+  serial.run (1);
+  parallel.run (3);
+
+  const vector<epsic::sweep_trial>& a = serial.get_trials();
+  const vector<epsic::sweep_trial>& b = parallel.get_trials();
+
+  if (a.size() != 15 || b.size() != a.size())
+  {
+    cerr << "sweep number of trials FAIL" << endl;
+    return -1;
+  }
+
+  for (unsigned i=0; i<a.size(); i++)
+    if (a[i].seed != b[i].seed || a[i].count != 2000 ||
+        a[i].mean != b[i].mean || a[i].covariance != b[i].covariance)
+    {
+      cerr << "sweep trial " << i << " depends on the number of threads FAIL" << endl;
+      return -1;
+    }
+
+  cerr << "work_stealing_pool tests PASS" << endl;
+  return 0;
+}
@@ -11,7 +11,11 @@
 #ifndef __epsic_util_BoxMuller_h
 #define __epsic_util_BoxMuller_h
 
+#include "Philox.h"
+
 #include <random>
+#include <cstddef>
+#include <cstdint>
 
 //! Returns a random variable from a normal distribution
 /*! Uses std::normal_distribution, which typically implements the Marsaglia polar method,
@@ -20,25 +24,97 @@
     The previous implementation of this class also used the Marsaglia polar method;
     however, it also used drand48 to generate 64-bit double-precision floating point
     values, and only 32-bit floats are returned.
+
+    When constructed with both a seed and a stream number, the deviates are
+    instead derived from a counter-based Philox engine, and every deviate is
+    computed by the algorithm used by fill.  The output then depends only on
+    the seed, the stream number and the position in the stream, so that
+    simulations can be reproduced, divided into independent streams, and
+    resumed from any position.
   */
 class BoxMuller
 {
   // Mersenne Twister random number engine
   std::mt19937 engine;
 
+  // Counter-based random number engines used for normal and uniform deviates
+  Philox normal_counter;
+  Philox uniform_counter;
+
+  // True when the counter-based engines are used
+  bool counter_based;
+
   // Uniform distribution, constrained to output floats
   std::normal_distribution<float> dist;
 
+  // Number of normal deviates computed at once by fill
+  static constexpr unsigned block_size = 512;
+
+  // Random bits and the normal deviates computed from them
+  uint32_t bits[block_size];
+  float deviates[block_size];
+
+  // Index of the next unused element of deviates
+  unsigned current;
+
+  // Compute the next block of deviates
+  void generate ();
+
+  // Copy the next n deviates to x
+  template<typename T> void fill_normal (T* x, size_t n);
+
   public:
 
   //! Default constructor
   BoxMuller (long seed = 0);
 
+  //! Construct a counter-based generator of the specified stream (< 2^63)
+  BoxMuller (uint64_t seed, uint64_t stream);
+
+  //! Return true if the deviates are derived from a counter-based engine
+  bool get_counter_based () const { return counter_based; }
+
+  //! Return the seed of the counter-based engine
+  uint64_t get_seed () const { return normal_counter.get_seed(); }
+
+  //! Start the specified stream of the counter-based engine
+  void set_stream (uint64_t stream);
+  uint64_t get_stream () const { return normal_counter.get_stream(); }
+
+  //! Set the number of normal deviates from the start of the stream
+  void seek (uint64_t position);
+
+  //! Get the number of normal deviates from the start of the stream
+  uint64_t tell () const;
+
+  //! Set the number of random words used by uniform deviates
+  void seek_uniform (uint64_t position);
+
+  //! Get the number of random words used by uniform deviates
+  uint64_t tell_uniform () const;
+
+  //! returns a uniform deviate on [0,1)
+  double uniform ();
+
+  //! returns a gamma deviate with the specified shape and unit scale
+  double gamma (double shape);
+
   //! returns a normal deviate with zero mean and unit variance
   float operator () () { return evaluate(); }
 
   //! returns a normal deviate with zero mean and unit variance
   float evaluate ();
+
+  //! fills the array with n normal deviates with zero mean and unit variance
+  /*! Uses the basic form of the Box-Muller transform, which maps every pair
+      of uniform deviates onto a pair of normal deviates without rejection.
+      The logarithm, sine and cosine are computed using branch-free
+      single-precision polynomial approximations, so that the compiler
+      can vectorize the transformation of each block of deviates. */
+  void fill (float* x, size_t n);
+
+  //! fills the array with n normal deviates, computed with single precision
+  void fill (double* x, size_t n);
 };
 
 #endif
@@ -0,0 +1,93 @@
+//-*-C++-*-
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+// epsic/src/util/Philox.h
+
+#ifndef __epsic_util_Philox_h
+#define __epsic_util_Philox_h
+
+#include <cstddef>
+#include <cstdint>
+
+//! Counter-based random number engine
+/*! Implements the Philox4x32-10 generator of Salmon et al. (2011),
+    "Parallel random numbers: as easy as 1, 2, 3", in Proceedings of
+    the International Conference for High Performance Computing,
+    Networking, Storage and Analysis.
+
+    Each block of four 32-bit outputs is a bijection of a 128-bit
+    counter, keyed by a 64-bit seed.  The upper 64 bits of the counter
+    are set by the stream number and the lower 64 bits count the blocks
+    within the stream.  Therefore, every stream is independent of every
+    other stream, and any position in a stream can be reached in
+    constant time.  Satisfies the UniformRandomBitGenerator requirements.
+  */
+class Philox
+{
+public:
+
+  typedef uint32_t result_type;
+
+  //! Construct with the specified seed and stream number
+  Philox (uint64_t seed = 0, uint64_t stream = 0);
+
+  //! Set the seed and return to the start of the current stream
+  void seed (uint64_t seed);
+  uint64_t get_seed () const { return key_seed; }
+
+  //! Set the stream number and return to the start of the stream
+  void set_stream (uint64_t stream);
+  uint64_t get_stream () const { return stream; }
+
+  //! Set the number of outputs from the start of the stream
+  void seek (uint64_t position);
+
+  //! Get the number of outputs from the start of the stream
+  uint64_t tell () const { return position; }
+
+  //! Skip the next n outputs
+  void discard (uint64_t n) { seek (position + n); }
+
+  //! Return the next output
+  result_type operator () ()
+  {
+    unsigned index = position % 4;
+    if (index == 0)
+      compute (position / 4);
+    position ++;
+    return buffer[index];
+  }
+
+  //! Fill the array with the next n outputs
+  void generate (uint32_t* out, size_t n);
+
+  static constexpr result_type min () { return 0; }
+  static constexpr result_type max () { return UINT32_MAX; }
+
+  //! The Philox4x32-10 bijection of the counter
+  static void bijection (uint32_t counter[4], const uint32_t key[2]);
+
+private:
+
+  uint64_t key_seed;
+  uint64_t stream;
+
+  //! Number of outputs from the start of the stream
+  uint64_t position;
+
+  //! The key derived from the seed
+  uint32_t key[2];
+
+  //! The current block of outputs
+  uint32_t buffer[4];
+
+  //! Compute the specified block of the current stream
+  void compute (uint64_t block);
+};
+
+#endif
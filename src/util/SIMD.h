@@ -0,0 +1,52 @@
+//-*-C++-*-
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+// epsic/src/util/SIMD.h
+
+#ifndef __epsic_util_SIMD_h
+#define __epsic_util_SIMD_h
+
+/* On x86 processors, kernels are compiled once for each instruction
+   set extension by marking the variants with the following function
+   attributes; at run time, the widest variant supported by the
+   processor is selected by SIMD::get_path.  The variants perform the
+   same floating point operations in the same order, and are compiled
+   with -ffp-contract=off, so that every path computes identical results. */
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86 1
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define SIMD_TARGET_AVX512 __attribute__((target("avx512f,avx2,fma")))
+#endif
+
+//! Forces inlining of the generic body of a kernel into each variant
+#define SIMD_INLINE inline __attribute__((always_inline))
+
+//! Selects the instruction set extensions used by vectorized kernels
+namespace SIMD
+{
+  //! Code paths, in order of increasing vector width
+  enum Path { Scalar, AVX2, AVX512 };
+
+  //! Return the widest path supported by the processor
+  /*! The processor is queried only once.  If the EPSIC_SIMD environment
+      variable is set to scalar, avx2 or avx512, the path is limited
+      accordingly (e.g. to reproduce results computed on another host). */
+  Path get_supported ();
+
+  //! Return the path used by the kernels
+  Path get_path ();
+
+  //! Use the specified path, or the widest supported path if narrower
+  void set_path (Path path);
+
+  //! Return the name of the specified path
+  const char* get_name (Path path);
+}
+
+#endif
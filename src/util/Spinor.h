@@ -42,6 +42,7 @@ public:
   template <typename U>
   const Spinor& operator /= (U norm) { x /= norm; y /= norm; return *this; }
   const Spinor& operator += (const Spinor& e) { x+=e.x; y+=e.y; return *this; }
+  const Spinor& operator -= (const Spinor& e) { x-=e.x; y-=e.y; return *this; }
 };
 
 template <typename T>
@@ -57,6 +58,12 @@ const Spinor<T> operator + (Spinor<T> s, const Spinor<T>& t)
   return s += t;
 }
 
+template <typename T>
+const Spinor<T> operator - (Spinor<T> s, const Spinor<T>& t)
+{
+  return s -= t;
+}
+
 //! returns the input Spinor transformed by the Jones matrix
 template<typename T>
 const Spinor<T> operator * (const Jones<T>& j, const Spinor<T>& in)
@@ -0,0 +1,327 @@
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+#include "voltage_file.h"
+#include "quantize_kernel.h"
+#include "checkpoint.h"
+#include "BoxMuller.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <exception>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <cstring>
+#include <cmath>
+
+using namespace std;
+
+static const char magic[8] = { 'E','P','S','I','C','V','L','T' };
+static const uint32_t version = 1;
+
+//! number of bytes that precede the codes of each block
+static const unsigned block_header_size = sizeof(uint32_t) + 2 * sizeof(float);
+
+double epsic::get_optimal_step (unsigned nbit)
+{
+  switch (nbit)
+  {
+  case 2:
+    return 0.9957;
+  case 4:
+    return 0.3352;
+  case 8:
+    return 4.0 / 128;
+  }
+
+  throw std::runtime_error ("epsic::get_optimal_step - invalid number of bits");
+}
+
+epsic::voltage_writer::voltage_writer (const std::string& filename,
+                                       const voltage_file_header& _header)
+  : header (_header)
+{
+  if (header.nbit != 2 && header.nbit != 4 && header.nbit != 8)
+    throw std::runtime_error ("epsic::voltage_writer - invalid number of bits");
+
+  if (header.block_size == 0)
+    throw std::runtime_error ("epsic::voltage_writer - invalid block size");
+
+  file.open (filename.c_str(), std::ios::binary);
+  if (!file)
+    throw std::runtime_error ("epsic::voltage_writer - could not open " + filename);
+
+  file.write (magic, sizeof(magic));
+  write_binary (file, version);
+  write_binary (file, uint32_t (header.nbit));
+  write_binary (file, uint32_t (header.block_size));
+  write_binary (file, header.seed);
+  write_binary (file, header.config);
+
+  while (file.tellp() % 8)
+    file.put (0);
+}
+
+//! Return the root-mean-square value of each component of each polarization
+static void get_rms (const Spinor<double>* fields, unsigned n,
+                     double& rms_x, double& rms_y)
+{
+  double sum_x = 0.0;
+  double sum_y = 0.0;
+
+  for (unsigned i=0; i<n; i++)
+  {
+    sum_x += norm (fields[i].x);
+    sum_y += norm (fields[i].y);
+  }
+
+  rms_x = sqrt (sum_x / (2*n));
+  rms_y = sqrt (sum_y / (2*n));
+}
+
+/*
+  The fields are generated in order by the calling thread, using one
+  copy of the mode and stream 0 of the seed, so that the output does
+  not depend on the number of threads and the modulation of the mode
+  continues across blocks.  Block i is passed through slot i % nslot to
+  thread i % nthread, which quantizes and packs it, waits for the
+  previous block to be written, and then writes it.  A slot is refilled
+  once the block that previously occupied it has been written.
+*/
+void epsic::voltage_writer::write (const mode* source, uint64_t ninstance,
+                                   unsigned nthread)
+{
+  if (nthread == 0)
+    throw std::runtime_error ("epsic::voltage_writer::write - invalid number of threads");
+
+  const unsigned nbit = header.nbit;
+  const unsigned block_size = header.block_size;
+  const uint64_t nblock = (ninstance + block_size - 1) / block_size;
+  const unsigned nslot = nthread + 1;
+
+  struct slot
+  {
+    std::vector< Spinor<double> > fields;
+    std::vector<unsigned char> data;
+    unsigned count;   // the number of instances in the block
+    uint64_t block;   // the block that occupies the slot
+    bool generated;   // the fields have been generated and not yet written
+  };
+
+  std::vector<slot> slots (nslot);
+  for (auto& s : slots)
+  {
+    s.fields.resize (block_size);
+    s.data.resize (block_header_size + block_size * nbit / 2);
+    s.count = 0;
+    s.block = 0;
+    s.generated = false;
+  }
+
+  std::mutex mutex;
+  std::condition_variable condition;
+  std::exception_ptr error;
+  bool aborted = false;
+
+  // the number of blocks written
+  uint64_t written = 0;
+
+  auto fail = [&] (std::exception_ptr e)
+  {
+    std::lock_guard<std::mutex> lock (mutex);
+    if (!error)
+      error = e;
+    aborted = true;
+    condition.notify_all ();
+  };
+
+  auto worker = [&] (unsigned ithread)
+  {
+    try
+    {
+      for (uint64_t iblock = ithread; iblock < nblock; iblock += nthread)
+      {
+        slot& s = slots[iblock % nslot];
+        {
+          std::unique_lock<std::mutex> lock (mutex);
+          condition.wait (lock, [&] { return aborted || (s.generated && s.block == iblock); });
+          if (aborted)
+            return;
+        }
+
+        const unsigned n = s.count;
+
+        double rms_x, rms_y;
+        get_rms (s.fields.data(), n, rms_x, rms_y);
+
+        double step = get_optimal_step (nbit);
+        float step_x = (rms_x > 0.0) ? step * rms_x : 1.0;
+        float step_y = (rms_y > 0.0) ? step * rms_y : 1.0;
+
+        unsigned char* data = s.data.data();
+        uint32_t count = n;
+        memcpy (data, &count, sizeof(count));
+        memcpy (data + sizeof(count), &step_x, sizeof(step_x));
+        memcpy (data + sizeof(count) + sizeof(step_x), &step_y, sizeof(step_y));
+
+        quantize (data + block_header_size, s.fields.data(), n, nbit,
+                  1.0 / step_x, 1.0 / step_y);
+
+        {
+          std::unique_lock<std::mutex> lock (mutex);
+          condition.wait (lock, [&] { return aborted || written == iblock; });
+          if (aborted)
+            return;
+        }
+
+        // only the thread of the next block writes
+        file.write (reinterpret_cast<const char*> (data), block_header_size + n * nbit / 2);
+        if (!file)
+          throw std::runtime_error ("epsic::voltage_writer::write - write failed");
+
+        std::lock_guard<std::mutex> lock (mutex);
+        s.generated = false;
+        written ++;
+        condition.notify_all ();
+      }
+    }
+    catch (...)
+    {
+      fail (std::current_exception ());
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (unsigned ithread=0; ithread < nthread; ithread++)
+    threads.push_back (std::thread (worker, ithread));
+
+  try
+  {
+    std::unique_ptr<mode> copy (source->clone());
+    BoxMuller normal (header.seed, 0);
+    copy->set_normal (&normal);
+
+    for (uint64_t iblock=0; iblock < nblock; iblock++)
+    {
+      slot& s = slots[iblock % nslot];
+      {
+        std::unique_lock<std::mutex> lock (mutex);
+        condition.wait (lock, [&] { return aborted || iblock < written + nslot; });
+        if (aborted)
+          break;
+      }
+
+      unsigned n = std::min<uint64_t> (block_size, ninstance - iblock * block_size);
+      copy->get_fields (s.fields.data(), n);
+
+      std::lock_guard<std::mutex> lock (mutex);
+      s.count = n;
+      s.block = iblock;
+      s.generated = true;
+      condition.notify_all ();
+    }
+  }
+  catch (...)
+  {
+    fail (std::current_exception ());
+  }
+
+  for (auto& thread : threads)
+    thread.join ();
+
+  if (error)
+    std::rethrow_exception (error);
+}
+
+void epsic::voltage_writer::close ()
+{
+  file.close ();
+  if (!file)
+    throw std::runtime_error ("epsic::voltage_writer - write failed");
+}
+
+epsic::voltage_reader::voltage_reader (const std::string& filename)
+{
+  file.open (filename.c_str(), std::ios::binary);
+  if (!file)
+    throw std::runtime_error ("epsic::voltage_reader - could not open " + filename);
+
+  char header_magic[sizeof(magic)];
+  if (!file.read (header_magic, sizeof(header_magic))
+      || memcmp (header_magic, magic, sizeof(magic)) != 0)
+    throw std::runtime_error ("epsic::voltage_reader - " + filename
+                              + " is not a file of quantized voltages");
+
+  uint32_t file_version, nbit, block_size;
+  read_binary (file, file_version);
+  read_binary (file, nbit);
+  read_binary (file, block_size);
+  read_binary (file, header.seed);
+  read_binary (file, header.config);
+
+  if (file_version != version)
+    throw std::runtime_error ("epsic::voltage_reader - unsupported version");
+
+  if (nbit != 2 && nbit != 4 && nbit != 8)
+    throw std::runtime_error ("epsic::voltage_reader - invalid number of bits");
+
+  header.nbit = nbit;
+  header.block_size = block_size;
+
+  file.seekg ((uint64_t(file.tellg()) + 7) / 8 * 8);
+
+  nblock = current = 0;
+  scale_x = scale_y = 1.0;
+}
+
+bool epsic::voltage_reader::next_block ()
+{
+  uint32_t n = 0;
+  float step_x, step_y;
+
+  if (!file.read (reinterpret_cast<char*>(&n), sizeof(n)))
+    return false;
+
+  read_binary (file, step_x);
+  read_binary (file, step_y);
+
+  if (n == 0 || n > header.block_size)
+    throw std::runtime_error ("epsic::voltage_reader - invalid block");
+
+  block.resize (n * header.nbit / 2);
+  if (!file.read (reinterpret_cast<char*>(block.data()), block.size()))
+    throw std::runtime_error ("epsic::voltage_reader - block truncated");
+
+  scale_x = 1.0 / step_x;
+  scale_y = 1.0 / step_y;
+
+  nblock = n;
+  current = 0;
+  return true;
+}
+
+unsigned epsic::voltage_reader::read (Spinor<double>* fields, unsigned n)
+{
+  unsigned total = 0;
+
+  while (total < n)
+  {
+    if (current == nblock && !next_block())
+      break;
+
+    unsigned count = std::min (n - total, nblock - current);
+    unpack (fields + total, block.data() + current * header.nbit / 2,
+            count, header.nbit, scale_x, scale_y);
+
+    current += count;
+    total += count;
+  }
+
+  return total;
+}
@@ -0,0 +1,126 @@
+//-*-C++-*-
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+//! @file epsic/src/voltage_file.h
+
+#ifndef __epsic_voltage_file_h
+#define __epsic_voltage_file_h
+
+#include "mode.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace epsic
+{
+  //! Describes the contents of a file of quantized field instances
+  /*! A file of quantized voltages has the following format (native byte
+    order):
+
+      char[8]    "EPSICVLT"
+      uint32_t   version
+      uint32_t   bits per value (2, 4 or 8)
+      uint32_t   number of instances in each block
+      uint64_t   seed of the random number generator
+      uint64_t   length of the description, followed by its characters
+
+    padded with zeros to a multiple of eight bytes, followed by blocks,
+    each of which consists of
+
+      uint32_t   number of instances in the block, N
+      float      quantization step of the x polarization
+      float      quantization step of the y polarization
+
+    and the packed codes of the N instances, as described by quantize.
+    Each code c represents the value (c - 2^(nbit-1) + 0.5) times the
+    step of its polarization.  Every block contains the same number of
+    instances, except possibly the last. */
+  struct voltage_file_header
+  {
+    //! number of bits in each value: 2, 4 or 8
+    unsigned nbit;
+
+    //! number of instances in each block
+    unsigned block_size;
+
+    //! seed of the random number generator
+    uint64_t seed;
+
+    //! description of the configuration of the simulation
+    std::string config;
+
+    voltage_file_header ()
+    {
+      nbit = 8;
+      block_size = 64 * 1024;
+      seed = 0;
+    }
+  };
+
+  //! Return the step that best quantizes normal deviates of unit variance
+  /*! The steps of 2-bit and 4-bit codes minimize the mean squared error
+    of a uniform quantizer; 8-bit codes span -4 to 4 standard deviations. */
+  double get_optimal_step (unsigned nbit);
+
+  //! Writes quantized field instances using several threads
+  /*! The calling thread generates every block in order, using one copy
+    of the mode, while each of nthread threads quantizes and packs every
+    nthread-th block and writes it in turn.  Therefore, the file does not
+    depend on the number of threads, and the modulation and smoothing of
+    the mode continue across blocks.  The step of each polarization is
+    set from the root-mean-square value of the block. */
+  class voltage_writer
+  {
+    std::ofstream file;
+    voltage_file_header header;
+
+  public:
+
+    //! Open the file and write the header
+    voltage_writer (const std::string& filename, const voltage_file_header&);
+
+    //! Generate and write ninstance instances of the field of the mode
+    /*! The copy of the mode uses stream 0 of the seed in the header */
+    void write (const mode* source, uint64_t ninstance, unsigned nthread = 1);
+
+    //! Close the file
+    void close ();
+  };
+
+  //! Reads the quantized field instances written by voltage_writer
+  class voltage_reader
+  {
+    std::ifstream file;
+    voltage_file_header header;
+
+    //! the codes of the current block and the next instance to be read
+    std::vector<unsigned char> block;
+    unsigned nblock;
+    unsigned current;
+    double scale_x, scale_y;
+
+    //! Read the next block; return false at the end of the file
+    bool next_block ();
+
+  public:
+
+    //! Open the file and read the header
+    voltage_reader (const std::string& filename);
+
+    //! Return the header
+    const voltage_file_header& get_header () const { return header; }
+
+    //! Read up to n field instances; return the number read (0 at the end)
+    unsigned read (Spinor<double>* fields, unsigned n);
+  };
+
+} // end of namespace epsic
+
+#endif // ! defined __epsic_voltage_file_h
@@ -0,0 +1,147 @@
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+#include "work_pool.h"
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <exception>
+#include <stdexcept>
+
+using namespace std;
+
+void epsic::run_threads (unsigned nthread,
+                         const std::function<void(unsigned)>& worker)
+{
+  std::vector<std::exception_ptr> thread_error (nthread);
+
+  auto guarded = [&] (unsigned ithread)
+  {
+    try
+    {
+      worker (ithread);
+    }
+    catch (...)
+    {
+      thread_error[ithread] = std::current_exception();
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (unsigned ithread=1; ithread < nthread; ithread++)
+    threads.push_back (std::thread (guarded, ithread));
+
+  guarded (0);
+
+  for (auto& thread : threads)
+    thread.join ();
+
+  for (auto& error : thread_error)
+    if (error)
+      std::rethrow_exception (error);
+}
+
+epsic::work_stealing_pool::work_stealing_pool (unsigned n)
+{
+  if (n == 0)
+    throw std::runtime_error ("epsic::work_stealing_pool - invalid number of threads");
+
+  nthread = n;
+  steals = 0;
+}
+
+namespace
+{
+  //! The indices of the tasks not yet started by one thread
+  struct share
+  {
+    std::mutex lock;
+    std::deque<unsigned> tasks;
+
+    //! Remove the last task; return false if there are none
+    bool pop_back (unsigned& index)
+    {
+      std::lock_guard<std::mutex> guard (lock);
+      if (tasks.empty())
+        return false;
+      index = tasks.back();
+      tasks.pop_back();
+      return true;
+    }
+
+    //! Remove the first task; return false if there are none
+    bool pop_front (unsigned& index)
+    {
+      std::lock_guard<std::mutex> guard (lock);
+      if (tasks.empty())
+        return false;
+      index = tasks.front();
+      tasks.pop_front();
+      return true;
+    }
+  };
+}
+
+void epsic::work_stealing_pool::run (const std::vector<task>& tasks)
+{
+  steals = 0;
+
+  unsigned ntask = tasks.size();
+  std::vector<share> shares (nthread);
+
+  for (unsigned ithread=0; ithread < nthread; ithread++)
+  {
+    unsigned start = uint64_t(ntask) * ithread / nthread;
+    unsigned end = uint64_t(ntask) * (ithread+1) / nthread;
+    for (unsigned i=start; i<end; i++)
+      shares[ithread].tasks.push_back (i);
+  }
+
+  std::atomic<bool> failed (false);
+  std::exception_ptr error;
+  std::mutex error_lock;
+
+  auto worker = [&] (unsigned ithread)
+  {
+    unsigned index = 0;
+
+    while (!failed)
+    {
+      bool found = shares[ithread].pop_back (index);
+
+      // no tasks are added during a run, so a thread with no tasks of
+      // its own is done when it finds nothing to steal
+      for (unsigned i=1; !found && i < nthread; i++)
+      {
+        found = shares[(ithread+i) % nthread].pop_front (index);
+        if (found)
+          steals ++;
+      }
+
+      if (!found)
+        return;
+
+      try
+      {
+        tasks[index] ();
+      }
+      catch (...)
+      {
+        std::lock_guard<std::mutex> guard (error_lock);
+        if (!error)
+          error = std::current_exception();
+        failed = true;
+      }
+    }
+  };
+
+  run_threads (nthread, worker);
+
+  if (error)
+    std::rethrow_exception (error);
+}
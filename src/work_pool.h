@@ -0,0 +1,60 @@
+//-*-C++-*-
+/***************************************************************************
+ *
+ *   Copyright (C) 2026 by Willem van Straten
+ *   Licensed under the Academic Free License version 2.1
+ *
+ ***************************************************************************/
+
+//! @file epsic/src/work_pool.h
+
+#ifndef __epsic_work_pool_h
+#define __epsic_work_pool_h
+
+#include <functional>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+
+namespace epsic
+{
+  //! Run worker(ithread) for each ithread < nthread on its own thread
+  /*! Worker 0 runs on the calling thread.  Every worker runs to
+    completion; then the exception thrown by the worker with the lowest
+    index, if any, is rethrown. */
+  void run_threads (unsigned nthread, const std::function<void(unsigned)>& worker);
+
+  //! Runs a set of independent tasks of unequal cost on a pool of threads
+  /*! The tasks are initially divided into contiguous shares, one for
+    each thread.  Each thread runs the tasks in its own share, starting
+    from the end; a thread that runs out of tasks steals the first
+    remaining task from the share of another thread.  Expensive tasks
+    therefore do not leave the other threads idle. */
+  class work_stealing_pool
+  {
+    unsigned nthread;
+
+    //! number of tasks stolen during the last run
+    std::atomic<uint64_t> steals;
+
+  public:
+
+    typedef std::function<void()> task;
+
+    work_stealing_pool (unsigned nthread);
+
+    //! Run every task once; return when all tasks are done
+    /*! If any task throws an exception, the remaining tasks are not
+      started and the first exception is rethrown. */
+    void run (const std::vector<task>& tasks);
+
+    //! Return the number of threads in the pool
+    unsigned get_nthread () const { return nthread; }
+
+    //! Return the number of tasks stolen during the last run
+    uint64_t get_steals () const { return steals; }
+  };
+
+} // end of namespace epsic
+
+#endif // ! defined __epsic_work_pool_h